@@ -31,7 +31,36 @@
 using namespace lair;
 
 
-Ai::Ai(CharacterSP character)
+AiAction AiAction::none() {
+	return AiAction{ NONE, CharacterHandle(), nullptr, BACK };
+}
+
+
+AiAction AiAction::attack(const Character* target) {
+	return AiAction{ ATTACK, target->handle(), nullptr, BACK };
+}
+
+
+AiAction AiAction::moveTo(MapNode* dest) {
+	return AiAction{ MOVE, CharacterHandle(), dest, BACK };
+}
+
+
+AiAction AiAction::goToPlace(Place place) {
+	return AiAction{ PLACE, CharacterHandle(), nullptr, place };
+}
+
+
+bool operator==(const AiAction& a0, const AiAction& a1) {
+	return a0.type   == a1.type
+	    && a0.target == a1.target
+	    && a0.dest   == a1.dest
+	    && a0.place  == a1.place;
+}
+
+
+
+Ai::Ai(Character* character)
     : _character(character)
 {
 }
@@ -41,10 +70,61 @@ Ai::~Ai() {
 }
 
 
-CharacterSP Ai::character() const {
-	return _character.lock();
+Character* Ai::character() const {
+	return _character;
+}
+
+
+// Returns nullptr if the target has been removed from the game.
+Character* Ai::target() const {
+	return _character->_textMoba->character(_target);
+}
+
+
+AiAction Ai::decide() {
+	return AiAction::none();
+}
+
+
+void Ai::apply(const AiAction& action) {
+	Character* c = _character;
+	if(!c->isAlive())
+		return;
+
+	switch(action.type) {
+	case AiAction::NONE:
+		break;
+	case AiAction::ATTACK: {
+		Character* target = c->_textMoba->character(action.target);
+		if(target && target->isAlive() && target->node() == c->node()) {
+			c->attack(action.target);
+		}
+		break;
+	}
+	case AiAction::MOVE:
+		c->moveTo(action.dest);
+		break;
+	case AiAction::PLACE:
+		c->goToPlace(action.place);
+		break;
+	}
 }
 
 
 void Ai::play() {
+	apply(decide());
+}
+
+
+void Ai::plan() {
+}
+
+
+AiState Ai::state() const {
+	return AiState{ _target, 0, 0 };
+}
+
+
+void Ai::setState(const AiState& state) {
+	_target = state.target;
 }
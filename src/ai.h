@@ -26,19 +26,71 @@
 #include <lair/core/lair.h>
 
 #include "text_moba.h"
+#include "character_store.h"
+
+
+// What an Ai does during a turn, see Ai::decide().
+struct AiAction {
+	enum Type {
+		NONE,
+		ATTACK,
+		MOVE,
+		PLACE,
+	};
+
+	static AiAction none();
+	static AiAction attack(const Character* target);
+	static AiAction moveTo(MapNode* dest);
+	static AiAction goToPlace(Place place);
+
+	Type            type;
+	CharacterHandle target;
+	MapNode*        dest;
+	Place           place;
+};
+
+bool operator==(const AiAction& a0, const AiAction& a1);
+
+
+// The part of an Ai that changes during a game, see GameSnapshot. Subclasses
+// use the fields they need.
+struct AiState {
+	CharacterHandle target;
+	unsigned        status;
+	unsigned        lane;
+};
 
 
 class Ai {
 public:
-	Ai(CharacterSP character);
+	Ai(Character* character);
 	virtual ~Ai();
 
-	CharacterSP character() const;
+	Character* character() const;
+	Character* target() const;
+
+	// Chooses what to do this turn. It may update the Ai, but it must only
+	// read the game: the decisions of several characters may be computed
+	// in parallel, see TextMoba::setPhasedAi().
+	virtual AiAction decide();
+
+	// Does action. Attacks on characters that died or left the node since
+	// the decision are dropped.
+	void apply(const AiAction& action);
+
+	void play();
+
+	// Called at the beginning of each turn for the heroes, outside of
+	// simulations, before anyone played. Does nothing by default.
+	virtual void plan();
 
-	virtual void play();
+	virtual AiState state() const;
+	virtual void setState(const AiState& state);
 
 public:
-	CharacterWP _character;
+	// An Ai is owned by its character, so this is always valid.
+	Character*      _character;
+	CharacterHandle _target;
 };
 
 
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "asset_manifest.h"
+
+
+using namespace lair;
+
+
+AssetManifest::AssetManifest() {
+}
+
+
+void AssetManifest::clear() {
+	_images.clear();
+}
+
+
+const AssetManifest::PathVector& AssetManifest::images() const {
+	return _images;
+}
+
+
+void AssetManifest::addImage(const Path& image) {
+	if(std::find(_images.begin(), _images.end(), image) == _images.end())
+		_images.push_back(image);
+}
+
+
+bool AssetManifest::addEntities(const Path& realPath, const Path& logicPath, Logger& log) {
+	Path::IStream in(realPath.native().c_str());
+	if(!in.good()) {
+		log.error("Unable to read \"", logicPath, "\".");
+		return false;
+	}
+
+	ErrorList errors;
+	LdlParser parser(&in, logicPath.utf8String(), &errors, LdlParser::CTX_MAP);
+
+	Variant entities;
+	bool success = ldlRead(parser, entities);
+	errors.log(log);
+
+	if(success)
+		_addTextures(entities);
+
+	return success;
+}
+
+
+void AssetManifest::_addTextures(const Variant& var) {
+	if(var.isVarMap()) {
+		for(const auto& pair: var.asVarMap())
+			_addTextures(pair.second);
+	}
+	else if(var.isVarList()) {
+		const VarList& list = var.asVarList();
+		// Texture(<type>, '<file>', Sampler(...))
+		if(list.type() == "Texture" && list.size() >= 2 && list[1].isString()) {
+			addImage(list[1].asString());
+			return;
+		}
+		for(const Variant& item: list)
+			_addTextures(item);
+	}
+}
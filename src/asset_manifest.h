@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_ASSET_MANIFEST_H_
+#define LD41_ASSET_MANIFEST_H_
+
+
+#include <vector>
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+#include <lair/core/path.h>
+#include <lair/core/parse.h>
+
+
+// The list of images a state needs before it can start, gathered from the
+// data files so that they can be loaded up front (see SplashState::preload).
+class AssetManifest {
+public:
+	typedef std::vector<lair::Path> PathVector;
+
+public:
+	AssetManifest();
+
+	void clear();
+
+	const PathVector& images() const;
+
+	// Does nothing if image is already in the manifest.
+	void addImage(const lair::Path& image);
+
+	// Adds the files of every Texture(...) found in an entity file.
+	bool addEntities(const lair::Path& realPath, const lair::Path& logicPath,
+	                 lair::Logger& log = lair::dbgLogger);
+
+protected:
+	void _addTextures(const lair::Variant& var);
+
+protected:
+	PathVector _images;
+};
+
+
+#endif
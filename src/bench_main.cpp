@@ -0,0 +1,430 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#include <lair/core/log.h>
+
+#include "map_node.h"
+#include "character.h"
+#include "skill.h"
+#include "game_snapshot.h"
+#include "match_save.h"
+#include "gameplay_bundle.h"
+#include "text_moba.h"
+#include "match_batch.h"
+#include "scenario.h"
+
+
+using namespace lair;
+
+
+// Every allocation of the process goes through here, so benchmarks can
+// report how many allocations they do per iteration.
+static std::atomic<uint64> allocCount(0);
+
+void* operator new(std::size_t size) {
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(size? size: 1);
+	if(!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+
+// Options shared by all benchmarks.
+struct BenchConfig {
+	Path     dataPath;
+	unsigned turns;
+	unsigned maxTurns;
+	unsigned iterations;
+	unsigned seed;
+	String   filter;
+};
+
+
+// Runs `iterations` times `run(i)` and prints the time, the rate and the
+// number of allocations per iteration. `unit` names what an iteration is.
+// Runs at least once, as counts are often scaled down from --iterations.
+template<typename Run>
+void bench(const BenchConfig& config, const char* name, const char* unit,
+           unsigned iterations, Run run) {
+	if(!config.filter.empty() && std::strstr(name, config.filter.c_str()) == nullptr)
+		return;
+
+	iterations = std::max(iterations, 1u);
+
+	uint64 allocs = allocCount.load();
+	auto start = std::chrono::steady_clock::now();
+
+	for(unsigned i = 0; i < iterations; ++i) {
+		run(i);
+	}
+
+	std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+	allocs = allocCount.load() - allocs;
+
+	std::cout << std::left  << std::setw(20) << name
+	          << std::right << std::setw(10) << iterations << " " << std::left << std::setw(6) << unit
+	          << std::right << std::fixed
+	          << std::setprecision(3) << std::setw(10) << time.count() << "s"
+	          << std::setprecision(0) << std::setw(14) << iterations / time.count() << "/s"
+	          << std::setprecision(2) << std::setw(12) << double(allocs) / iterations << " allocs/" << unit
+	          << "\n";
+}
+
+
+// Plays `turns` turns, starting a new match (with the next seed) each time
+// a match ends or lasts more than maxTurns. Restarts are part of the
+// measure, as they are in practice. With crowded waves, some matches never
+// end and redshirts pile up, hence the limit.
+void benchMatch(const BenchConfig& config, const char* name, TextMoba& textMoba) {
+	unsigned seed = config.seed;
+	textMoba.restart("warrior", seed);
+
+	bench(config, name, "turn", config.turns, [&](unsigned) {
+		if(textMoba.isOver() || textMoba._turn >= config.maxTurns)
+			textMoba.restart("warrior", ++seed);
+		textMoba.nextTurn();
+	});
+}
+
+
+// The node with the most characters, where the queries below do the most
+// work.
+MapNode* busiestNode(const TextMoba& textMoba) {
+	MapNode* best = nullptr;
+	for(const CharacterSP& c: textMoba.characters()) {
+		MapNode* node = c->node();
+		if(node && (!best || node->characters().size() > best->characters().size()))
+			best = node;
+	}
+	return best;
+}
+
+
+void benchQueries(const BenchConfig& config, TextMoba& textMoba) {
+	// Play a few waves to get crowded nodes.
+	textMoba.restart("warrior", config.seed);
+	for(unsigned i = 0; i < 100 && !textMoba.isOver(); ++i) {
+		textMoba.nextTurn();
+	}
+
+	MapNode* node = busiestNode(textMoba);
+	if(!node) {
+		dbgLogger.error("No character left on the map.");
+		return;
+	}
+	std::cout << "(queries on " << node->id() << ", with "
+	          << node->characters().size() << " characters)\n";
+
+	const CharacterVector& chars = node->characters();
+
+	// Nodes with characters on them.
+	std::vector<MapNode*> nodes;
+	for(const CharacterSP& c: textMoba.characters()) {
+		if(c->node() && std::find(nodes.begin(), nodes.end(), c->node()) == nodes.end())
+			nodes.push_back(c->node());
+	}
+
+	SkillVector skills;
+	for(const CharacterSP& c: textMoba.characters()) {
+		for(const SkillSP& skill: c->skills()) {
+			if(c->isAlive() && c->node())
+				skills.push_back(skill);
+		}
+	}
+
+	// Prevents the compiler from optimizing the queries away.
+	volatile uintptr_t sink = 0;
+
+	bench(config, "characterGroups", "query", config.iterations, [&](unsigned i) {
+		CharacterGroups groups = node->characterGroups();
+		sink = sink + groups.count(Team(i & 1), Place((i >> 1) & 1));
+	});
+
+	CharacterGroups groups = node->characterGroups();
+	bench(config, "pickClosestEnemy", "query", config.iterations, [&](unsigned i) {
+		const CharacterSP& c = chars[i % chars.size()];
+		sink = sink + uintptr_t(groups.pickClosestEnemy(c.get(), c->range()));
+	});
+
+	// What the look, attack and use commands do to name their targets.
+	bench(config, "characterAt", "query", config.iterations, [&](unsigned i) {
+		sink = sink + uintptr_t(node->characterAt(i % chars.size()).get());
+	});
+
+	bench(config, "characterIndex", "query", config.iterations, [&](unsigned i) {
+		sink = sink + node->characterIndex(chars[i % chars.size()].get());
+	});
+
+	unsigned dirCount = textMoba.directionCount();
+	bench(config, "destination", "query", config.iterations, [&](unsigned i) {
+		sink = sink + uintptr_t(nodes[i % nodes.size()]->destination(i % dirCount));
+	});
+
+	bench(config, "nextHop", "query", config.iterations, [&](unsigned i) {
+		sink = sink + uintptr_t(nodes[i % nodes.size()]->nextHop(Team(i & 1), Lane((i >> 1) & 1)));
+	});
+
+	if(skills.empty()) {
+		dbgLogger.warning("No skill to benchmark.");
+		return;
+	}
+	bench(config, "Skill::targets", "query", config.iterations, [&](unsigned i) {
+		sink = sink + skills[i % skills.size()]->targets().size();
+	});
+}
+
+
+// Saves then restores the game as it is after the queries benchmark, as a
+// search AI does for each simulation.
+void benchSnapshot(const BenchConfig& config, TextMoba& textMoba) {
+	GameSnapshot snapshot;
+	bench(config, "snapshot", "cycle", config.iterations / 100, [&](unsigned) {
+		textMoba.saveSnapshot(snapshot);
+		textMoba.restoreSnapshot(snapshot);
+	});
+}
+
+
+// Writes the game to memory as a checkpoint would, then loads it back.
+void benchMatchSave(const BenchConfig& config, TextMoba& textMoba) {
+	MatchSave save;
+	std::stringstream buffer;
+	bench(config, "save_match", "save", config.iterations / 100, [&](unsigned) {
+		buffer.str(String());
+		textMoba.saveMatch(save);
+		save.write(buffer);
+	});
+	bench(config, "load_match", "load", config.iterations / 100, [&](unsigned) {
+		buffer.seekg(0);
+		save.read(buffer);
+		textMoba.loadMatch(save);
+	});
+}
+
+
+// Compares the ways a game can get its gameplay data: parsing the LDL
+// source, loading a compiled bundle, or sharing an already loaded one.
+void benchGameplay(const BenchConfig& config, const String& data, const Path& logicPath,
+                   Logger& logger) {
+	unsigned iterations = std::max(config.iterations / 10000, 1u);
+
+	std::shared_ptr<GameplayBundle> bundle = std::make_shared<GameplayBundle>();
+	if(!bundle->load(data, logicPath, logger))
+		return;
+	std::ostringstream out;
+	bundle->write(out);
+	String compiled = out.str();
+
+	bench(config, "gameplay_parse", "load", iterations, [&](unsigned) {
+		GameplayBundle parsed;
+		parsed.load(data, logicPath, logger);
+	});
+	bench(config, "gameplay_bundle", "load", iterations, [&](unsigned) {
+		GameplayBundle loaded;
+		loaded.load(compiled, logicPath, logger);
+	});
+	bench(config, "gameplay_shared", "game", iterations, [&](unsigned) {
+		TextMoba textMoba;
+		textMoba.setLogger(&logger);
+		textMoba.initialize(bundle);
+	});
+}
+
+
+// Steps a batch of games in lockstep, the player of each game trying a
+// different action each step. An iteration is a step of the whole batch.
+void benchBatch(const BenchConfig& config, const String& data, const Path& logicPath,
+                Logger& logger) {
+	const unsigned gameCount = 64;
+
+	std::shared_ptr<GameplayBundle> bundle = std::make_shared<GameplayBundle>();
+	if(!bundle->load(data, logicPath, logger))
+		return;
+
+	MatchBatch batch(bundle, gameCount);
+	if(!batch.isValid()) {
+		logger.error("Failed to initialize the games of the batch.");
+		return;
+	}
+	batch.setMaxTurns(config.maxTurns);
+	batch.reset("warrior", config.seed);
+
+	std::vector<BatchAction> actions(gameCount);
+	bench(config, "match_batch", "step", std::max(config.turns / gameCount, 1u), [&](unsigned i) {
+		for(unsigned game = 0; game < gameCount; ++game) {
+			unsigned n = i + game;
+			actions[game] = BatchAction{ uint8(n % 5), uint8(n % 3), uint16(n % 32) };
+		}
+		batch.step(actions.data());
+	});
+}
+
+
+void usage(const char* prog) {
+	std::cerr << "Usage: " << prog << " [options]\n"
+	          << "  --data <dir>        Directory containing gameplay.ldl (default: assets)\n"
+	          << "  --turns <n>         Turns played by each match benchmark (default: 20000)\n"
+	          << "  --max-turns <n>     Start a new match after n turns (default: 1000)\n"
+	          << "  --iterations <n>    Iterations of each query benchmark (default: 1000000)\n"
+	          << "  --seed <n>          Seed of the first match (default: 0)\n"
+	          << "  --filter <string>   Only run the benchmarks whose name contains string\n";
+}
+
+
+int main(int argc, char** argv) {
+	BenchConfig config{ "assets", 20000, 1000, 1000000, 0, String() };
+
+	for(int i = 1; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if(hasValue && std::strcmp(argv[i], "--data") == 0)
+			config.dataPath = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--turns") == 0)
+			config.turns = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--max-turns") == 0)
+			config.maxTurns = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--iterations") == 0)
+			config.iterations = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--seed") == 0)
+			config.seed = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--filter") == 0)
+			config.filter = argv[++i];
+		else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	Path logicPath = config.dataPath / "gameplay.ldl";
+	Path::IStream in(logicPath.native().c_str());
+	if(!in.good()) {
+		dbgLogger.error("Failed to open \"", logicPath.utf8String(), "\".");
+		return EXIT_FAILURE;
+	}
+	std::ostringstream buffer;
+	buffer << in.rdbuf();
+	String data = buffer.str();
+
+	MasterLogger masterLogger;
+	Logger logger("bench", &masterLogger, LogLevel::Warning);
+
+	auto makeTextMoba = [&](const String& data, unsigned redshirtPerLane) {
+		std::unique_ptr<TextMoba> textMoba(new TextMoba);
+		textMoba->setLogger(&logger);
+		textMoba->setLogEvents(false);
+		textMoba->setAutoPlayer(true);
+		std::istringstream dataIn(data);
+		if(!textMoba->initialize(dataIn, logicPath)) {
+			dbgLogger.error("Failed to initialize a game from \"", logicPath.utf8String(), "\".");
+			textMoba.reset();
+		}
+		else if(redshirtPerLane)
+			textMoba->_redshirtPerLane = redshirtPerLane;
+		return textMoba;
+	};
+
+	benchGameplay(config, data, logicPath, logger);
+
+	{
+		auto textMoba = makeTextMoba(data, 0);
+		if(!textMoba)
+			return EXIT_FAILURE;
+		benchMatch(config, "match", *textMoba);
+	}
+	{
+		auto textMoba = makeTextMoba(data, 20);
+		if(!textMoba)
+			return EXIT_FAILURE;
+		benchMatch(config, "match_stress", *textMoba);
+		benchQueries(config, *textMoba);
+		benchSnapshot(config, *textMoba);
+		benchMatchSave(config, *textMoba);
+
+		textMoba->setPhasedAi(true, std::max(1u, std::thread::hardware_concurrency()));
+		benchMatch(config, "match_stress_phased", *textMoba);
+	}
+	{
+		// Search AIs simulate hundreds of turns per turn, play less.
+		auto textMoba = makeTextMoba(data, 0);
+		if(!textMoba)
+			return EXIT_FAILURE;
+		textMoba->setSearchAi(RED);
+		BenchConfig searchConfig = config;
+		searchConfig.turns = std::max(config.turns / 100, 1u);
+		benchMatch(searchConfig, "match_search", *textMoba);
+	}
+	// Generated maps, to check how the turn loop scales with the size of the
+	// map and of the rosters.
+	{
+		ScenarioConfig scenario;
+		scenario.laneLength = 200;
+		auto textMoba = makeTextMoba(generateScenario(data, scenario), 0);
+		if(!textMoba)
+			return EXIT_FAILURE;
+		benchMatch(config, "match_long_lanes", *textMoba);
+	}
+	{
+		ScenarioConfig scenario;
+		scenario.lanes         = 8;
+		scenario.laneLength    = 20;
+		scenario.jungleSpacing = 4;
+		auto textMoba = makeTextMoba(generateScenario(data, scenario), 0);
+		if(!textMoba)
+			return EXIT_FAILURE;
+		benchMatch(config, "match_many_lanes", *textMoba);
+	}
+	{
+		ScenarioConfig scenario;
+		scenario.lanes         = 4;
+		scenario.jungleSpacing = 2;
+		scenario.heroes.clear();
+		for(unsigned i = 0; i < 8; ++i) {
+			scenario.heroes.insert(scenario.heroes.end(), { "ranger", "warrior", "mage" });
+		}
+		auto textMoba = makeTextMoba(generateScenario(data, scenario), 0);
+		if(!textMoba)
+			return EXIT_FAILURE;
+		benchMatch(config, "match_many_heroes", *textMoba);
+	}
+
+	benchBatch(config, data, logicPath, logger);
+
+	return EXIT_SUCCESS;
+}
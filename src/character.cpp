@@ -24,6 +24,7 @@
 #include "map_node.h"
 #include "character_class.h"
 #include "skill.h"
+#include "ai.h"
 
 #include "character.h"
 
@@ -33,17 +34,42 @@ using namespace lair;
 
 Character::Character(TextMoba* textMoba, CharacterClassSP cClass, unsigned index, unsigned level)
     : _textMoba(textMoba)
+    , _store(&textMoba->characterStore())
+    , _handle(_store->create(this))
     , _cClass(cClass)
     , _index(index)
-    , _node(nullptr)
-    , _team(BLUE)
-    , _place(cClass->defaultPlace())
-    , _level(level)
     , _xp(0)
-    , _hp(cClass->maxHP(level))
-    , _mana(cClass->maxMana(level))
-    , _deathTime(0)
+    , _turnsPlayed(0)
+    , _lastTurn(0)
 {
+	_setPlace(cClass->defaultPlace());
+	_setLevel(level);
+	_setHp(cClass->maxHP(level));
+	_setMana(cClass->maxMana(level));
+}
+
+
+void Character::_reset(unsigned index, Team team) {
+	_handle = _store->create(this);
+	_index  = index;
+	_xp     = 0;
+
+	_turnsPlayed = 0;
+	_lastTurn    = 0;
+
+	_setTeam(team);
+	_setPlace(_cClass->defaultPlace());
+	_setLevel(0);
+	_setHp(_cClass->maxHP(0));
+	_setMana(_cClass->maxMana(0));
+
+	_buffs.clear();
+	for(const SkillSP& skill: _skills) {
+		skill->_readyTime = 0;
+	}
+	if(_ai) {
+		_ai->_target = CharacterHandle();
+	}
 }
 
 
@@ -79,8 +105,8 @@ String Character::name(bool showIndex) const {
 
 	out << className();
 
-	if(showIndex && _node)
-		out << " " << _node->characterIndex(shared_from_this());
+	if(showIndex && node())
+		out << " " << node()->characterIndex(this);
 
 	return out.str();
 }
@@ -100,13 +126,18 @@ String Character::shortDesc() const {
 }
 
 
-MapNodeSP Character::node() const {
-	return _node;
+CharacterHandle Character::handle() const {
+	return _handle;
+}
+
+
+MapNode* Character::node() const {
+	return _store->_node[_handle.index];
 }
 
 
 Team Character::team() const {
-	return _team;
+	return _store->_team[_handle.index];
 }
 
 
@@ -116,7 +147,7 @@ Team Character::enemyTeam() const {
 
 
 const String& Character::teamName() const {
-	return ::teamName(_team);
+	return ::teamName(team());
 }
 
 
@@ -126,27 +157,27 @@ bool Character::isPlayer() const {
 
 
 Place Character::place() const {
-	return _place;
+	return _store->_place[_handle.index];
 }
 
 
 const String& Character::placeName() const {
-	return ::placeName(_place);
+	return ::placeName(place());
 }
 
 
 unsigned Character::maxHP() const {
-	return _cClass->maxHP(_level);
+	return _cClass->maxHP(level());
 }
 
 
 unsigned Character::maxMana() const {
-	return _cClass->maxMana(_level);
+	return _cClass->maxMana(level());
 }
 
 
 unsigned Character::level() const {
-	return _level;
+	return _store->_level[_handle.index];
 }
 
 
@@ -156,32 +187,38 @@ unsigned Character::xp() const {
 
 
 unsigned Character::hp() const {
-	return _hp;
+	return _store->_hp[_handle.index];
 }
 
 
 unsigned Character::mana() const {
-	return _mana;
+	return _store->_mana[_handle.index];
 }
 
 
 unsigned Character::damage() const {
-	return _cClass->damage(_level);
+	return _cClass->damage(level());
 }
 
 
 unsigned Character::range() const {
-	return _cClass->range(_level);
+	return _cClass->range(level());
 }
 
 
 bool Character::isAlive() const {
-	return _hp > 0;
+	return hp() > 0;
 }
 
 
 unsigned Character::deathTime() const {
-	return _deathTime;
+	unsigned turn = respawnTurn();
+	return (turn > _textMoba->_turn)? turn - _textMoba->_turn: 0;
+}
+
+
+unsigned Character::respawnTurn() const {
+	return _store->_respawnTurn[_handle.index];
 }
 
 
@@ -200,7 +237,7 @@ SkillSP Character::skill(const String& name) {
 
 
 void Character::addSkill(SkillModelSP model, unsigned level) {
-	SkillSP skill = std::make_shared<Skill>(model, level, shared_from_this());
+	SkillSP skill = std::make_shared<Skill>(model, level, this);
 	_skills.emplace_back(skill);
 }
 
@@ -215,26 +252,61 @@ unsigned Character::placeIndex() const {
 }
 
 
-void Character::moveTo(MapNodeSP dest) {
-	_textMoba->moveCharacter(shared_from_this(), dest);
+void Character::moveTo(MapNode* dest) {
+	_textMoba->moveCharacter(_handle, dest);
 }
 
 
 void Character::goToPlace(Place place) {
-	_textMoba->placeCharacter(shared_from_this(), place);
+	_textMoba->placeCharacter(_handle, place);
+}
+
+
+void Character::attack(CharacterHandle target) {
+	_textMoba->attack(this, target);
+}
+
+
+void Character::takeDamage(unsigned damage, Character* attacker) {
+	_textMoba->dealDamage(_handle, damage, attacker);
+}
+
+
+void Character::heal(unsigned amount, Character* healer) {
+	_textMoba->healCharacter(_handle, amount, healer);
+}
+
+
+void Character::_setNode(MapNode* node) {
+	_store->_node[_handle.index] = node;
+}
+
+
+void Character::_setTeam(Team team) {
+	_store->_team[_handle.index] = team;
+}
+
+
+void Character::_setPlace(Place place) {
+	_store->_place[_handle.index] = place;
+}
+
+
+void Character::_setLevel(unsigned level) {
+	_store->_level[_handle.index] = level;
 }
 
 
-void Character::attack(CharacterSP target) {
-	_textMoba->attack(shared_from_this(), target);
+void Character::_setHp(unsigned hp) {
+	_store->_hp[_handle.index] = hp;
 }
 
 
-void Character::takeDamage(unsigned damage, CharacterSP attacker) {
-	_textMoba->dealDamage(shared_from_this(), damage, attacker);
+void Character::_setMana(unsigned mana) {
+	_store->_mana[_handle.index] = mana;
 }
 
 
-void Character::heal(unsigned amount, CharacterSP healer) {
-	_textMoba->healCharacter(shared_from_this(), amount, healer);
+void Character::_setRespawnTurn(unsigned turn) {
+	_store->_respawnTurn[_handle.index] = turn;
 }
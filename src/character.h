@@ -26,6 +26,7 @@
 #include <lair/core/lair.h>
 
 #include "text_moba.h"
+#include "character_store.h"
 
 class Buff {
 public:
@@ -52,7 +53,9 @@ public:
 	lair::String debugName() const;
 	lair::String shortDesc() const;
 
-	MapNodeSP node() const;
+	CharacterHandle handle() const;
+
+	MapNode* node() const;
 
 	Team team() const;
 	Team enemyTeam() const;
@@ -74,7 +77,9 @@ public:
 	unsigned range() const;
 
 	bool isAlive() const;
+	// Turns before a dead hero respawns, computed from respawnTurn().
 	unsigned deathTime() const;
+	unsigned respawnTurn() const;
 
 	const SkillVector& skills();
 	SkillSP skill(const lair::String& name);
@@ -84,36 +89,48 @@ public:
 
 	template<typename T, typename... Args>
 	AiSP setAi(Args&&... args) {
-		_ai = std::make_shared<T>(shared_from_this(), std::forward<Args>(args)...);
+		_ai = std::make_shared<T>(this, std::forward<Args>(args)...);
 		return _ai;
 	}
 
 	unsigned placeIndex() const;
 
-	void moveTo(MapNodeSP dest);
+	// Only characters on the map can move, see TextMoba::moveCharacter().
+	void moveTo(MapNode* dest);
 	void goToPlace(Place place);
-	void attack(CharacterSP target);
-	void takeDamage(unsigned damage, CharacterSP attacker = nullptr);
-	void heal(unsigned amount, CharacterSP healer = nullptr);
+	void attack(CharacterHandle target);
+	void takeDamage(unsigned damage, Character* attacker = nullptr);
+	void heal(unsigned amount, Character* healer = nullptr);
+
+	// Hot state lives in the CharacterStore. Use TextMoba methods to change
+	// it during a game, these only write the value.
+	void _setNode(MapNode* node);
+	void _setTeam(Team team);
+	void _setPlace(Place place);
+	void _setLevel(unsigned level);
+	void _setHp(unsigned hp);
+	void _setMana(unsigned mana);
+	void _setRespawnTurn(unsigned turn);
+
+	// Gives a removed character a new slot in the store and resets it to the
+	// state of a freshly constructed one. Used to recycle redshirts.
+	void _reset(unsigned index, Team team);
 
 public:
 	TextMoba* _textMoba;
+	CharacterStore* _store;
+	CharacterHandle _handle;
 
 	CharacterClassSP _cClass;
 	unsigned _index;
 
-	MapNodeSP _node;
-	Team     _team;
-
-	Place    _place;
-
-	unsigned _level;
 	unsigned _xp;
 
-	unsigned _hp;
-	unsigned _mana;
-
-	unsigned _deathTime;
+	// Skill cooldowns only run while the character plays, so they are
+	// deadlines on this clock instead of on TextMoba::_turn.
+	unsigned _turnsPlayed;
+	// Last turn this character had its turn, even if it was dead.
+	unsigned _lastTurn;
 
 	BuffVector _buffs;
 	SkillVector _skills;
@@ -19,6 +19,8 @@
  */
 
 
+#include <algorithm>
+
 #include <lair/core/log.h>
 
 #include "map_node.h"
@@ -35,6 +37,11 @@ const String& CharacterClass::id() const {
 }
 
 
+SymbolId CharacterClass::symbol() const {
+	return _symbol;
+}
+
+
 const String& CharacterClass::name() const {
 	return _name;
 }
@@ -85,21 +92,58 @@ const StringVector& CharacterClass::skills() const {
 }
 
 
+const std::vector<SkillModelSP>& CharacterClass::skillModels() const {
+	return _skillModels;
+}
+
+
+unsigned CharacterClass::levelCount() const {
+	return _levels.size();
+}
+
+
+const CharacterClass::LevelStats& CharacterClass::stats(unsigned level) const {
+	return _levels[level];
+}
+
+
 int CharacterClass::maxHP(unsigned level) const {
-	return _maxHP.at(level);
+	return _levels[level].maxHP;
 }
 
 
 int CharacterClass::maxMana(unsigned level) const {
-	return _maxMana.at(level);
+	return _levels[level].maxMana;
 }
 
 
 int CharacterClass::damage(unsigned level) const {
-	return _damage.at(level);
+	return _levels[level].damage;
 }
 
 
 int CharacterClass::range(unsigned level) const {
-	return _range.at(level);
+	return _levels[level].range;
+}
+
+
+static int statAt(const IntVector& stats, unsigned level) {
+	return (level < stats.size())? stats[level]: 0;
+}
+
+
+void CharacterClass::_buildLevels(unsigned levelCount) {
+	levelCount = std::max<unsigned>(levelCount, _maxHP.size());
+	levelCount = std::max<unsigned>(levelCount, _maxMana.size());
+	levelCount = std::max<unsigned>(levelCount, _damage.size());
+	levelCount = std::max<unsigned>(levelCount, _range.size());
+
+	_levels.resize(levelCount);
+	for(unsigned level = 0; level < levelCount; ++level) {
+		LevelStats& stats = _levels[level];
+		stats.maxHP   = statAt(_maxHP,   level);
+		stats.maxMana = statAt(_maxMana, level);
+		stats.damage  = statAt(_damage,  level);
+		stats.range   = statAt(_range,   level);
+	}
 }
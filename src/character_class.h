@@ -29,8 +29,22 @@
 
 
 class CharacterClass {
+public:
+	// The stats of a level, built from the stat lists by _buildLevels(), so
+	// during a game a lookup reads a single 16-byte struct, without checking
+	// the level.
+	struct LevelStats {
+		int maxHP;
+		int maxMana;
+		int damage;
+		int range;
+	};
+
+	typedef std::vector<LevelStats> LevelStatsVector;
+
 public:
 	const lair::String& id() const;
+	SymbolId symbol() const;
 	const lair::String& name() const;
 	int sortIndex() const;
 	CharType type() const;
@@ -45,14 +59,23 @@ public:
 	const lair::String& image() const;
 
 	const StringVector& skills() const;
+	const std::vector<SkillModelSP>& skillModels() const;
+
+	unsigned levelCount() const;
+	// level must be lower than levelCount().
+	const LevelStats& stats(unsigned level) const;
 
 	int maxHP(unsigned level) const;
 	int maxMana(unsigned level) const;
 	int damage(unsigned level) const;
 	int range(unsigned level) const;
 
+	// Pads missing stats with 0, up to at least levelCount levels.
+	void _buildLevels(unsigned levelCount);
+
 public:
 	lair::String _id;
+	SymbolId     _symbol;
 	lair::String _name;
 	int          _sortIndex;
 	CharType     _type;
@@ -68,6 +91,10 @@ public:
 	lair::String _image;
 
 	StringVector _skills;
+	// Resolved from _skills once the skills are loaded.
+	std::vector<SkillModelSP> _skillModels;
+
+	LevelStatsVector _levels;
 };
 
 
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <lair/core/log.h>
+
+#include "character_store.h"
+
+
+using namespace lair;
+
+
+CharacterStore::CharacterStore() {
+}
+
+
+unsigned CharacterStore::slotCount() const {
+	return _character.size();
+}
+
+
+CharacterHandle CharacterStore::create(Character* character) {
+	CharacterHandle handle;
+	if(_freeSlots.empty()) {
+		handle.index      = _character.size();
+		handle.generation = 1;
+
+		_character .push_back(character);
+		_generation.push_back(handle.generation);
+		_node      .push_back(nullptr);
+		_team      .push_back(BLUE);
+		_place     .push_back(BACK);
+		_level     .push_back(0);
+		_hp        .push_back(0);
+		_mana      .push_back(0);
+		_respawnTurn.push_back(0);
+	}
+	else {
+		handle.index      = _freeSlots.back();
+		handle.generation = _generation[handle.index];
+		_freeSlots.pop_back();
+
+		_character[handle.index] = character;
+		_node     [handle.index] = nullptr;
+		_team     [handle.index] = BLUE;
+		_place    [handle.index] = BACK;
+		_level    [handle.index] = 0;
+		_hp       [handle.index] = 0;
+		_mana     [handle.index] = 0;
+		_respawnTurn[handle.index] = 0;
+	}
+	return handle;
+}
+
+
+void CharacterStore::destroy(CharacterHandle handle) {
+	lairAssert(isValid(handle));
+
+	// Skip 0 on wrap-around, it marks invalid handles.
+	unsigned& generation = _generation[handle.index];
+	generation = (generation == unsigned(-1))? 1: generation + 1;
+
+	_pendingSlots.push_back(handle.index);
+}
+
+
+void CharacterStore::collect() {
+	for(unsigned index: _pendingSlots) {
+		_character[index] = nullptr;
+		_freeSlots.push_back(index);
+	}
+	_pendingSlots.clear();
+}
+
+
+void CharacterStore::clear() {
+	_character .clear();
+	_generation.clear();
+	_node      .clear();
+	_team      .clear();
+	_place     .clear();
+	_level     .clear();
+	_hp        .clear();
+	_mana      .clear();
+	_respawnTurn.clear();
+
+	_freeSlots   .clear();
+	_pendingSlots.clear();
+}
+
+
+bool CharacterStore::isValid(CharacterHandle handle) const {
+	return handle.index < _generation.size()
+	    && _generation[handle.index] == handle.generation;
+}
+
+
+Character* CharacterStore::get(CharacterHandle handle) const {
+	return isValid(handle)? _character[handle.index]: nullptr;
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_CHARACTER_STORE_H_
+#define LD41_CHARACTER_STORE_H_
+
+
+#include <lair/core/lair.h>
+
+#include "text_moba.h"
+
+
+// Refers to a slot of a CharacterStore. The generation is incremented each
+// time a slot is freed, so handles to removed characters become invalid
+// instead of pointing to whoever reuses the slot. Generation 0 is never
+// used, so a default-constructed handle is always invalid.
+struct CharacterHandle {
+	unsigned index      = 0;
+	unsigned generation = 0;
+
+	bool operator==(const CharacterHandle& other) const {
+		return index == other.index && generation == other.generation;
+	}
+	bool operator!=(const CharacterHandle& other) const {
+		return !(*this == other);
+	}
+};
+
+
+// Stores the frequently accessed state of every character of a game in
+// contiguous arrays, indexed by CharacterHandle::index.
+//
+// Freed slots are only reused after the next call to collect(), which
+// TextMoba does at the beginning of each turn, so a character removed during
+// a turn can still be safely accessed until the end of this turn.
+class CharacterStore {
+public:
+	CharacterStore();
+
+	unsigned slotCount() const;
+
+	CharacterHandle create(Character* character);
+	void destroy(CharacterHandle handle);
+	void collect();
+	void clear();
+
+	bool isValid(CharacterHandle handle) const;
+	Character* get(CharacterHandle handle) const;
+
+public:
+	std::vector<Character*> _character;
+	std::vector<unsigned>   _generation;
+
+	std::vector<MapNode*>   _node;
+	std::vector<Team>       _team;
+	std::vector<Place>      _place;
+	std::vector<unsigned>   _level;
+	std::vector<unsigned>   _hp;
+	std::vector<unsigned>   _mana;
+	std::vector<unsigned>   _respawnTurn;
+
+private:
+	std::vector<unsigned>   _freeSlots;
+	std::vector<unsigned>   _pendingSlots;
+};
+
+
+#endif
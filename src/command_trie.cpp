@@ -0,0 +1,133 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "tm_command.h"
+
+#include "command_trie.h"
+
+
+using namespace lair;
+
+
+CommandTrie::CommandTrie() {
+	clear();
+}
+
+
+void CommandTrie::clear() {
+	_nodes.clear();
+	_nodes.push_back(Node{ nullptr, nullptr, false, '\0', NO_NODE, NO_NODE });
+}
+
+
+void CommandTrie::insert(const String& name, TMCommand* command) {
+	unsigned node = 0;
+	for(char c: name) {
+		unsigned child = _child(node, c);
+		if(child == NO_NODE) {
+			// Children are kept sorted, so that complete() is alphabetical.
+			child = _nodes.size();
+			_nodes.push_back(Node{ nullptr, nullptr, false, c, NO_NODE, NO_NODE });
+
+			unsigned* link = &_nodes[node].firstChild;
+			while(*link != NO_NODE && _nodes[*link].c < c)
+				link = &_nodes[*link].nextSibling;
+			_nodes[child].nextSibling = *link;
+			*link = child;
+		}
+		node = child;
+
+		Node& n = _nodes[node];
+		if(!n.prefixCommand)
+			n.prefixCommand = command;
+		else if(n.prefixCommand != command)
+			n.ambiguous = true;
+	}
+
+	if(node != 0 && !_nodes[node].command)
+		_nodes[node].command = command;
+}
+
+
+TMCommand* CommandTrie::find(StringView name) const {
+	unsigned node = _findNode(name);
+	if(node == NO_NODE || node == 0)
+		return nullptr;
+
+	const Node& n = _nodes[node];
+	if(n.command)
+		return n.command;
+	return n.ambiguous? nullptr: n.prefixCommand;
+}
+
+
+void CommandTrie::complete(StringView prefix, std::vector<String>& completions) const {
+	unsigned node = _findNode(prefix);
+	if(node == NO_NODE)
+		return;
+
+	CommandVector commands;
+	_collect(node, commands);
+
+	for(TMCommand* command: commands) {
+		if(command->hidden())
+			continue;
+		for(const String& name: command->names()) {
+			if(StringView(name).startsWith(prefix)) {
+				completions.push_back(name);
+				break;
+			}
+		}
+	}
+}
+
+
+unsigned CommandTrie::_child(unsigned node, char c) const {
+	unsigned child = _nodes[node].firstChild;
+	while(child != NO_NODE && _nodes[child].c != c)
+		child = _nodes[child].nextSibling;
+	return child;
+}
+
+
+unsigned CommandTrie::_findNode(StringView prefix) const {
+	unsigned node = 0;
+	for(char c: prefix) {
+		node = _child(node, c);
+		if(node == NO_NODE)
+			break;
+	}
+	return node;
+}
+
+
+void CommandTrie::_collect(unsigned node, CommandVector& commands) const {
+	TMCommand* command = _nodes[node].command;
+	if(command && std::find(commands.begin(), commands.end(), command) == commands.end())
+		commands.push_back(command);
+
+	for(unsigned child = _nodes[node].firstChild; child != NO_NODE;
+	    child = _nodes[child].nextSibling) {
+		_collect(child, commands);
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_COMMAND_TRIE_H_
+#define LD41_COMMAND_TRIE_H_
+
+
+#include <vector>
+
+#include <lair/core/lair.h>
+
+#include "string_view.h"
+
+
+class TMCommand;
+
+
+// Maps the names of the commands to the commands, and any prefix shared by
+// the names of a single command too, so that "at" finds "attack". Nodes are
+// stored in a flat vector with one child list per node; lookups walk at most
+// one node per character and do not allocate.
+class CommandTrie {
+public:
+	CommandTrie();
+
+	void clear();
+	void insert(const lair::String& name, TMCommand* command);
+
+	// Returns the command called name or, if name is the prefix of the names
+	// of a single command, this command. Returns nullptr otherwise.
+	TMCommand* find(StringView name) const;
+
+	// Appends a name for each visible command that has a name starting with
+	// prefix, in alphabetical order. Names are the first of TMCommand::names()
+	// that matches.
+	void complete(StringView prefix, std::vector<lair::String>& completions) const;
+
+private:
+	static const unsigned NO_NODE = unsigned(-1);
+
+	struct Node {
+		TMCommand* command;       // Command called by this exact name.
+		TMCommand* prefixCommand; // Command of all the names below.
+		bool       ambiguous;     // Names below belong to several commands.
+		char       c;
+		unsigned   firstChild;
+		unsigned   nextSibling;
+	};
+	typedef std::vector<Node> NodeVector;
+	typedef std::vector<TMCommand*> CommandVector;
+
+private:
+	unsigned _child(unsigned node, char c) const;
+	unsigned _findNode(StringView prefix) const;
+	void _collect(unsigned node, CommandVector& commands) const;
+
+private:
+	NodeVector _nodes;
+};
+
+
+#endif
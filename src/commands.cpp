@@ -19,6 +19,8 @@
  */
 
 
+#include <algorithm>
+#include <cstdlib>
 #include <functional>
 
 #include <lair/core/log.h>
@@ -81,7 +83,7 @@ HelpCommand::HelpCommand(TextMoba* textMoba)
 	_desc = "  Prints this help message.";
 }
 
-bool HelpCommand::exec(const StringVector& /*args*/) {
+bool HelpCommand::exec(const CommandArgs& /*args*/) {
 	for(auto cmd: tm()->commands()) {
 		print(join(cmd->names()));
 		print(cmd->desc());
@@ -101,7 +103,7 @@ InfoCommand::InfoCommand(TextMoba* textMoba)
 	_desc = "  Information about game mechanics.";
 }
 
-bool InfoCommand::exec(const StringVector& args) {
+bool InfoCommand::exec(const CommandArgs& args) {
 	if(args.size() != 2) {
 		print("Available topic (use \"", args[0], "\" <topic>\":");
 		for(const auto& pair: tm()->infos()) {
@@ -109,7 +111,7 @@ bool InfoCommand::exec(const StringVector& args) {
 		}
 	}
 	else {
-		const String* info = tm()->infos(args[1]);
+		const String* info = tm()->infos(args[1].str());
 		if(info) {
 			print(*info);
 		}
@@ -134,14 +136,14 @@ LookCommand::LookCommand(TextMoba* textMoba)
 	        "  Example: look tower (describe a tower)";
 }
 
-bool LookCommand::exec(const StringVector& args) {
+bool LookCommand::exec(const CommandArgs& args) {
 	if(!player()->isAlive()) {
 		print("You are dead... Please use the command \"wait\" until you respawn.");
 		return true;
 	}
 
 	if(args.size() == 1) {
-		MapNodeSP node = player()->node();
+		MapNode* node = player()->node();
 		print("You are at ", node->name(), ".");
 
 		print("Here, there is");
@@ -151,7 +153,7 @@ bool LookCommand::exec(const StringVector& args) {
 			print("  ", i, ": ",
 			      "[", c->placeName(), "] ", c->name(false), " (lvl ",
 			      c->level() + 1, ", ", c->hp(), " / ", c->maxHP(), ")",
-			      " dist: ", groups.distanceBetween(player(), c)
+			      " dist: ", groups.distanceBetween(player().get(), c.get())
 			);
 			i += 1;
 		}
@@ -172,7 +174,7 @@ DirectionsCommand::DirectionsCommand(TextMoba* textMoba)
 	_desc = "  List the destinations you can reach from here.";
 }
 
-bool DirectionsCommand::exec(const StringVector& /*args*/) {
+bool DirectionsCommand::exec(const CommandArgs& /*args*/) {
 	if(!player()->isAlive()) {
 		print("You are dead... Please use the command \"wait\" until you respawn.");
 		return true;
@@ -193,11 +195,38 @@ WaitCommand::WaitCommand(TextMoba* textMoba)
 	_names.emplace_back("wait");
 	_names.emplace_back("w");
 
-	_desc = "  Do nothing until next turn.";
+	_desc = "  Do nothing until next turn. \"wait N\" waits N turns and\n"
+	        "  \"wait respawn\" waits until you respawn.";
 }
 
-bool WaitCommand::exec(const StringVector& /*args*/) {
-	_textMoba->nextTurn();
+bool WaitCommand::exec(const CommandArgs& args) {
+	if(args.size() > 2) {
+		print(args[0], " takes 0 or 1 parameter.");
+		return true;
+	}
+
+	if(args.size() == 1) {
+		_textMoba->nextTurn();
+		return true;
+	}
+
+	if(args[1] == "respawn" || args[1] == "until-respawn") {
+		if(player()->isAlive()) {
+			print("You are not dead.");
+			return true;
+		}
+		_textMoba->fastForward(unsigned(-1), true);
+		return true;
+	}
+
+	int    count  = 0;
+	size_t parsed = 0;
+	if(!parseInt(args[1], count, &parsed) || parsed != args[1].size() || count <= 0) {
+		print("Invalid number of turns \"", args[1], "\".");
+		return true;
+	}
+
+	_textMoba->fastForward(count);
 	return true;
 }
 
@@ -213,7 +242,7 @@ GoCommand::GoCommand(TextMoba* textMoba)
 	        "  you can go. Example: go red (go toward the red base)";
 }
 
-bool GoCommand::exec(const StringVector& args) {
+bool GoCommand::exec(const CommandArgs& args) {
 	if(!player()->isAlive()) {
 		print("You are dead... Please use the command \"wait\" until you respawn.");
 		return true;
@@ -224,9 +253,9 @@ bool GoCommand::exec(const StringVector& args) {
 		print("  ", args[0], " <direction>");
 	}
 	else {
-		String dir = toLower(args[1]);
-		MapNodeSP node = player()->node();
-		MapNodeSP dest = node->destination(dir);
+		String dir = toLower(args[1].str());
+		MapNode* node = player()->node();
+		MapNode* dest = node->destination(tm()->directionId(dir));
 		if(dest) {
 			tm()->moveCharacter(player(), dest);
 			tm()->execCommand("look");
@@ -252,7 +281,7 @@ MoveCommand::MoveCommand(TextMoba* textMoba)
 	        "  character to the front/back row.";
 }
 
-bool MoveCommand::exec(const StringVector& args) {
+bool MoveCommand::exec(const CommandArgs& args) {
 	if(!player()->isAlive()) {
 		print("You are dead... Please use the command \"wait\" until you respawn.");
 		return true;
@@ -269,7 +298,7 @@ bool MoveCommand::exec(const StringVector& args) {
 			return true;
 		}
 		else {
-			tm()->placeCharacter(player(), place);
+			tm()->placeCharacter(player()->handle(), place);
 			tm()->nextTurn();
 		}
 	}
@@ -289,7 +318,7 @@ AttackCommand::AttackCommand(TextMoba* textMoba)
 	        "  see when you run the command look.";
 }
 
-bool AttackCommand::exec(const StringVector& args) {
+bool AttackCommand::exec(const CommandArgs& args) {
 	if(!player()->isAlive()) {
 		print("You are dead... Please use the command \"wait\" until you respawn.");
 		return true;
@@ -302,11 +331,8 @@ bool AttackCommand::exec(const StringVector& args) {
 		print("when you type \"look\".");
 	}
 	else {
-		unsigned index = 9999;
-		try {
-			index = std::stoi(args[1]);
-		}
-		catch(std::invalid_argument) {
+		int index = 9999;
+		if(!parseInt(args[1], index)) {
 			print("I don't understand who you try to attack.");
 			return true;
 		}
@@ -324,12 +350,12 @@ bool AttackCommand::exec(const StringVector& args) {
 		}
 
 		CharacterGroups groups = player()->node()->characterGroups();
-		if(groups.distanceBetween(player(), target) > player()->range()) {
+		if(groups.distanceBetween(player().get(), target.get()) > player()->range()) {
 			print("Target out of range.");
 			return true;
 		}
 
-		player()->attack(target);
+		player()->attack(target->handle());
 		tm()->nextTurn();
 	}
 
@@ -349,7 +375,7 @@ UseCommand::UseCommand(TextMoba* textMoba)
 	        "    use bomb front";
 }
 
-bool UseCommand::exec(const StringVector& args) {
+bool UseCommand::exec(const CommandArgs& args) {
 	if(!player()->isAlive()) {
 		print("You are dead... Please use the command \"wait\" until you respawn.");
 		return true;
@@ -360,7 +386,7 @@ bool UseCommand::exec(const StringVector& args) {
 		print("  ", args[0], " <skill-name> [<character-number>|front|back]");
 	}
 	else {
-		SkillSP skill = player()->skill(args[1]);
+		SkillSP skill = player()->skill(args[1].str());
 		if(!skill) {
 			print("You don't have a skill called ", args[1]);
 			return true;
@@ -379,11 +405,8 @@ bool UseCommand::exec(const StringVector& args) {
 				return true;
 			}
 
-			unsigned charIndex = 9999;
-			try {
-				charIndex = std::stoi(args[2]);
-			}
-			catch(std::invalid_argument) {
+			int charIndex = 9999;
+			if(!parseInt(args[2], charIndex)) {
 				print("I don't understand who you're trying to attack.");
 				return true;
 			}
@@ -425,7 +448,7 @@ bool UseCommand::exec(const StringVector& args) {
 			return true;
 		}
 
-		player()->_mana -= skill->manaCost();
+		player()->_setMana(player()->mana() - skill->manaCost());
 		skill->useOn(targets);
 		tm()->nextTurn();
 	}
@@ -435,6 +458,48 @@ bool UseCommand::exec(const StringVector& args) {
 
 
 
+PerfCommand::PerfCommand(TextMoba* textMoba)
+    : TMCommand(textMoba)
+{
+	_names.emplace_back("perf");
+
+	_desc = "  Show the time spent in each phase of the last turns.\n"
+	        "  \"perf reset\" clears the statistics, \"perf on\" and \"perf off\"\n"
+	        "  start and stop profiling and \"perf save <file>\" writes them to file.";
+}
+
+bool PerfCommand::exec(const CommandArgs& args) {
+	TurnProfiler& profiler = tm()->profiler();
+
+	if(args.size() == 1) {
+		if(!profiler.isEnabled())
+			print("Profiling is disabled, use \"", args[0], " on\" to enable it.");
+
+		std::ostringstream out;
+		profiler.write(out);
+		print(out.str());
+	}
+	else if(args.size() == 2 && args[1] == "reset") {
+		profiler.clear();
+	}
+	else if(args.size() == 2 && (args[1] == "on" || args[1] == "off")) {
+		profiler.setEnabled(args[1] == "on");
+	}
+	else if(args.size() == 3 && args[1] == "save") {
+		if(profiler.save(args[2].str()))
+			print("Profile saved to ", args[2], ".");
+		else
+			print("Failed to save profile to ", args[2], ".");
+	}
+	else {
+		print("Usage: ", args[0], " [reset|on|off|save <file>]");
+	}
+
+	return true;
+}
+
+
+
 RestartCommand::RestartCommand(TextMoba* textMoba)
     : TMCommand(textMoba)
     , _readClass(false)
@@ -444,7 +509,7 @@ RestartCommand::RestartCommand(TextMoba* textMoba)
 	_desc = "  Restart the game.";
 }
 
-bool RestartCommand::exec(const StringVector& args) {
+bool RestartCommand::exec(const CommandArgs& args) {
 	if(!_readClass && args.size() == 1) {
 		print("Choose your class: [ warrior, ranger, mage ]");
 		_readClass = true;
@@ -453,10 +518,10 @@ bool RestartCommand::exec(const StringVector& args) {
 
 	String className;
 	if(!_readClass && args.size() == 2) {
-		className = args[1];
+		className = args[1].str();
 	}
 	else if(_readClass && args.size() == 1) {
-		className = args[0];
+		className = args[0].str();
 	}
 	else if(!_readClass) {
 		print(args[0], " takes 0 or 1 parameter.");
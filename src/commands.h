@@ -32,7 +32,7 @@
 	class _name : public TMCommand { \
 	public: \
 	    _name(TextMoba* textMoba); \
-	    virtual bool exec(const StringVector& args) override; \
+	    virtual bool exec(const CommandArgs& args) override; \
 	};
 
 
@@ -45,11 +45,12 @@ DECL_COMMAND(GoCommand)
 DECL_COMMAND(MoveCommand)
 DECL_COMMAND(AttackCommand)
 DECL_COMMAND(UseCommand)
+DECL_COMMAND(PerfCommand)
 
 class RestartCommand : public TMCommand {
 public:
     RestartCommand(TextMoba* textMoba);
-    virtual bool exec(const StringVector& args) override;
+    virtual bool exec(const CommandArgs& args) override;
 
 public:
     bool _readClass;
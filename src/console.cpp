@@ -19,6 +19,7 @@
  */
 
 
+#include <algorithm>
 #include <functional>
 
 #include <lair/core/log.h>
@@ -31,17 +32,27 @@
 using namespace lair;
 
 
-String Console::inputPrefix = "> ";
-
-
-Console::Console()
-    : _cursorPos(inputPrefix.size())
+Console::Console(const String& inputPrefix, unsigned maxLines, unsigned maxBytes)
+    : _inputPrefix(inputPrefix)
+    , _cursorPos(inputPrefix.size())
+    , _version(0)
+    , _maxBytes(maxBytes)
+    , _lines(std::max(maxLines, 1u))
+    , _firstSlot(0)
+    , _lineCount(0)
+    , _firstLine(0)
+    , _byteCount(0)
     , _inputSize(inputPrefix.size())
     , _input(inputPrefix)
 {
 }
 
 
+const String& Console::inputPrefix() const {
+	return _inputPrefix;
+}
+
+
 unsigned Console::cursorPos() const {
 	return _cursorPos;
 }
@@ -50,16 +61,43 @@ unsigned Console::cursorPos() const {
 void Console::setCursorPos(unsigned pos) {
 	lairAssert(pos < _inputSize + 1);
 	_cursorPos = pos;
+	++_version;
 }
 
 
-unsigned Console::lineCount() const {
+unsigned Console::version() const {
+	return _version;
+}
+
+
+unsigned Console::maxLines() const {
 	return _lines.size();
 }
 
 
+unsigned Console::maxBytes() const {
+	return _maxBytes;
+}
+
+
+unsigned Console::lineCount() const {
+	return _lineCount;
+}
+
+
+unsigned Console::firstLine() const {
+	return _firstLine;
+}
+
+
+unsigned Console::endLine() const {
+	return _firstLine + _lineCount;
+}
+
+
 const String& Console::line(unsigned i) const {
-	return _lines.at(i);
+	lairAssert(i >= _firstLine && i < endLine());
+	return _lines[(_firstSlot + i - _firstLine) % _lines.size()];
 }
 
 
@@ -70,18 +108,12 @@ void Console::writeLine(const String& line) {
 
 	for(; it != end; ++it) {
 		if(*it == '\n') {
-			_lines.emplace_back(lineBegin, it);
-			if(onAddLine)
-				onAddLine(_lines.back());
-//			dbgLogger.log(_lines.back());
+			_addLine(lineBegin, it);
 			lineBegin = it + 1;
 		}
 	}
 
-	_lines.emplace_back(lineBegin, it);
-	if(onAddLine)
-		onAddLine(_lines.back());
-//	dbgLogger.log(_lines.back());
+	_addLine(lineBegin, it);
 }
 
 
@@ -100,12 +132,23 @@ void Console::setExecCommand(const ExecCommand& execCommand) {
 }
 
 
+const Console::CompleteCommand& Console::completeCommand() const {
+	return _completeCommand;
+}
+
+
+void Console::setCompleteCommand(const CompleteCommand& completeCommand) {
+	_completeCommand = completeCommand;
+}
+
+
 void Console::inputText(const String& text) {
 	auto it = nextCharacter(_input, _input.begin(), _cursorPos);
 	unsigned count = charCount(text);
 	_input.insert(it, text.begin(), text.end());
 	_inputSize += count;
 	_cursorPos += count;
+	++_version;
 
 	if(onUpdateInput)
 		onUpdateInput(_input);
@@ -119,9 +162,10 @@ void Console::backspace() {
 	auto end   = nextCharacter(_input, _input.begin(), _cursorPos);
 	auto begin = prevCharacter(_input, end);
 
-	if(begin != end && begin - _input.begin() >= int( inputPrefix.size())) {
+	if(begin != end && begin - _input.begin() >= int( _inputPrefix.size())) {
 		_input.erase(begin, end);
 		_cursorPos -= 1;
+		++_version;
 		if(onUpdateInput)
 			onUpdateInput(_input);
 	}
@@ -132,7 +176,8 @@ void Console::backspace() {
 
 
 void Console::moveCursor(int offset) {
-	_cursorPos = clamp<int>(_cursorPos + offset, inputPrefix.size(), _inputSize);
+	_cursorPos = clamp<int>(_cursorPos + offset, _inputPrefix.size(), _inputSize);
+	++_version;
 
 //	int index = nextCharacter(_input, 0, _cursorPos);
 //	dbgLogger.warning("Input: ", _input.substr(0, index), "#", _input.substr(index));
@@ -142,30 +187,104 @@ void Console::moveCursor(int offset) {
 void Console::execLine() {
 	writeLine(_input);
 	if(_execCommand)
-		_execCommand(_input.substr(inputPrefix.size()));
+		_execCommand(_input.substr(_inputPrefix.size()));
 
-	_input = inputPrefix;
+	_input = _inputPrefix;
 	_inputSize = 0;
-	_cursorPos = inputPrefix.size();
+	_cursorPos = _inputPrefix.size();
+	++_version;
 
 	if(onUpdateInput)
 		onUpdateInput(_input);
 }
 
 
+void Console::complete() {
+	// Only the command name, while the cursor is at its end.
+	String word = _input.substr(_inputPrefix.size());
+	if(!_completeCommand || word.empty()
+	|| nextCharacter(_input, _input.begin(), _cursorPos) != _input.end()
+	|| word.find(' ') != String::npos)
+		return;
+
+	StringVector completions;
+	_completeCommand(word, completions);
+	if(completions.empty())
+		return;
+
+	// Extend to the longest common prefix of the candidates.
+	String common = completions.front();
+	for(const String& completion: completions) {
+		unsigned size = 0;
+		while(size < common.size() && size < completion.size()
+		      && common[size] == completion[size])
+			++size;
+		common.resize(size);
+	}
+
+	if(completions.size() == 1)
+		inputText(common.substr(word.size()) + " ");
+	else if(common.size() > word.size())
+		inputText(common.substr(word.size()));
+	else {
+		String line;
+		for(const String& completion: completions)
+			line += "  " + completion;
+		writeLine(line);
+	}
+}
+
+
+void Console::_addLine(String::const_iterator begin, String::const_iterator end) {
+	unsigned size = end - begin;
+	while(_lineCount == _lines.size()
+	      || (_lineCount && _byteCount + size > _maxBytes)) {
+		_removeFirstLine();
+	}
+
+	String& line = _lines[(_firstSlot + _lineCount) % _lines.size()];
+	line.assign(begin, end);
+	_lineCount += 1;
+	_byteCount += size;
+	++_version;
+
+	if(onAddLine)
+		onAddLine(line);
+//	dbgLogger.log(line);
+}
+
+
+void Console::_removeFirstLine() {
+	if(onRemoveLine)
+		onRemoveLine();
+
+	String& line = _lines[_firstSlot];
+	_byteCount -= line.size();
+	// Release the memory, not just the content.
+	String().swap(line);
+
+	_firstSlot  = (_firstSlot + 1) % _lines.size();
+	_lineCount -= 1;
+	_firstLine += 1;
+	++_version;
+}
+
+
 
 ConsoleView::ConsoleView(Console* console, unsigned width, unsigned height)
     : _console(console)
     , _width(width)
     , _height(height)
     , _scrollPos(-1)
+    , _version(0)
 {
 	using namespace std::placeholders;
 
 	_console->onAddLine     = std::bind(&ConsoleView::_addLine,     this, _1);
+	_console->onRemoveLine  = std::bind(&ConsoleView::_removeLine,  this);
 	_console->onUpdateInput = std::bind(&ConsoleView::_updateInput, this, _1);
 
-	_inputLines.emplace_back();
+	_inputLines.emplace_back(ViewLine{ 0, 0, 0 });
 
 	_updateInput(_console->input());
 }
@@ -186,18 +305,21 @@ String ConsoleView::text(Vector2i* cursor) const {
 	int end = std::min<int>(offset + _height, _viewLines.size());
 	int row = 0;
 	for(int i = offset; i < end; ++i, ++row) {
+		const ViewLine& vl = _viewLines[i];
 		text.push_back('\n');
-		text.append(_viewLines[i]);
+		text.append(_console->line(vl.line), vl.begin, vl.end - vl.begin);
 	}
 
 	end = std::min<int>(_inputLines.size(), _height - row);
 	unsigned inputPos = 0;
 	unsigned consoleCursor = _console->cursorPos();
+	const String& input = _console->input();
 	for(int i = 0; i < end; ++i, ++row) {
+		const ViewLine& vl = _inputLines[i];
 		text.push_back('\n');
-		text.append(_inputLines[i]);
+		text.append(input, vl.begin, vl.end - vl.begin);
 
-		unsigned size = charCount(_inputLines[i]);
+		unsigned size = charCount(input.substr(vl.begin, vl.end - vl.begin));
 		if(cursor && inputPos <= consoleCursor) {
 			*cursor = Vector2i(consoleCursor - inputPos,
 			                   row);
@@ -212,6 +334,12 @@ String ConsoleView::text(Vector2i* cursor) const {
 }
 
 
+unsigned ConsoleView::version() const {
+	// Both only grow, so the sum changes whenever one of them does.
+	return _console->version() + _version;
+}
+
+
 int ConsoleView::scrollPos() const {
 	return _scrollPos;
 }
@@ -231,12 +359,15 @@ int ConsoleView::maxScrollPos() const {
 
 
 void ConsoleView::scrollTo(int scrollPos) {
+	int prevScrollPos = _scrollPos;
 	if(scrollPos < maxScrollPos()) {
 		_scrollPos = scrollPos;
 	}
 	else {
 		_scrollPos = -1;
 	}
+	if(_scrollPos != prevScrollPos)
+		++_version;
 }
 
 
@@ -252,24 +383,34 @@ void ConsoleView::scroll(int offset) {
 
 
 void ConsoleView::_addLine(const String& line) {
-	_viewFromConsole.emplace_back(_viewLines.size());
-	_appendLines(_viewLines, line);
+	_appendLines(_viewLines, _console->endLine() - 1, line);
+}
+
+
+void ConsoleView::_removeLine() {
+	unsigned line = _console->firstLine();
+	while(!_viewLines.empty() && _viewLines.front().line == line) {
+		_viewLines.pop_front();
+		// Keep showing the same lines if the view is not at the bottom.
+		if(_scrollPos > 0)
+			_scrollPos -= 1;
+	}
 }
 
 
 void ConsoleView::_updateInput(const String& input) {
 	_inputLines.clear();
-	_appendLines(_inputLines, input);
+	_appendLines(_inputLines, 0, input);
 	scrollTo(-1);
 }
 
 
-void ConsoleView::_appendLines(StringDeque& lines, const String& line) {
+void ConsoleView::_appendLines(ViewLineDeque& lines, unsigned lineIndex, const String& line) {
 	auto it        = line.begin();
 	auto end       = line.end();
 
 	if(it == end) {
-		lines.emplace_back();
+		lines.emplace_back(ViewLine{ lineIndex, 0, 0 });
 	}
 
 	while(it != end) {
@@ -292,6 +433,6 @@ void ConsoleView::_appendLines(StringDeque& lines, const String& line) {
 
 		unsigned b = lineBegin - line.begin();
 		unsigned e = lineEnd - line.begin();
-		lines.emplace_back(line.substr(b, e - b));
+		lines.emplace_back(ViewLine{ lineIndex, b, e });
 	}
 }
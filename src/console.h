@@ -29,22 +29,38 @@
 #include <lair/core/lair.h>
 
 
+// The scrollback keeps at most maxLines lines and maxBytes bytes of text;
+// the oldest lines are dropped to make room for new ones. Lines are
+// numbered from the beginning of the session, so line(i) is valid for
+// firstLine() <= i < endLine().
 class Console {
 public:
 	typedef std::function<void(const lair::String&)> ExecCommand;
+	typedef std::function<void(const lair::String&, std::vector<lair::String>&)>
+	                                                 CompleteCommand;
 
 	typedef std::function<void(const lair::String&)> AddLineCallback;
+	typedef std::function<void()>                    RemoveLineCallback;
 	typedef std::function<void(const lair::String&)> UpdateInputCallback;
 
-	static lair::String inputPrefix;
-
 public:
-	Console();
+	Console(const lair::String& inputPrefix = "> ",
+	        unsigned maxLines = 4096, unsigned maxBytes = 1 << 18);
+
+	const lair::String& inputPrefix() const;
 
 	unsigned cursorPos() const;
 	void setCursorPos(unsigned pos);
 
+	// Incremented each time the lines, the input or the cursor change.
+	unsigned version() const;
+
+	unsigned maxLines() const;
+	unsigned maxBytes() const;
+
 	unsigned lineCount() const;
+	unsigned firstLine() const;
+	unsigned endLine() const;
 	const lair::String& line(unsigned i) const;
 	void writeLine(const lair::String& line);
 
@@ -53,26 +69,46 @@ public:
 	const ExecCommand& execCommand() const;
 	void setExecCommand(const ExecCommand& execCommand);
 
+	const CompleteCommand& completeCommand() const;
+	void setCompleteCommand(const CompleteCommand& completeCommand);
+
 	void inputText(const lair::String& text);
 	void backspace();
 	void moveCursor(int offset);
 
 	void execLine();
+	// Completes the command name being typed, or lists the candidates.
+	void complete();
 
 public:
 	AddLineCallback     onAddLine;
+	// Called before the oldest line is dropped.
+	RemoveLineCallback  onRemoveLine;
 	UpdateInputCallback onUpdateInput;
 
 private:
-	typedef std::deque<lair::String> StringDeque;
+	typedef std::vector<lair::String> StringVector;
 
 private:
+	void _addLine(lair::String::const_iterator begin, lair::String::const_iterator end);
+	void _removeFirstLine();
+
+private:
+	lair::String _inputPrefix;
 	unsigned     _cursorPos;
-	StringDeque  _lines;
+	unsigned     _version;
+	unsigned     _maxBytes;
+	// Ring buffer of maxLines slots, starting at _firstSlot.
+	StringVector _lines;
+	unsigned     _firstSlot;
+	unsigned     _lineCount;
+	unsigned     _firstLine;
+	unsigned     _byteCount;
 	unsigned     _inputSize;
 	lair::String _input;
 
-	ExecCommand _execCommand;
+	ExecCommand     _execCommand;
+	CompleteCommand _completeCommand;
 };
 
 
@@ -83,6 +119,9 @@ public:
 	unsigned lineCount() const;
 	lair::String text(lair::Vector2i* cursor = nullptr) const;
 
+	// Changes each time text() would return something else.
+	unsigned version() const;
+
 	int scrollPos() const;
 	int realScrollPos() const;
 	int maxScrollPos() const;
@@ -90,23 +129,31 @@ public:
 	void scroll(int offset);
 
 	void _addLine(const lair::String& line);
+	void _removeLine();
 	void _updateInput(const lair::String& input);
 
 private:
-	typedef std::deque<unsigned>     UnsignedDeque;
-	typedef std::deque<lair::String> StringDeque;
+	// A wrapped line: the [begin, end) bytes of a console line (or of the
+	// input line).
+	struct ViewLine {
+		unsigned line;
+		unsigned begin;
+		unsigned end;
+	};
+
+	typedef std::deque<ViewLine> ViewLineDeque;
 
 private:
-	void _appendLines(StringDeque& lines, const lair::String& line);
+	void _appendLines(ViewLineDeque& lines, unsigned lineIndex, const lair::String& line);
 
 private:
 	Console*      _console;
 	unsigned      _width;
 	unsigned      _height;
-	UnsignedDeque _viewFromConsole;
-	StringDeque   _viewLines;
-	StringDeque   _inputLines;
+	ViewLineDeque _viewLines;
+	ViewLineDeque _inputLines;
 	int           _scrollPos;
+	unsigned      _version;
 };
 
 
@@ -0,0 +1,284 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <lair/core/log.h>
+
+#include "character_class.h"
+#include "character.h"
+#include "skill.h"
+#include "replay.h"
+
+#include "event_recorder.h"
+
+
+using namespace lair;
+
+
+// File layout: magic, version, the string table and the record count as
+// varints, then the records as fixed-size little-endian fields, oldest
+// first.
+
+static const char     eventsMagic[4] = { 'T', 'M', 'E', 'V' };
+static const unsigned eventsVersion  = 1;
+
+
+static const char* eventTypeNames[] = {
+    "spawn",
+    "leave",
+    "enter",
+    "place",
+    "attack",
+    "skill",
+    "skill_target",
+    "skill_damage",
+    "skill_heal",
+    "skill_dot",
+    "skill_hot",
+    "kill",
+    "death",
+    "dead_turn",
+    "xp",
+    "level_up",
+    "wave",
+};
+
+
+static void writeUint(std::ostream& out, uint32 value, unsigned size) {
+	for(unsigned i = 0; i < size; ++i) {
+		out.put(char(value & 0xff));
+		value >>= 8;
+	}
+}
+
+
+static uint32 readUint(const unsigned char* data, unsigned size) {
+	uint32 value = 0;
+	for(unsigned i = 0; i < size; ++i) {
+		value |= uint32(data[i]) << (8 * i);
+	}
+	return value;
+}
+
+
+EventRecorder::EventRecorder(TextMoba* textMoba, unsigned capacity)
+    : _textMoba(textMoba)
+    , _buffer(std::max(capacity, 1u))
+    , _count(0)
+{
+}
+
+
+unsigned EventRecorder::capacity() const {
+	return _buffer.size();
+}
+
+
+uint64 EventRecorder::recordCount() const {
+	return _count;
+}
+
+
+EventRecorder::RecordVector EventRecorder::records() const {
+	RecordVector records;
+	if(_count <= _buffer.size()) {
+		records.assign(_buffer.begin(), _buffer.begin() + _count);
+	}
+	else {
+		unsigned first = _count % _buffer.size();
+		records.assign(_buffer.begin() + first, _buffer.end());
+		records.insert(records.end(), _buffer.begin(), _buffer.begin() + first);
+	}
+	return records;
+}
+
+
+const StringVector& EventRecorder::names() const {
+	return _names;
+}
+
+
+void EventRecorder::clear() {
+	_count = 0;
+	_names.clear();
+	_nameIds.clear();
+}
+
+
+void EventRecorder::record(const GameEvent& event) {
+	Record& record = _buffer[_count % _buffer.size()];
+	++_count;
+
+	record.turn   = _textMoba? _textMoba->_turn: 0;
+	record.type   = event.type;
+	record.name   = NO_NAME;
+	record.source = event.source? event.source->index(): NO_CHARACTER;
+	record.target = event.target? event.target->index(): NO_CHARACTER;
+	record.value  = event.value;
+
+	if(event.skill) {
+		record.name = _intern(event.skill->_model.get(), event.skill->id());
+	}
+	else if(event.type == EVENT_SPAWN) {
+		const CharacterClass* cClass = event.target->cClass().get();
+		record.name = _intern(cClass, cClass->id());
+	}
+}
+
+
+String EventRecorder::decode(const Record& record) const {
+	std::ostringstream out;
+	out << "[" << record.turn << "] ";
+	if(record.type < sizeof(eventTypeNames) / sizeof(*eventTypeNames))
+		out << eventTypeNames[record.type];
+	else
+		out << "<unknown " << record.type << ">";
+
+	if(record.name != NO_NAME)
+		out << " " << ((record.name < _names.size())? _names[record.name]: "<unknown>");
+	if(record.source != NO_CHARACTER)
+		out << " from " << record.source;
+	if(record.target != NO_CHARACTER)
+		out << " on " << record.target;
+	out << ": " << record.value;
+
+	return out.str();
+}
+
+
+bool EventRecorder::write(std::ostream& out) const {
+	out.write(eventsMagic, sizeof(eventsMagic));
+	writeVarint(out, eventsVersion);
+
+	writeVarint(out, _names.size());
+	for(const String& name: _names) {
+		writeString(out, name);
+	}
+
+	RecordVector records = this->records();
+	writeVarint(out, records.size());
+	for(const Record& record: records) {
+		writeUint(out, record.turn,   4);
+		writeUint(out, record.type,   2);
+		writeUint(out, record.name,   2);
+		writeUint(out, record.source, 4);
+		writeUint(out, record.target, 4);
+		writeUint(out, record.value,  4);
+	}
+
+	return bool(out);
+}
+
+
+bool EventRecorder::read(std::istream& in) {
+	char magic[sizeof(eventsMagic)];
+	in.read(magic, sizeof(magic));
+	if(!in || std::memcmp(magic, eventsMagic, sizeof(magic)) != 0) {
+		dbgLogger.error("EventRecorder: invalid file.");
+		return false;
+	}
+
+	uint64 version;
+	if(!readVarint(in, version) || version != eventsVersion) {
+		dbgLogger.error("EventRecorder: unsupported version ", version, ".");
+		return false;
+	}
+
+	clear();
+
+	uint64 nameCount;
+	if(!readVarint(in, nameCount) || nameCount > NO_NAME) {
+		dbgLogger.error("EventRecorder: truncated string table.");
+		return false;
+	}
+	_names.resize(nameCount);
+	for(String& name: _names) {
+		if(!readString(in, name)) {
+			dbgLogger.error("EventRecorder: truncated string table.");
+			return false;
+		}
+	}
+
+	uint64 count;
+	if(!readVarint(in, count) || count > (1 << 28)) {
+		dbgLogger.error("EventRecorder: truncated record list.");
+		return false;
+	}
+	_buffer.resize(std::max<uint64>(count, 1));
+	for(uint64 i = 0; i < count; ++i) {
+		unsigned char data[20];
+		in.read(reinterpret_cast<char*>(data), sizeof(data));
+		if(!in) {
+			dbgLogger.error("EventRecorder: truncated record list.");
+			return false;
+		}
+
+		Record& record = _buffer[i];
+		record.turn   = readUint(data +  0, 4);
+		record.type   = readUint(data +  4, 2);
+		record.name   = readUint(data +  6, 2);
+		record.source = readUint(data +  8, 4);
+		record.target = readUint(data + 12, 4);
+		record.value  = readUint(data + 16, 4);
+	}
+	_count = count;
+
+	return true;
+}
+
+
+bool EventRecorder::save(const Path& path) const {
+	std::ofstream out(path.utf8String().c_str(), std::ios::binary);
+	if(!out.good()) {
+		dbgLogger.error("Unable to write \"", path.utf8String(), "\".");
+		return false;
+	}
+	return write(out);
+}
+
+
+bool EventRecorder::load(const Path& path) {
+	Path::IStream in(path.native().c_str(), std::ios::binary);
+	if(!in.good()) {
+		dbgLogger.error("Unable to read \"", path.utf8String(), "\".");
+		return false;
+	}
+	return read(in);
+}
+
+
+uint16 EventRecorder::_intern(const void* key, const String& name) {
+	auto it = _nameIds.find(key);
+	if(it != _nameIds.end())
+		return it->second;
+
+	if(_names.size() >= NO_NAME)
+		return NO_NAME;
+
+	uint16 id = _names.size();
+	_names.push_back(name);
+	_nameIds.emplace(key, id);
+	return id;
+}
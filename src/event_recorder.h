@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_EVENT_RECORDER_H_
+#define LD41_EVENT_RECORDER_H_
+
+
+#include <unordered_map>
+
+#include <lair/core/lair.h>
+#include <lair/core/path.h>
+
+#include "text_moba.h"
+#include "game_event.h"
+
+
+// Keeps the last game events as fixed-size binary records in a ring
+// buffer. Recording copies a few integers and formats nothing, so it can
+// stay enabled in production; records are turned into text offline with
+// decode(). Class and skill ids are interned in a string table saved along
+// the records.
+class EventRecorder {
+public:
+	struct Record {
+		lair::uint32 turn;
+		lair::uint16 type;
+		lair::uint16 name;   // Class for EVENT_SPAWN, skill for skill events.
+		lair::uint32 source; // Character::index(), or NO_CHARACTER.
+		lair::uint32 target;
+		lair::uint32 value;
+	};
+
+	typedef std::vector<Record> RecordVector;
+
+	static const lair::uint16 NO_NAME      = 0xffff;
+	static const lair::uint32 NO_CHARACTER = 0xffffffff;
+
+public:
+	EventRecorder(TextMoba* textMoba = nullptr, unsigned capacity = 1 << 16);
+
+	unsigned capacity() const;
+	lair::uint64 recordCount() const;
+	RecordVector records() const;
+	const StringVector& names() const;
+
+	void clear();
+	void record(const GameEvent& event);
+
+	lair::String decode(const Record& record) const;
+
+	bool write(std::ostream& out) const;
+	bool read(std::istream& in);
+
+	bool save(const lair::Path& path) const;
+	bool load(const lair::Path& path);
+
+private:
+	lair::uint16 _intern(const void* key, const lair::String& name);
+
+private:
+	typedef std::unordered_map<const void*, lair::uint16> NameMap;
+
+	TextMoba*    _textMoba;
+	RecordVector _buffer;
+	lair::uint64 _count;
+
+	StringVector _names;
+	NameMap      _nameIds;
+};
+
+
+#endif
@@ -87,6 +87,7 @@ void Game::initialize() {
 	_splashState->addSplash("TitleScreen.png");
 
 	_mainState->initialize();
+	_splashState->preload(_mainState->manifest());
 }
 
 
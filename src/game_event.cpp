@@ -0,0 +1,197 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "map_node.h"
+#include "character.h"
+#include "skill.h"
+#include "gameplay_log.h"
+
+#include "game_event.h"
+
+
+using namespace lair;
+
+
+EventPrinter::EventPrinter(TextMoba* textMoba)
+    : _textMoba(textMoba)
+    , _skillVisible(false)
+{
+}
+
+
+void EventPrinter::operator()(const GameEvent& event) {
+	TextMoba*     tm     = _textMoba;
+	Character*    player = tm->player().get();
+	Character*    source = event.source;
+	Character*    target = event.target;
+
+	// Turns are summarized instead, see TextMoba::fastForward().
+	if(tm->isFastForwarding())
+		return;
+
+	// Whether a moving character is seen by the (living) player.
+	auto seesMove = [player, target]() {
+		return player && target != player && player->isAlive()
+		        && target->type() != BUILDING
+		        && target->node() == player->node();
+	};
+
+	switch(event.type) {
+	case EVENT_SPAWN:
+		break;
+	case EVENT_LEAVE:
+		if(seesMove())
+			tm->print(target->name(), " leaves the area.");
+		break;
+	case EVENT_ENTER:
+		if(seesMove())
+			tm->print(target->name(false), " enters the area.");
+		break;
+	case EVENT_PLACE:
+		if(player && player->isAlive() && target->node() == player->node()) {
+			tm->print(target->name(), " moves to the ", placeName(Place(event.value)), " row.");
+		}
+		break;
+	case EVENT_ATTACK:
+		if(source->node() == player->node()) {
+			tm->print(source->name(), " attack ", target->name(), " for ",
+			          event.value, " damage.");
+		}
+		break;
+	case EVENT_SKILL:
+		if(player->isAlive() && source->node() == player->node()) {
+			tm->print(source->name(), " uses ", event.skill->name(), "...");
+		}
+		break;
+	case EVENT_SKILL_TARGET:
+		_skillVisible = player->isAlive() && source->node() == player->node();
+		break;
+	case EVENT_SKILL_DAMAGE:
+		if(_skillVisible)
+			tm->print("  ", target->name(), " takes ", event.value, " damage.");
+		break;
+	case EVENT_SKILL_HEAL:
+		if(_skillVisible)
+			tm->print("  ", target->name(), " heal ", event.value, " hp.");
+		break;
+	case EVENT_SKILL_DOT:
+		if(_skillVisible)
+			tm->print("  ", target->name(), " will take ", event.value, " damage for 3 turns.");
+		break;
+	case EVENT_SKILL_HOT:
+		if(_skillVisible)
+			tm->print("  ", target->name(), " regenerates ", event.value, " hp for 3 turns.");
+		break;
+	case EVENT_KILL:
+		if(target->type() == HERO || target->node() == player->node()) {
+			if(source)
+				tm->print(source->name(), " killed ", target->name(), ".");
+			else
+				tm->print(target->name(), " killed.");
+		}
+		break;
+	case EVENT_DEATH:
+	case EVENT_DEAD_TURN:
+		break;
+	case EVENT_XP:
+		if(target == player)
+			tm->print(target->name(), " gains ", event.value, " xp.");
+		break;
+	case EVENT_LEVEL_UP:
+		tm->print(target->name(), " reaches lvl ", target->level() + 1);
+		break;
+	case EVENT_WAVE:
+		if(event.value == BLUE)
+			tm->print("A new batch of blueshirts is leaving the fonxus.");
+		else
+			tm->print("A new batch of redshirts is leaving the fonxus.");
+		break;
+	}
+}
+
+
+void logGameEvent(Logger& log, const GameEvent& event) {
+	Character* source = event.source;
+	Character* target = event.target;
+
+	switch(event.type) {
+	case EVENT_SPAWN:
+		gpLog(log, "Spawn ", target->teamName(), " ", target->className(),
+		      " ", target->index(), " at ", target->node()? target->node()->name(): "<nowhere>");
+		break;
+	case EVENT_ATTACK:
+		gpLog(log, source->debugName(), " attack ", target->debugName(),
+		      " for ", event.value, " damage.");
+		break;
+	case EVENT_SKILL_TARGET:
+		gpLog(log, source->debugName(), " uses skill ", event.skill->id(), " lvl ", event.skill->level(),
+		      " on ", target->debugName());
+		break;
+	case EVENT_KILL:
+		if(source)
+			gpLog(log, source->name(), " killed ", target->name(), ".");
+		else
+			gpLog(log, target->debugName(), " killed.");
+		break;
+	case EVENT_DEATH:
+		gpDebug(log, target->debugName(), " death time ", event.value);
+		break;
+	case EVENT_DEAD_TURN:
+		gpDebug(log, target->debugName(), " death time: ", event.value);
+		break;
+	default:
+		break;
+	}
+}
+
+
+void summarizeGameEvent(TurnSummary& summary, const GameEvent& event,
+                        const Character* player) {
+	const Character* source = event.source;
+	const Character* target = event.target;
+
+	switch(event.type) {
+	case EVENT_KILL:
+		if(source && source == player)
+			summary.kills += 1;
+		if(target->type() == HERO)
+			summary.heroKills[target->team()] += 1;
+		break;
+	case EVENT_DEATH:
+		if(target == player)
+			summary.deaths += 1;
+		break;
+	case EVENT_XP:
+		if(target == player)
+			summary.xp += event.value;
+		break;
+	case EVENT_LEVEL_UP:
+		if(target == player)
+			summary.levelUps += 1;
+		break;
+	case EVENT_WAVE:
+		if(event.value == RED)
+			summary.waves += 1;
+		break;
+	default:
+		break;
+	}
+}
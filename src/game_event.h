@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_GAME_EVENT_H_
+#define LD41_GAME_EVENT_H_
+
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+
+#include "text_moba.h"
+
+
+enum GameEventType {
+	EVENT_SPAWN,        // target spawned (at its node, if any).
+	EVENT_LEAVE,        // target is about to leave its node.
+	EVENT_ENTER,        // target arrived in its node.
+	EVENT_PLACE,        // target is about to move to row value.
+	EVENT_ATTACK,       // source attacks target for value damage.
+	EVENT_SKILL,        // source uses skill.
+	EVENT_SKILL_TARGET, // source uses skill on target.
+	EVENT_SKILL_DAMAGE, // target is about to take value damage from skill.
+	EVENT_SKILL_HEAL,   // target is about to heal value hp from skill.
+	EVENT_SKILL_DOT,    // target will take value damage for 3 turns.
+	EVENT_SKILL_HOT,    // target will regenerate value hp for 3 turns.
+	EVENT_KILL,         // target killed, by source if not null.
+	EVENT_DEATH,        // target (a hero) is dead for value turns.
+	EVENT_DEAD_TURN,    // target is dead for value more turns.
+	EVENT_XP,           // target gains value xp.
+	EVENT_LEVEL_UP,     // target reached a new level.
+	EVENT_WAVE,         // redshirts of team value leave their fonxus.
+};
+
+
+// Something that happened during a game. Events only hold pointers and
+// numbers, listeners format them if they need to, and they must do so
+// immediately: pointed data is only valid during the call.
+struct GameEvent {
+	GameEventType type;
+	Character*    source;
+	Character*    target;
+	const Skill*  skill;
+	unsigned      value;
+};
+
+
+// Prints events the way the player sees them, i.e. only those that happen
+// where the player is.
+class EventPrinter {
+public:
+	EventPrinter(TextMoba* textMoba);
+
+	void operator()(const GameEvent& event);
+
+public:
+	TextMoba* _textMoba;
+	// Whether the effects of the skill being used are printed.
+	bool      _skillVisible;
+};
+
+
+void logGameEvent(lair::Logger& log, const GameEvent& event);
+
+// Accumulates in summary the events that matter to player.
+void summarizeGameEvent(TurnSummary& summary, const GameEvent& event,
+                        const Character* player);
+
+
+#endif
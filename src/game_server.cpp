@@ -0,0 +1,555 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "console.h"
+#include "text_moba.h"
+#include "gameplay_bundle.h"
+
+#include "game_server.h"
+
+
+using namespace lair;
+
+
+enum {
+	// Longer lines close the session, nobody types that much.
+	MAX_LINE_SIZE    = 1024,
+	// Output waiting for a client that does not read.
+	MAX_OUTPUT_SIZE  = 1 << 20,
+	// Turns a single "wait" may play, so a session does not hold its worker
+	// for long.
+	MAX_FAST_FORWARD = 100,
+	MAX_EVENTS       = 64,
+};
+
+// The few bytes of the telnet protocol we need to skip option negotiation.
+enum {
+	TELNET_SE   = 240,
+	TELNET_SB   = 250,
+	TELNET_WILL = 251,
+	TELNET_DONT = 254,
+	TELNET_IAC  = 255,
+};
+
+enum TelnetState {
+	TELNET_DATA,
+	TELNET_COMMAND,
+	TELNET_OPTION,
+	TELNET_SUBNEGOTIATION,
+	TELNET_SUBNEGOTIATION_IAC,
+};
+
+
+struct GameServer::Session {
+	Session(int fd, unsigned seed)
+	    : fd(fd)
+	    , seed(seed)
+	    , console("> ", 256, 1 << 16)
+	    , textMoba(&console)
+	    , sent(0)
+	    , telnet(TELNET_DATA)
+	    , closing(false)
+	    , closed(false)
+	    , writing(false)
+	{
+		console.onAddLine = [this](const String& line) {
+			output.append(line);
+			output.append("\r\n");
+		};
+	}
+
+	int         fd;
+	// Drawn by the accepting thread, the game is set up by the worker.
+	unsigned    seed;
+	Console     console;
+	TextMoba    textMoba;
+
+	// Received bytes of the line being typed.
+	String      input;
+	// Bytes [sent, output.size()) are waiting to be sent.
+	String      output;
+	size_t      sent;
+	TelnetState telnet;
+	// Closed once the output is sent, e.g. after "quit".
+	bool        closing;
+	bool        closed;
+	// Set while the socket is polled for EPOLLOUT.
+	bool        writing;
+};
+
+
+struct GameServer::Worker {
+	Worker()
+	    : logBackend(std::clog)
+	    , masterLogger()
+	    , logger("server", &masterLogger, LogLevel::Warning)
+	    , epollFd(-1)
+	    , wakeFd(-1)
+	    , sessionCount(0)
+	    , stopping(false)
+	{
+		masterLogger.addBackend(&logBackend);
+	}
+
+	// Each worker writes its own messages to std::clog.
+	lair::OStreamLogger logBackend;
+	lair::MasterLogger  masterLogger;
+	lair::Logger        logger;
+
+	int         epollFd;
+	// Written to when there are new sessions or the server stops.
+	int         wakeFd;
+	std::thread thread;
+
+	std::mutex             mutex;
+	std::vector<Session*>  incoming;
+
+	std::unordered_map<int, SessionUP> sessions;
+	std::atomic<unsigned> sessionCount;
+	std::atomic<bool>     stopping;
+};
+
+
+static void wake(int eventFd) {
+	uint64_t one = 1;
+	ssize_t written = ::write(eventFd, &one, sizeof(one));
+	(void)written;
+}
+
+
+static void drain(int eventFd) {
+	uint64_t count;
+	ssize_t size = ::read(eventFd, &count, sizeof(count));
+	(void)size;
+}
+
+
+static bool pollFd(int epollFd, int op, int fd, uint32_t events) {
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events  = events;
+	event.data.fd = fd;
+	return epoll_ctl(epollFd, op, fd, &event) == 0;
+}
+
+
+
+GameServer::GameServer(const Path& logicPath, unsigned threadCount, unsigned maxSessions)
+    : _logicPath(logicPath)
+    , _threadCount(threadCount)
+    , _maxSessions(maxSessions)
+    , _seeds(std::time(nullptr))
+    , _listenFd(-1)
+    , _epollFd(-1)
+    , _stopFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+	if(_threadCount == 0)
+		_threadCount = std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+GameServer::~GameServer() {
+	if(_listenFd >= 0)
+		::close(_listenFd);
+	if(_epollFd >= 0)
+		::close(_epollFd);
+	if(_stopFd >= 0)
+		::close(_stopFd);
+}
+
+
+unsigned GameServer::threadCount() const {
+	return _threadCount;
+}
+
+
+unsigned GameServer::sessionCount() const {
+	unsigned count = 0;
+	for(const WorkerUP& worker: _workers) {
+		count += worker->sessionCount;
+	}
+	return count;
+}
+
+
+bool GameServer::listen(unsigned port) {
+	// Sessions share the gameplay data, parsed once.
+	std::shared_ptr<GameplayBundle> gameplay = std::make_shared<GameplayBundle>();
+	if(!gameplay->load(_logicPath, dbgLogger))
+		return false;
+	_gameplay = gameplay;
+
+	_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(_listenFd < 0) {
+		dbgLogger.error("Failed to create socket: ", std::strerror(errno));
+		return false;
+	}
+
+	int one = 1;
+	setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port        = htons(port);
+	if(bind(_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+	        || ::listen(_listenFd, SOMAXCONN) != 0) {
+		dbgLogger.error("Failed to listen on port ", port, ": ", std::strerror(errno));
+		return false;
+	}
+
+	dbgLogger.info("Listening on port ", port, " with ", _threadCount, " threads.");
+	return true;
+}
+
+
+void GameServer::run() {
+	_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if(_epollFd < 0 || _stopFd < 0 || _listenFd < 0
+	        || !pollFd(_epollFd, EPOLL_CTL_ADD, _listenFd, EPOLLIN)
+	        || !pollFd(_epollFd, EPOLL_CTL_ADD, _stopFd, EPOLLIN)) {
+		dbgLogger.error("Failed to start the server: ", std::strerror(errno));
+		return;
+	}
+
+	for(unsigned i = 0; i < _threadCount; ++i) {
+		_workers.emplace_back(new Worker);
+		Worker* worker = _workers.back().get();
+		worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+		worker->wakeFd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		pollFd(worker->epollFd, EPOLL_CTL_ADD, worker->wakeFd, EPOLLIN);
+		worker->thread = std::thread(&GameServer::_work, this, worker);
+	}
+
+	bool running = true;
+	while(running) {
+		epoll_event events[MAX_EVENTS];
+		int count = epoll_wait(_epollFd, events, MAX_EVENTS, -1);
+		if(count < 0 && errno != EINTR) {
+			dbgLogger.error("epoll_wait failed: ", std::strerror(errno));
+			break;
+		}
+
+		for(int i = 0; i < count; ++i) {
+			if(events[i].data.fd == _stopFd)
+				running = false;
+			else
+				_accept();
+		}
+	}
+
+	dbgLogger.info("Stopping the server, ", sessionCount(), " sessions open.");
+	for(WorkerUP& worker: _workers) {
+		worker->stopping = true;
+		wake(worker->wakeFd);
+	}
+	for(WorkerUP& worker: _workers) {
+		worker->thread.join();
+		::close(worker->epollFd);
+		::close(worker->wakeFd);
+	}
+	_workers.clear();
+}
+
+
+void GameServer::stop() {
+	wake(_stopFd);
+}
+
+
+void GameServer::_accept() {
+	while(true) {
+		sockaddr_in addr;
+		socklen_t addrSize = sizeof(addr);
+		int fd = accept4(_listenFd, reinterpret_cast<sockaddr*>(&addr), &addrSize,
+		                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				dbgLogger.warning("accept failed: ", std::strerror(errno));
+			return;
+		}
+
+		if(sessionCount() >= _maxSessions) {
+			static const char full[] = "The server is full, try again later.\r\n";
+			ssize_t sent = send(fd, full, sizeof(full) - 1, MSG_NOSIGNAL);
+			(void)sent;
+			::close(fd);
+			continue;
+		}
+
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		char ip[INET_ADDRSTRLEN] = "?";
+		inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+		dbgLogger.info("New session from ", ip, ":", ntohs(addr.sin_port), ".");
+
+		// From now on, the session only runs on its worker.
+		Worker*  worker  = _leastBusyWorker();
+		Session* session = new Session(fd, _seeds());
+
+		worker->sessionCount += 1;
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			worker->incoming.push_back(session);
+		}
+		wake(worker->wakeFd);
+	}
+}
+
+
+GameServer::Worker* GameServer::_leastBusyWorker() {
+	Worker* best = _workers.front().get();
+	for(const WorkerUP& worker: _workers) {
+		if(worker->sessionCount < best->sessionCount)
+			best = worker.get();
+	}
+	return best;
+}
+
+
+void GameServer::_work(Worker* worker) {
+	while(!worker->stopping) {
+		epoll_event events[MAX_EVENTS];
+		int count = epoll_wait(worker->epollFd, events, MAX_EVENTS, -1);
+		if(count < 0 && errno != EINTR) {
+			worker->logger.error("epoll_wait failed: ", std::strerror(errno));
+			break;
+		}
+
+		for(int i = 0; i < count; ++i) {
+			int fd = events[i].data.fd;
+			if(fd == worker->wakeFd) {
+				drain(worker->wakeFd);
+				_adoptSessions(worker);
+				continue;
+			}
+
+			auto it = worker->sessions.find(fd);
+			if(it == worker->sessions.end())
+				continue;
+			Session* session = it->second.get();
+
+			if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				_read(session);
+			if(!session->closed)
+				_flush(worker, session);
+			if(session->closed)
+				_closeSession(worker, session);
+		}
+	}
+
+	// Sessions handed over while stopping are closed as well.
+	_adoptSessions(worker);
+	while(!worker->sessions.empty()) {
+		Session* session = worker->sessions.begin()->second.get();
+		session->output.append("\r\nThe server is shutting down, bye !\r\n");
+		_flush(worker, session);
+		_closeSession(worker, session);
+	}
+}
+
+
+void GameServer::_adoptSessions(Worker* worker) {
+	std::vector<Session*> incoming;
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		incoming.swap(worker->incoming);
+	}
+
+	for(Session* session: incoming) {
+		worker->sessions.emplace(session->fd, SessionUP(session));
+		if(!pollFd(worker->epollFd, EPOLL_CTL_ADD, session->fd, EPOLLIN)) {
+			worker->logger.error("Failed to poll a session: ", std::strerror(errno));
+			_closeSession(worker, session);
+			continue;
+		}
+
+		// Starting the game prints the welcome message.
+		TextMoba& textMoba = session->textMoba;
+		textMoba.setLogger(&worker->logger);
+		textMoba.setLogEvents(false);
+		textMoba.setMaxFastForward(MAX_FAST_FORWARD);
+		textMoba.seed(session->seed);
+		if(textMoba.initialize(_gameplay)) {
+			session->output.append(session->console.inputPrefix());
+		}
+		else {
+			session->output.append("Failed to start a game, sorry.\r\n");
+			session->closing = true;
+		}
+		_flush(worker, session);
+		if(session->closed)
+			_closeSession(worker, session);
+	}
+}
+
+
+// Reads once per event, so a client that sends a lot does not starve the
+// others: the socket stays readable and is polled again.
+void GameServer::_read(Session* session) {
+	char buffer[4096];
+	ssize_t size = recv(session->fd, buffer, sizeof(buffer), 0);
+	if(size > 0)
+		_receive(session, buffer, size);
+	else if(size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+		session->closed = true;
+}
+
+
+void GameServer::_receive(Session* session, const char* data, unsigned size) {
+	for(unsigned i = 0; i < size && !session->closing; ++i) {
+		unsigned char c = data[i];
+
+		switch(session->telnet) {
+		case TELNET_DATA:
+			if(c == TELNET_IAC)
+				session->telnet = TELNET_COMMAND;
+			else if(c == '\n')
+				_execLine(session);
+			else if(c == '\b' || c == 0x7f) {
+				if(!session->input.empty())
+					session->input.pop_back();
+			}
+			else if(c != '\r' && c != '\0')
+				session->input.push_back(c);
+			break;
+		case TELNET_COMMAND:
+			// IAC IAC escapes a 0xff data byte.
+			if(c == TELNET_IAC) {
+				session->input.push_back(c);
+				session->telnet = TELNET_DATA;
+			}
+			else if(c == TELNET_SB)
+				session->telnet = TELNET_SUBNEGOTIATION;
+			else if(c >= TELNET_WILL && c <= TELNET_DONT)
+				session->telnet = TELNET_OPTION;
+			else
+				session->telnet = TELNET_DATA;
+			break;
+		case TELNET_OPTION:
+			session->telnet = TELNET_DATA;
+			break;
+		case TELNET_SUBNEGOTIATION:
+			if(c == TELNET_IAC)
+				session->telnet = TELNET_SUBNEGOTIATION_IAC;
+			break;
+		case TELNET_SUBNEGOTIATION_IAC:
+			session->telnet = (c == TELNET_SE)? TELNET_DATA: TELNET_SUBNEGOTIATION;
+			break;
+		}
+
+		if(session->input.size() > MAX_LINE_SIZE) {
+			session->output.append("Line too long, bye !\r\n");
+			session->closing = true;
+		}
+	}
+}
+
+
+void GameServer::_execLine(Session* session) {
+	String line;
+	line.swap(session->input);
+
+	if(line == "quit" || line == "exit") {
+		session->output.append("Bye !\r\n");
+		session->closing = true;
+		return;
+	}
+
+	if(!line.empty())
+		session->textMoba.execInput(line);
+	session->output.append(session->console.inputPrefix());
+}
+
+
+void GameServer::_flush(Worker* worker, Session* session) {
+	while(session->sent < session->output.size()) {
+		ssize_t size = send(session->fd, session->output.data() + session->sent,
+		                    session->output.size() - session->sent, MSG_NOSIGNAL);
+		if(size > 0) {
+			session->sent += size;
+		}
+		else if(size < 0 && errno == EINTR) {
+			continue;
+		}
+		else if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
+		else {
+			session->closed = true;
+			return;
+		}
+	}
+
+	size_t pending = session->output.size() - session->sent;
+	if(pending == 0) {
+		session->output.clear();
+		session->sent = 0;
+		if(session->closing) {
+			session->closed = true;
+			return;
+		}
+	}
+	else if(pending > MAX_OUTPUT_SIZE) {
+		session->closed = true;
+		return;
+	}
+	else if(session->sent > pending) {
+		session->output.erase(0, session->sent);
+		session->sent = 0;
+	}
+
+	bool writing = pending != 0;
+	if(writing != session->writing) {
+		pollFd(worker->epollFd, EPOLL_CTL_MOD, session->fd,
+		       writing? EPOLLIN | EPOLLOUT: EPOLLIN);
+		session->writing = writing;
+	}
+}
+
+
+void GameServer::_closeSession(Worker* worker, Session* session) {
+	int fd = session->fd;
+	epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	::close(fd);
+
+	worker->sessions.erase(fd);
+	worker->sessionCount -= 1;
+}
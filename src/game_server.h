@@ -0,0 +1,107 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_GAME_SERVER_H_
+#define LD41_GAME_SERVER_H_
+
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+#include <lair/core/path.h>
+
+#include "text_moba.h"
+
+
+// Hosts a game per TCP connection, MUD style: players connect with telnet
+// (or netcat), type commands and receive what the console would show.
+//
+// The gameplay data is loaded once by listen() and shared by all the games.
+// The main thread only accepts connections: each session is handed to the
+// worker thread with the fewest sessions, which starts its game and owns it
+// until it is closed. A session whose game can not start is told so and
+// dropped. Workers wait on their sockets with epoll and never block on a
+// client: output that can not be sent yet is buffered, and clients that
+// stop reading are dropped.
+//
+// Linux only, as it relies on epoll and eventfd.
+class GameServer {
+public:
+	GameServer(const lair::Path& logicPath, unsigned threadCount = 0,
+	           unsigned maxSessions = 1024);
+	GameServer(const GameServer&) = delete;
+	~GameServer();
+
+	GameServer& operator=(const GameServer&) = delete;
+
+	unsigned threadCount() const;
+	unsigned sessionCount() const;
+
+	// Loads the gameplay data and opens the listening socket. Returns false
+	// on error.
+	bool listen(unsigned port);
+
+	// Serves clients until stop() is called.
+	void run();
+
+	// Can be called from any thread, and from a signal handler.
+	void stop();
+
+private:
+	struct Session;
+	struct Worker;
+
+	typedef std::unique_ptr<Session> SessionUP;
+	typedef std::unique_ptr<Worker>  WorkerUP;
+	typedef std::vector<WorkerUP>    WorkerVector;
+
+private:
+	void _accept();
+	Worker* _leastBusyWorker();
+
+	void _work(Worker* worker);
+	void _adoptSessions(Worker* worker);
+	void _read(Session* session);
+	void _receive(Session* session, const char* data, unsigned size);
+	void _execLine(Session* session);
+	void _flush(Worker* worker, Session* session);
+	void _closeSession(Worker* worker, Session* session);
+
+private:
+	lair::Path   _logicPath;
+	GameplayBundleCSP _gameplay;
+	unsigned     _threadCount;
+	unsigned     _maxSessions;
+	std::mt19937 _seeds;
+
+	int          _listenFd;
+	int          _epollFd;
+	int          _stopFd;
+
+	WorkerVector _workers;
+};
+
+
+#endif
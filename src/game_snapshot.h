@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_GAME_SNAPSHOT_H_
+#define LD41_GAME_SNAPSHOT_H_
+
+
+#include <random>
+
+#include <lair/core/lair.h>
+
+#include "text_moba.h"
+#include "character_store.h"
+#include "character.h"
+#include "ai.h"
+
+
+// The state of a game at some point, see TextMoba::saveSnapshot() and
+// TextMoba::restoreSnapshot().
+//
+// Everything that does not change during a match (the map, classes, skill
+// models, the character objects themselves) is shared with the game. Only
+// the mutable state is copied, into flat arrays which keep their capacity
+// when a snapshot is saved again: once warmed up, saving does not allocate
+// and restoring only allocates to rebuild the character sets.
+class GameSnapshot {
+public:
+	struct CharacterState {
+		CharacterSP     character;
+		CharacterHandle handle;
+		unsigned        index;
+		unsigned        xp;
+		unsigned        turnsPlayed;
+		unsigned        lastTurn;
+		// Ranges in _buffs and _readyTimes.
+		unsigned        buffBegin;
+		unsigned        skillBegin;
+		AiState         ai;
+	};
+
+	typedef std::vector<CharacterState> CharacterStateVector;
+
+public:
+	GameSnapshot();
+
+	bool isValid() const;
+
+	// Drops the references to the characters, so killed redshirts can be
+	// recycled by the game, but keeps the memory for the next save.
+	void release();
+
+public:
+	bool         _valid;
+
+	unsigned     _turn;
+	unsigned     _nextWaveTurn;
+	Team         _winner;
+	unsigned     _charIndex;
+	std::mt19937 _rng;
+
+	CharacterStore _store;
+
+	// In the order of TextMoba::characters().
+	CharacterStateVector  _characters;
+	CharacterVector       _killedCharacters;
+	CharacterVector       _redshirtPool[2];
+	BuffVector            _buffs;
+	std::vector<unsigned> _readyTimes;
+};
+
+
+#endif
@@ -0,0 +1,866 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <lair/core/log.h>
+#include <lair/core/parse.h>
+
+#include "character_class.h"
+#include "skill.h"
+#include "replay.h"
+
+#include "gameplay_bundle.h"
+
+
+using namespace lair;
+
+
+// File layout: magic, version, the hash of the LDL source and the gameplay
+// data as varints and strings, like replays, then a 64-bit little-endian
+// hash of everything before it.
+
+static const char     bundleMagic[4] = { 'T', 'M', 'G', 'B' };
+static const unsigned bundleVersion  = 2;
+
+
+// TODO: Move this to Lair
+
+
+const Variant& getVarItem(const Variant& var, const String& key, bool* success = nullptr) {
+	if(!var.isVarMap()) {
+		dbgLogger.error("Expected VarMap for key \"", key, "\", got \"", var.type()->identifier, "\".");
+		if(success)
+			*success = false;
+		return Variant::null;
+	}
+
+	return var.get(key);
+}
+
+bool getBool(const Variant& var, const String& key, bool defaultValue = false, bool* success = nullptr) {
+	const Variant& v = getVarItem(var, key, success);
+
+	if(v.isBool()) {
+		return v.asBool();
+	}
+	else if(!v.isNull()) {
+		dbgLogger.error("Expected Bool for key \"", key, "\", got \"", var.type()->identifier, "\".");
+		if(success)
+			*success = false;
+	}
+
+	return defaultValue;
+}
+
+int64 getInt(const Variant& var, const String& key, int64 defaultValue = 0, bool* success = nullptr) {
+	const Variant& v = getVarItem(var, key, success);
+
+	if(v.isInt()) {
+		return v.asInt();
+	}
+	else if(!v.isNull()) {
+		dbgLogger.error("Expected Int for key \"", key, "\", got \"", var.type()->identifier, "\".");
+		if(success)
+			*success = false;
+	}
+
+	return defaultValue;
+}
+
+float getFloat(const Variant& var, const String& key, float defaultValue = 0, bool* success = nullptr) {
+	const Variant& v = getVarItem(var, key, success);
+
+	if(v.isFloat()) {
+		return v.asFloat();
+	}
+	else if(!v.isNull()) {
+		dbgLogger.error("Expected Float for key \"", key, "\", got \"", var.type()->identifier, "\".");
+		if(success)
+			*success = false;
+	}
+
+	return defaultValue;
+}
+
+const String& getString(const Variant& var, const String& key, const String& defaultValue = String(), bool* success = nullptr) {
+	const Variant& v = getVarItem(var, key, success);
+
+	if(v.isString()) {
+		return v.asString();
+	}
+	else if(!v.isNull()) {
+		dbgLogger.error("Expected String for key \"", key, "\", got \"", var.type()->identifier, "\".");
+		if(success)
+			*success = false;
+	}
+
+	return defaultValue;
+}
+
+IntVector getIntList(const Variant& var, const String& key, unsigned size, int defaultValue, bool* success = nullptr) {
+	const Variant& v = getVarItem(var, key, success);
+
+	if(v.isInt()) {
+		return IntVector(size, v.asInt());
+	}
+	if(v.isVarList()) {
+		IntVector stats(size, defaultValue);
+		unsigned i = 0;
+		for(const Variant& v2: v.asVarList()) {
+			if(i < size) {
+				stats[i] = v2.asInt();
+				i += 1;
+			}
+			else {
+				dbgLogger.warning("Too much value in array ", key);
+				break;
+			}
+		}
+		return stats;
+	}
+	else if(!v.isNull()) {
+		dbgLogger.error("Expected Int list.");
+		if(success)
+			*success = false;
+	}
+
+	return IntVector(6, defaultValue);
+}
+
+StringVector getStringList(const Variant& var, const String& key, bool* success = nullptr) {
+	const Variant& v = getVarItem(var, key, success);
+
+	StringVector strings;
+	if(v.isString()) {
+		strings.push_back(v.asString());
+	}
+	if(v.isVarList()) {
+		for(const Variant& v2: v.asVarList()) {
+			if(v2.isString()) {
+				strings.push_back(v2.asString());
+			}
+			else {
+				dbgLogger.warning("Expected String");
+			}
+		}
+	}
+	else if(!v.isNull()) {
+		dbgLogger.error("Expected String list.");
+		if(success)
+			*success = false;
+	}
+
+	return strings;
+}
+
+IntVector getClassStats(const Variant& var, const String& key, bool* success = nullptr) {
+	return getIntList(var, key, 6, 0, success);
+}
+
+
+static void writeInts(std::ostream& out, const IntVector& ints) {
+	writeVarint(out, ints.size());
+	for(int i: ints) {
+		writeVarint(out, zigzag(i));
+	}
+}
+
+
+static bool readInts(std::istream& in, IntVector& ints) {
+	uint64 size;
+	if(!readVarint(in, size))
+		return false;
+	ints.clear();
+	for(uint64 i = 0; i < size; ++i) {
+		uint64 value;
+		if(!readVarint(in, value))
+			return false;
+		ints.push_back(unzigzag(value));
+	}
+	return true;
+}
+
+
+static void writeStrings(std::ostream& out, const StringVector& strings) {
+	writeVarint(out, strings.size());
+	for(const String& string: strings) {
+		writeString(out, string);
+	}
+}
+
+
+static bool readStrings(std::istream& in, StringVector& strings) {
+	uint64 size;
+	if(!readVarint(in, size))
+		return false;
+	strings.clear();
+	for(uint64 i = 0; i < size; ++i) {
+		strings.emplace_back();
+		if(!readString(in, strings.back()))
+			return false;
+	}
+	return true;
+}
+
+
+static void writeFloat(std::ostream& out, float value) {
+	uint32 bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	writeVarint(out, bits);
+}
+
+
+static bool readFloat(std::istream& in, float& value) {
+	uint64 bits;
+	if(!readVarint(in, bits))
+		return false;
+	uint32 bits32 = uint32(bits);
+	std::memcpy(&value, &bits32, sizeof(value));
+	return true;
+}
+
+
+GameplayBundle::GameplayBundle()
+    : _dataHash(0)
+    , _firstWaveTime(0)
+    , _waveTime(0)
+    , _redshirtPerLane(0)
+{
+}
+
+
+bool GameplayBundle::load(const String& data, const Path& logicPath, Logger& log) {
+	if(isCompiled(data)) {
+		if(!_read(data)) {
+			log.error("Invalid gameplay bundle \"", logicPath.utf8String(), "\".");
+			return false;
+		}
+	}
+	else if(!compile(data, logicPath, log)) {
+		return false;
+	}
+	return validate(log);
+}
+
+
+bool GameplayBundle::load(const Path& path, Logger& log) {
+	Path::IStream in(path.native().c_str(), std::ios::binary);
+	if(!in.good()) {
+		log.error("Unable to read \"", path.utf8String(), "\".");
+		return false;
+	}
+
+	std::ostringstream buffer;
+	buffer << in.rdbuf();
+	return load(buffer.str(), path, log);
+}
+
+
+bool GameplayBundle::compile(const String& source, const Path& logicPath, Logger& log) {
+	_dataHash = hashData(source.data(), source.size());
+
+	std::istringstream dataIn(source);
+	ErrorList errors;
+	LdlParser parser(&dataIn, logicPath.utf8String(), &errors, LdlParser::CTX_MAP);
+
+	Variant config;
+	if(!ldlRead(parser, config)) {
+		log.error("Failed to load gameplay data from \"",
+		          logicPath.utf8String(), "\"");
+		errors.log(log);
+		return false;
+	}
+	errors.log(log);
+
+	// Read gameplay.ldl
+
+	Variant motd = config.get("motd");
+	if(motd.isString()) {
+		_motd = motd.asString();
+	}
+
+	_firstWaveTime   = getInt(config, "first_wave_time");
+	_waveTime        = getInt(config, "wave_time");
+	_redshirtPerLane = getInt(config, "redshirt_per_lane");
+
+	_heroNextLevel   = getClassStats(config, "hero_next_level");
+	_heroXpWorth     = getClassStats(config, "hero_xp_worth");
+	_redshirtXpWorth = getClassStats(config, "redshirt_xp_worth");
+	_towerXpWorth    = getClassStats(config, "tower_xp_worth");
+
+	_respawnTime = getClassStats(config, "respawn_time");
+
+	// Without lanes or heroes, the game is the one of the regular map: two
+	// lanes and the three heroes on each side.
+	_lanes = getStringList(config, "lanes");
+	if(_lanes.empty())
+		_lanes = StringVector{ "top", "bot" };
+
+	const Variant& heroes = config.get("heroes");
+	for(unsigned team = 0; team < 2; ++team) {
+		HeroVector& roster = _heroes[team];
+		if(heroes.isNull()) {
+			roster = HeroVector{ { "ranger", 0 }, { "warrior", 1 }, { "mage", 1 } };
+			continue;
+		}
+
+		const Variant& list = getVarItem(heroes, teamName(Team(team)));
+		if(!list.isVarList()) {
+			log.error("Expected \"heroes.", teamName(Team(team)), "\" VarList.");
+			continue;
+		}
+		for(const Variant& heroVar: list.asVarList()) {
+			Hero hero{ getString(heroVar, "class"), 0 };
+			String lane = getString(heroVar, "lane", _lanes.front());
+			auto it = std::find(_lanes.begin(), _lanes.end(), lane);
+			if(hero.classId.empty() || it == _lanes.end()) {
+				log.error("Invalid hero.");
+				continue;
+			}
+			hero.lane = it - _lanes.begin();
+			roster.push_back(hero);
+		}
+	}
+
+	const Variant& nodes = config.get("nodes");
+	if(nodes.isVarMap()) {
+		for(const auto& pair: nodes.asVarMap()) {
+			const String& id = pair.first;
+			const Variant& obj = pair.second;
+
+			Node node;
+
+			node.id = id;
+			_symbols.intern(id);
+
+			const Variant& nameVar = obj.get("name");
+			if(nameVar.isString())
+				node.name = nameVar.asString();
+			else
+				log.error("Node without name");
+
+			node.images = getStringList(obj, "images");
+
+			const Variant& posVar = obj.get("position");
+			if(posVar.isVarList() && posVar.asVarList().size() == 2) {
+				const VarList& pos = posVar.asVarList();
+				node.pos = Vector2(pos[0].asFloat(), pos[1].asFloat());
+			}
+			else
+				log.error("Node without position");
+
+			node.tower  = getString(obj, "tower");
+			node.fonxus = getString(obj, "fonxus");
+
+			_nodes.push_back(node);
+		}
+	}
+	else {
+		log.error("Expected \"nodes\" VarMap.");
+	}
+
+	const Variant& paths = config.get("paths");
+	if(paths.isVarList()) {
+		for(const Variant& pathVar: paths.asVarList()) {
+			const Variant& fromVar     = pathVar.get("from");
+			const Variant& toVar       = pathVar.get("to");
+			const Variant& fromDirsVar = pathVar.get("from_dirs");
+			const Variant& toDirsVar   = pathVar.get("to_dirs");
+			if(fromVar.isString() && toVar.isString() &&
+			        fromDirsVar.isVarList() && toDirsVar.isVarList()) {
+				NodePath path;
+				path.from = fromVar.asString();
+				path.to   = toVar.asString();
+
+				for(const Variant& dirVar: fromDirsVar.asVarList()) {
+					if(dirVar.isString())
+						path.fromDirs.emplace_back(dirVar.asString());
+				}
+
+				for(const Variant& dirVar: toDirsVar.asVarList()) {
+					if(dirVar.isString())
+						path.toDirs.emplace_back(dirVar.asString());
+				}
+
+				_paths.push_back(path);
+			}
+			else {
+				log.error("Invalid path.");
+			}
+		}
+	}
+	else {
+		log.error("Expected \"paths\" VarList.");
+	}
+
+	const Variant& classes = config.get("classes");
+	if(classes.isVarMap()) {
+		for(const auto& pair: classes.asVarMap()) {
+			const String& id = pair.first;
+			const Variant& obj = pair.second;
+
+			CharacterClassSP cClass = std::make_shared<CharacterClass>();
+
+			cClass->_id        = id;
+			cClass->_symbol    = _symbols.intern(id);
+
+			String type = getString(obj, "type");
+			if(type == "hero")
+				cClass->_type = HERO;
+			else if(type == "redshirt")
+				cClass->_type = REDSHIRT;
+			else if(type == "building")
+				cClass->_type = BUILDING;
+			else {
+				log.error("Unexpected CharType: \"", type, "\"");
+				cClass->_type = BUILDING;
+			}
+
+			cClass->_name      = getString(obj, "name", "<fixme_no_name>");
+			cClass->_sortIndex = getInt(obj, "sort_index", 9999);
+
+			String defaultPlace = getString(obj, "default_place", "back");
+			cClass->_defaultPlace = (defaultPlace == "back")? BACK: FRONT;
+
+			cClass->_maxHP     = getClassStats(obj, "max_hp");
+			cClass->_maxMana   = getClassStats(obj, "max_mana");
+			cClass->_damage    = getClassStats(obj, "damage");
+			cClass->_range     = getClassStats(obj, "range");
+			cClass->_skills    = getStringList(obj, "skills");
+
+			cClass->_image     = getString(obj, "image");
+
+			_classes.push_back(cClass);
+		}
+	}
+	else {
+		log.error("Expected \"classes\" VarMap.");
+	}
+
+	const Variant& skills = config.get("skills");
+	if(skills.isVarMap()) {
+		for(const auto& pair: skills.asVarMap()) {
+			const String& id = pair.first;
+			const Variant& obj = pair.second;
+
+			SkillModelSP skill = std::make_shared<SkillModel>();
+
+			skill->_id        = id;
+			skill->_symbol    = _symbols.intern(id);
+			skill->_name      = getString(obj, "name", "<fixme_no_name>");
+			skill->_desc      = getString(obj, "desc");
+
+			const Variant& effectsVar = obj.get("effects");
+			if(effectsVar.isVarList()) {
+				for(const Variant& effectVar: effectsVar.asVarList()) {
+					SkillModel::Effect effect;
+
+					const Variant& typeVar = effectVar.get("type");
+					if(typeVar.isString())
+						effect._type = IntVector(2, parseSkillEffect(typeVar.asString()));
+					else if(typeVar.isVarList()){
+						const VarList& list = typeVar.asVarList();
+						if(list.size() == 2) {
+							for(const Variant& v: list) {
+								effect._type.push_back(parseSkillEffect(v.asString()));
+							}
+						}
+						else
+							log.error("Skill effect type must be of size 2");
+					}
+					else
+						log.error("Invalid skill effect type");
+
+					effect._power = getIntList(effectVar, "power", 2, 0);
+
+					skill->_effects.push_back(effect);
+				}
+			}
+			else
+				log.error("Invalid skill effect");
+
+			const Variant& targetVar = obj.get("target");
+			skill->_target = IntVector(2, NO_TARGET);
+			if(targetVar.isString()) {
+				skill->_target = IntVector(2, parseSkillTarget(targetVar.asString()));
+			}
+			else if(targetVar.isVarList()) {
+				const VarList& list = targetVar.asVarList();
+				unsigned count = list.size();
+				if(count == 2) {
+					for(unsigned i = 0; i < count; ++i) {
+						skill->_target[i] = parseSkillTarget(list[i].asString());
+					}
+				}
+				else {
+					log.error("Skill target array must contain exactly 2 values");
+				}
+			}
+			else {
+				log.error("Invalid skill target.");
+			}
+
+			skill->_range    = getIntList(obj, "range", 2, 3);
+			skill->_cooldown = getIntList(obj, "cooldown", 2, 0);
+			skill->_manaCost = getIntList(obj, "mana_cost", 2, 99999);
+
+			_skillModels.push_back(skill);
+		}
+	}
+	else {
+		log.error("Expected \"skills\" VarMap.");
+	}
+
+	for(const CharacterClassSP& cClass: _classes) {
+		for(const String& skillName: cClass->skills()) {
+			SkillModelSP sm;
+			for(const SkillModelSP& skill: _skillModels) {
+				if(skill->id() == skillName)
+					sm = skill;
+			}
+			if(sm) {
+				cClass->_skillModels.push_back(sm);
+			}
+			else {
+				log.warning("Skill model not found: \"", skillName, "\"");
+			}
+		}
+	}
+
+	_buildLevels(log);
+
+	const Variant& infoVar = config.get("info");
+	if(infoVar.isVarMap()) {
+		for(const auto& pair: infoVar.asVarMap()) {
+			_infos.emplace(pair.first, pair.second.asString());
+		}
+	}
+
+	return true;
+}
+
+
+bool GameplayBundle::validate(Logger& log) const {
+	bool fonxusNode[2] = { false, false };
+	bool fonxus[2]     = { false, false };
+	bool towers        = false;
+	for(const Node& node: _nodes) {
+		SymbolId symbol = _symbols.find(node.id);
+		if(symbol == SYM_BLUE_FONXUS_NODE)
+			fonxusNode[BLUE] = true;
+		if(symbol == SYM_RED_FONXUS_NODE)
+			fonxusNode[RED] = true;
+		if(node.fonxus.size())
+			fonxus[(node.fonxus == "blue")? BLUE: RED] = true;
+		if(node.tower.size())
+			towers = true;
+	}
+
+	bool classes[SYM_BUILTIN_COUNT] = {};
+	for(const CharacterClassSP& cClass: _classes) {
+		if(cClass->symbol() < SYM_BUILTIN_COUNT)
+			classes[cClass->symbol()] = true;
+	}
+
+	bool valid = true;
+	for(SymbolId symbol: { SYM_BLUE_FONXUS_NODE, SYM_RED_FONXUS_NODE }) {
+		if(!fonxusNode[symbol - SYM_BLUE_FONXUS_NODE]) {
+			log.error("Gameplay data: missing node \"", _symbols.name(symbol), "\".");
+			valid = false;
+		}
+	}
+	for(Team team: { BLUE, RED }) {
+		if(!fonxus[team]) {
+			log.error("Gameplay data: no node has the ", teamName(team), " fonxus.");
+			valid = false;
+		}
+	}
+	for(SymbolId symbol: { SYM_FONXUS, SYM_BLUESHIRT, SYM_REDSHIRT, SYM_TOWER }) {
+		if(!classes[symbol] && (symbol != SYM_TOWER || towers)) {
+			log.error("Gameplay data: missing class \"", _symbols.name(symbol), "\".");
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+
+bool GameplayBundle::write(std::ostream& out) const {
+	std::ostringstream body;
+	body.write(bundleMagic, sizeof(bundleMagic));
+	writeVarint(body, bundleVersion);
+	writeVarint(body, _dataHash);
+	writeString(body, _motd);
+
+	writeVarint(body, _firstWaveTime);
+	writeVarint(body, _waveTime);
+	writeVarint(body, _redshirtPerLane);
+	writeInts(body, _heroNextLevel);
+	writeInts(body, _heroXpWorth);
+	writeInts(body, _redshirtXpWorth);
+	writeInts(body, _towerXpWorth);
+	writeInts(body, _respawnTime);
+
+	writeStrings(body, _lanes);
+	for(const HeroVector& roster: _heroes) {
+		writeVarint(body, roster.size());
+		for(const Hero& hero: roster) {
+			writeString(body, hero.classId);
+			writeVarint(body, hero.lane);
+		}
+	}
+
+	// Builtin symbols are interned by every table.
+	writeVarint(body, _symbols.size() - SYM_BUILTIN_COUNT);
+	for(SymbolId symbol = SYM_BUILTIN_COUNT; symbol < _symbols.size(); ++symbol) {
+		writeString(body, _symbols.name(symbol));
+	}
+
+	writeVarint(body, _nodes.size());
+	for(const Node& node: _nodes) {
+		writeString(body, node.id);
+		writeString(body, node.name);
+		writeStrings(body, node.images);
+		writeFloat(body, node.pos(0));
+		writeFloat(body, node.pos(1));
+		writeString(body, node.tower);
+		writeString(body, node.fonxus);
+	}
+
+	writeVarint(body, _paths.size());
+	for(const NodePath& path: _paths) {
+		writeString(body, path.from);
+		writeString(body, path.to);
+		writeStrings(body, path.fromDirs);
+		writeStrings(body, path.toDirs);
+	}
+
+	writeVarint(body, _classes.size());
+	for(const CharacterClassSP& cClass: _classes) {
+		writeString(body, cClass->_id);
+		writeString(body, cClass->_name);
+		writeVarint(body, zigzag(cClass->_sortIndex));
+		writeVarint(body, cClass->_type);
+		writeVarint(body, cClass->_defaultPlace);
+		writeInts(body, cClass->_maxHP);
+		writeInts(body, cClass->_maxMana);
+		writeInts(body, cClass->_damage);
+		writeInts(body, cClass->_range);
+		writeString(body, cClass->_image);
+		writeStrings(body, cClass->_skills);
+	}
+
+	writeVarint(body, _skillModels.size());
+	for(const SkillModelSP& skill: _skillModels) {
+		writeString(body, skill->_id);
+		writeString(body, skill->_name);
+		writeString(body, skill->_desc);
+		writeVarint(body, skill->_effects.size());
+		for(const SkillModel::Effect& effect: skill->_effects) {
+			writeInts(body, effect._type);
+			writeInts(body, effect._power);
+		}
+		writeInts(body, skill->_target);
+		writeInts(body, skill->_range);
+		writeInts(body, skill->_cooldown);
+		writeInts(body, skill->_manaCost);
+	}
+
+	writeVarint(body, _infos.size());
+	for(const auto& pair: _infos) {
+		writeString(body, pair.first);
+		writeString(body, pair.second);
+	}
+
+	String data = body.str();
+	uint64 hash = hashData(data.data(), data.size());
+	for(unsigned i = 0; i < 8; ++i) {
+		data.push_back(char(hash >> (8 * i)));
+	}
+
+	out.write(data.data(), data.size());
+	return bool(out);
+}
+
+
+bool GameplayBundle::save(const lair::Path& path) const {
+	std::ofstream out(path.utf8String().c_str(), std::ios::binary);
+	if(!out.good()) {
+		dbgLogger.error("Unable to write \"", path.utf8String(), "\".");
+		return false;
+	}
+	return write(out);
+}
+
+
+bool GameplayBundle::isCompiled(const String& data) {
+	return data.size() >= sizeof(bundleMagic) &&
+	       std::memcmp(data.data(), bundleMagic, sizeof(bundleMagic)) == 0;
+}
+
+
+bool GameplayBundle::_read(const String& data) {
+	if(data.size() < sizeof(bundleMagic) + 8)
+		return false;
+
+	size_t size = data.size() - 8;
+	uint64 hash = 0;
+	for(unsigned i = 0; i < 8; ++i) {
+		hash |= uint64(uint8(data[size + i])) << (8 * i);
+	}
+	if(hash != hashData(data.data(), size)) {
+		dbgLogger.error("GameplayBundle: corrupted file.");
+		return false;
+	}
+
+	char* begin = const_cast<char*>(data.data());
+	MemoryStreamBuf buffer(begin + sizeof(bundleMagic), begin + size);
+	std::istream in(&buffer);
+
+	uint64 version;
+	if(!readVarint(in, version) || version != bundleVersion) {
+		dbgLogger.error("GameplayBundle: unsupported version ", version, ".");
+		return false;
+	}
+
+	uint64 count;
+	bool ok = readVarint(in, _dataHash) && readString(in, _motd) &&
+	          readUnsigned(in, _firstWaveTime) && readUnsigned(in, _waveTime) &&
+	          readUnsigned(in, _redshirtPerLane) &&
+	          readInts(in, _heroNextLevel) && readInts(in, _heroXpWorth) &&
+	          readInts(in, _redshirtXpWorth) && readInts(in, _towerXpWorth) &&
+	          readInts(in, _respawnTime) && readStrings(in, _lanes);
+
+	for(HeroVector& roster: _heroes) {
+		ok = ok && readVarint(in, count);
+		for(uint64 i = 0; ok && i < count; ++i) {
+			Hero hero;
+			ok = readString(in, hero.classId) && readUnsigned(in, hero.lane) &&
+			     hero.lane < _lanes.size();
+			roster.push_back(hero);
+		}
+	}
+
+	ok = ok && readVarint(in, count);
+	_symbols.clear();
+	for(uint64 i = 0; ok && i < count; ++i) {
+		String name;
+		ok = readString(in, name);
+		_symbols.intern(name);
+	}
+
+	ok = ok && readVarint(in, count);
+	for(uint64 i = 0; ok && i < count; ++i) {
+		Node node;
+		float pos[2] = { 0, 0 };
+		ok = readString(in, node.id) && readString(in, node.name) &&
+		     readStrings(in, node.images) && readFloat(in, pos[0]) &&
+		     readFloat(in, pos[1]) && readString(in, node.tower) &&
+		     readString(in, node.fonxus);
+		node.pos = Vector2(pos[0], pos[1]);
+		_nodes.push_back(node);
+	}
+
+	ok = ok && readVarint(in, count);
+	for(uint64 i = 0; ok && i < count; ++i) {
+		NodePath path;
+		ok = readString(in, path.from) && readString(in, path.to) &&
+		     readStrings(in, path.fromDirs) && readStrings(in, path.toDirs);
+		_paths.push_back(path);
+	}
+
+	ok = ok && readVarint(in, count);
+	for(uint64 i = 0; ok && i < count; ++i) {
+		CharacterClassSP cClass = std::make_shared<CharacterClass>();
+		uint64 sortIndex = 0;
+		unsigned type = 0;
+		unsigned defaultPlace = 0;
+		ok = readString(in, cClass->_id) && readString(in, cClass->_name) &&
+		     readVarint(in, sortIndex) && readUnsigned(in, type) &&
+		     readUnsigned(in, defaultPlace) && readInts(in, cClass->_maxHP) &&
+		     readInts(in, cClass->_maxMana) && readInts(in, cClass->_damage) &&
+		     readInts(in, cClass->_range) && readString(in, cClass->_image) &&
+		     readStrings(in, cClass->_skills) && type <= BUILDING && defaultPlace <= FRONT;
+		cClass->_symbol       = _symbols.find(cClass->_id);
+		cClass->_sortIndex    = unzigzag(sortIndex);
+		cClass->_type         = CharType(type);
+		cClass->_defaultPlace = Place(defaultPlace);
+		_classes.push_back(cClass);
+	}
+
+	ok = ok && readVarint(in, count);
+	for(uint64 i = 0; ok && i < count; ++i) {
+		SkillModelSP skill = std::make_shared<SkillModel>();
+		uint64 effectCount = 0;
+		ok = readString(in, skill->_id) && readString(in, skill->_name) &&
+		     readString(in, skill->_desc) && readVarint(in, effectCount);
+		for(uint64 ei = 0; ok && ei < effectCount; ++ei) {
+			SkillModel::Effect effect;
+			ok = readInts(in, effect._type) && readInts(in, effect._power);
+			skill->_effects.push_back(effect);
+		}
+		ok = ok && readInts(in, skill->_target) && readInts(in, skill->_range) &&
+		     readInts(in, skill->_cooldown) && readInts(in, skill->_manaCost);
+		skill->_symbol = _symbols.find(skill->_id);
+		_skillModels.push_back(skill);
+	}
+
+	ok = ok && readVarint(in, count);
+	for(uint64 i = 0; ok && i < count; ++i) {
+		String topic;
+		String text;
+		ok = readString(in, topic) && readString(in, text);
+		_infos.emplace(topic, text);
+	}
+
+	if(!ok) {
+		dbgLogger.error("GameplayBundle: truncated file.");
+		return false;
+	}
+
+	for(const CharacterClassSP& cClass: _classes) {
+		for(const String& skillName: cClass->skills()) {
+			for(const SkillModelSP& skill: _skillModels) {
+				if(skill->id() == skillName)
+					cClass->_skillModels.push_back(skill);
+			}
+		}
+	}
+
+	_buildLevels(dbgLogger);
+
+	return true;
+}
+
+
+void GameplayBundle::_buildLevels(Logger& log) {
+	// Heroes may reach every level of the experience table.
+	for(const CharacterClassSP& cClass: _classes) {
+		cClass->_buildLevels(_heroNextLevel.size());
+	}
+	for(const SkillModelSP& skill: _skillModels) {
+		skill->_buildLevels(log);
+	}
+}
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_GAMEPLAY_BUNDLE_H_
+#define LD41_GAMEPLAY_BUNDLE_H_
+
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+#include <lair/core/path.h>
+
+#include "text_moba.h"
+#include "symbol_table.h"
+
+
+// The gameplay data of gameplay.ldl, once parsed: game settings, map nodes
+// and paths, character classes and skill models. See
+// TextMoba::initialize(const GameplayBundleCSP&).
+//
+// A bundle can be compiled to a binary file, which loads without parsing
+// and is checked against a hash of its content, and it is meant to be
+// shared read-only by all the games of a process: classes and skill models
+// are used as they are, only map nodes are copied by each game since they
+// hold its characters.
+class GameplayBundle {
+public:
+	struct Node {
+		lair::String  id;
+		lair::String  name;
+		StringVector  images;
+		lair::Vector2 pos;
+		lair::String  tower;
+		lair::String  fonxus;
+	};
+
+	struct NodePath {
+		lair::String from;
+		lair::String to;
+		StringVector fromDirs;
+		StringVector toDirs;
+	};
+
+	// A hero spawned by TextMoba::restart() and the lane its AI follows.
+	struct Hero {
+		lair::String classId;
+		Lane         lane;
+	};
+
+	typedef std::vector<Node>             NodeVector;
+	typedef std::vector<NodePath>         PathVector;
+	typedef std::vector<CharacterClassSP> ClassVector;
+	typedef std::vector<SkillModelSP>     SkillModelVector;
+	typedef std::vector<Hero>             HeroVector;
+
+public:
+	GameplayBundle();
+
+	// Loads either LDL source or a compiled bundle, as saved by save(),
+	// from data. Returns false if the data can not be read or parsed, or
+	// fails validate().
+	bool load(const lair::String& data, const lair::Path& logicPath,
+	          lair::Logger& log);
+	bool load(const lair::Path& path, lair::Logger& log);
+
+	bool compile(const lair::String& source, const lair::Path& logicPath,
+	             lair::Logger& log);
+
+	// Checks that the data has what TextMoba spawns on its own: both fonxus
+	// nodes and their fonxus, and the fonxus, tower and redshirt classes.
+	bool validate(lair::Logger& log) const;
+
+	bool write(std::ostream& out) const;
+	bool save(const lair::Path& path) const;
+
+	static bool isCompiled(const lair::String& data);
+
+private:
+	bool _read(const lair::String& data);
+	void _buildLevels(lair::Logger& log);
+
+public:
+	// Hash of the LDL source, compiled bundles keep it so replays and saves
+	// recorded with either stay valid.
+	lair::uint64 _dataHash;
+	lair::String _motd;
+
+	unsigned     _firstWaveTime;
+	unsigned     _waveTime;
+	unsigned     _redshirtPerLane;
+
+	IntVector    _heroNextLevel;
+	IntVector    _heroXpWorth;
+	IntVector    _redshirtXpWorth;
+	IntVector    _towerXpWorth;
+	IntVector    _respawnTime;
+
+	// Direction aliases leading from a fonxus to each lane, indexed by Lane.
+	StringVector _lanes;
+	// Heroes of each team, in spawn order. The player replaces the first
+	// blue hero of its class.
+	HeroVector   _heroes[2];
+
+	// Symbols are interned in the order of the data, so every game loading
+	// the bundle gets the same ones.
+	SymbolTable  _symbols;
+
+	// In the order of the data, which gives the order in which games spawn
+	// the towers of the nodes.
+	NodeVector       _nodes;
+	PathVector       _paths;
+	ClassVector      _classes;
+	SkillModelVector _skillModels;
+	StringMap        _infos;
+};
+
+
+#endif
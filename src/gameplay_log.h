@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_GAMEPLAY_LOG_H_
+#define LD41_GAMEPLAY_LOG_H_
+
+
+#include <lair/core/log.h>
+
+
+// Logging macros for the code that runs every turn. Messages above
+// LD41_GAMEPLAY_LOG_LEVEL are removed at compile time, arguments included,
+// so they cost nothing in release builds. Set it with the CMake option of
+// the same name.
+
+#define LD41_LOG_NONE    0
+#define LD41_LOG_ERROR   1
+#define LD41_LOG_WARNING 2
+#define LD41_LOG_LOG     3
+#define LD41_LOG_INFO    4
+#define LD41_LOG_DEBUG   5
+
+#ifndef LD41_GAMEPLAY_LOG_LEVEL
+#  ifdef NDEBUG
+#    define LD41_GAMEPLAY_LOG_LEVEL LD41_LOG_WARNING
+#  else
+#    define LD41_GAMEPLAY_LOG_LEVEL LD41_LOG_DEBUG
+#  endif
+#endif
+
+#define LD41_GAMEPLAY_LOG(_level, _method, _logger, ...) \
+	do { \
+		if(LD41_GAMEPLAY_LOG_LEVEL >= _level) \
+			(_logger)._method(__VA_ARGS__); \
+	} while(false)
+
+#define gpError(_logger, ...)   LD41_GAMEPLAY_LOG(LD41_LOG_ERROR,   error,   _logger, __VA_ARGS__)
+#define gpWarning(_logger, ...) LD41_GAMEPLAY_LOG(LD41_LOG_WARNING, warning, _logger, __VA_ARGS__)
+#define gpLog(_logger, ...)     LD41_GAMEPLAY_LOG(LD41_LOG_LOG,     log,     _logger, __VA_ARGS__)
+#define gpInfo(_logger, ...)    LD41_GAMEPLAY_LOG(LD41_LOG_INFO,    info,    _logger, __VA_ARGS__)
+#define gpDebug(_logger, ...)   LD41_GAMEPLAY_LOG(LD41_LOG_DEBUG,   debug,   _logger, __VA_ARGS__)
+
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <lair/core/log.h>
+
+#include "map_node.h"
+#include "character.h"
+#include "match_runner.h"
+#include "event_recorder.h"
+#include "match_save.h"
+#include "gameplay_bundle.h"
+#include "telemetry.h"
+#include "scenario.h"
+
+
+using namespace lair;
+
+
+void usage(const char* prog) {
+	std::cerr << "Usage: " << prog << " [options]\n"
+	          << "  --data <dir>      Directory containing gameplay.ldl (default: assets)\n"
+	          << "  --gameplay <file> Gameplay data to use instead of <dir>/gameplay.ldl, as LDL\n"
+	          << "                    source or compiled bundle\n"
+	          << "  --compile <file>  Save the gameplay data as a compiled bundle to file\n"
+	          << "  --class <name>    Class of the (AI controlled) player (default: warrior)\n"
+	          << "  --matches <n>     Number of matches to play (default: 1)\n"
+	          << "  --max-turns <n>   Stop a match after n turns (default: 10000)\n"
+	          << "  --seed <n>        Seed of the first match, incremented for each match (default: 0)\n"
+	          << "  --jobs <n>        Number of threads, 0 to use all cores (default: 0)\n"
+	          << "  --ai-threads <n>  Decide the AIs of each team together, on n threads per match\n"
+	          << "                    (default: 0, AIs play one after the other)\n"
+	          << "  --search-ai <team>\n"
+	          << "                    Heroes of team (blue or red) look ahead before each turn\n"
+	          << "  --search-depth <n>\n"
+	          << "                    Turns simulated by the search AIs (default: 8)\n"
+	          << "  --search-budget <us>\n"
+	          << "                    Time each search AI may spend per turn, 0 for no limit\n"
+	          << "                    and reproducible matches (default: 2000)\n"
+	          << "  --load <file>     Continue the matches from a match saved by --save, each\n"
+	          << "                    with its own seed\n"
+	          << "  --telemetry <file>\n"
+	          << "                    Save per-turn and per-match statistics of the matches\n"
+	          << "  --decode-telemetry <file>\n"
+	          << "                    Print the statistics saved by --telemetry as CSV\n"
+	          << "  --generate <file> Write gameplay data with a generated map to file, to use\n"
+	          << "                    with --gameplay. The map is set by:\n"
+	          << "    --lanes <n>       Number of lanes (default: 2)\n"
+	          << "    --lane-length <n> Nodes per lane (default: 7)\n"
+	          << "    --jungle <n>      Link neighbor lanes by a jungle node every n nodes\n"
+	          << "                      (default: 0, no jungle)\n"
+	          << "    --heroes <list>   Comma-separated classes of the heroes of each team\n"
+	          << "                      (default: ranger,warrior,mage)\n"
+	          << "  --replay <file>   Re-simulate a replay instead of playing matches\n"
+	          << "  --stop-turn <n>   Stop the replay at turn n\n"
+	          << "  --save <file>     Save the match at the end of the replay to file (requires\n"
+	          << "                    --replay)\n"
+	          << "  --record-events <file>\n"
+	          << "                    Save the last game events of the replay to file\n"
+	          << "  --decode-events <file>\n"
+	          << "                    Print the events saved by --record-events\n";
+}
+
+
+int decodeEvents(const Path& eventsPath) {
+	EventRecorder recorder;
+	if(!recorder.load(eventsPath))
+		return EXIT_FAILURE;
+
+	for(const EventRecorder::Record& record: recorder.records()) {
+		std::cout << recorder.decode(record) << "\n";
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+int compileGameplay(const Path& logicPath, const Path& bundlePath) {
+	GameplayBundle bundle;
+	if(!bundle.load(logicPath, dbgLogger) || !bundle.save(bundlePath))
+		return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
+
+
+int generateGameplay(const Path& logicPath, const ScenarioConfig& scenario,
+                     const Path& outPath) {
+	Path::IStream in(logicPath.native().c_str(), std::ios::binary);
+	if(!in.good()) {
+		dbgLogger.error("Unable to read \"", logicPath.utf8String(), "\".");
+		return EXIT_FAILURE;
+	}
+	std::ostringstream buffer;
+	buffer << in.rdbuf();
+
+	std::ofstream out(outPath.utf8String().c_str(), std::ios::binary);
+	out << generateScenario(buffer.str(), scenario);
+	if(!out.good()) {
+		dbgLogger.error("Unable to write \"", outPath.utf8String(), "\".");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+
+StringVector splitList(const String& list) {
+	StringVector items;
+	size_t begin = 0;
+	while(begin <= list.size()) {
+		size_t end = std::min(list.find(',', begin), list.size());
+		if(end > begin)
+			items.emplace_back(list.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	return items;
+}
+
+
+int playReplay(const Path& logicPath, const Path& replayPath, unsigned stopTurn,
+               const Path& eventsPath, const Path& savePath) {
+	Replay replay;
+	if(!replay.load(replayPath))
+		return EXIT_FAILURE;
+
+	TextMoba textMoba;
+	if(!textMoba.initialize(logicPath))
+		return EXIT_FAILURE;
+
+	EventRecorder recorder(&textMoba);
+	if(!eventsPath.empty()) {
+		textMoba.addEventListener([&recorder](const GameEvent& event) {
+			recorder.record(event);
+		});
+	}
+
+	bool success = textMoba.playReplay(replay, stopTurn);
+
+	if(!eventsPath.empty() && !recorder.save(eventsPath))
+		success = false;
+
+	if(!savePath.empty()) {
+		MatchSave save;
+		textMoba.saveMatch(save);
+		if(!save.save(savePath))
+			success = false;
+	}
+
+	std::cout << "turn " << textMoba._turn;
+	if(textMoba.isOver())
+		std::cout << ", " << teamName(textMoba.winner()) << " won";
+	std::cout << "\n";
+
+	for(CharacterSP c: textMoba.characters()) {
+		if(c->type() == REDSHIRT)
+			continue;
+		std::cout << "  " << c->debugName() << " lvl " << c->level() + 1
+		          << ", hp " << c->hp() << " / " << c->maxHP()
+		          << ", mana " << c->mana() << " / " << c->maxMana() << "\n";
+	}
+
+	return success? EXIT_SUCCESS: EXIT_FAILURE;
+}
+
+
+int main(int argc, char** argv) {
+	Path     dataPath  = "assets";
+	Path     gameplay;
+	Path     compile;
+	Path     generate;
+	ScenarioConfig scenario;
+	String   className = "warrior";
+	unsigned matches   = 1;
+	unsigned maxTurns  = 10000;
+	unsigned seed      = 0;
+	unsigned jobs      = 0;
+	unsigned aiThreads = 0;
+	Team     searchAi  = NEUTRAL;
+	SearchAiConfig search;
+	Path     load;
+	Path     replay;
+	unsigned stopTurn  = unsigned(-1);
+	Path     save;
+	Path     recordEvents;
+	Path     decode;
+	Path     telemetry;
+	Path     decodeTelemetry;
+
+	for(int i = 1; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if(hasValue && std::strcmp(argv[i], "--data") == 0)
+			dataPath = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--gameplay") == 0)
+			gameplay = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--compile") == 0)
+			compile = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--generate") == 0)
+			generate = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--lanes") == 0)
+			scenario.lanes = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--lane-length") == 0)
+			scenario.laneLength = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--jungle") == 0)
+			scenario.jungleSpacing = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--heroes") == 0)
+			scenario.heroes = splitList(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--class") == 0)
+			className = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--matches") == 0)
+			matches = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--max-turns") == 0)
+			maxTurns = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--seed") == 0)
+			seed = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--jobs") == 0)
+			jobs = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--ai-threads") == 0)
+			aiThreads = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--search-ai") == 0) {
+			++i;
+			if(argv[i] == teamName(BLUE))
+				searchAi = BLUE;
+			else if(argv[i] == teamName(RED))
+				searchAi = RED;
+			else {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if(hasValue && std::strcmp(argv[i], "--search-depth") == 0)
+			search.depth = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--search-budget") == 0)
+			search.budget = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--load") == 0)
+			load = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--replay") == 0)
+			replay = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--stop-turn") == 0)
+			stopTurn = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--save") == 0)
+			save = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--record-events") == 0)
+			recordEvents = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--decode-events") == 0)
+			decode = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--telemetry") == 0)
+			telemetry = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--decode-telemetry") == 0)
+			decodeTelemetry = argv[++i];
+		else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!decode.empty()) {
+		return decodeEvents(decode);
+	}
+
+	if(!decodeTelemetry.empty()) {
+		return TelemetryFile::decode(decodeTelemetry, std::cout)? EXIT_SUCCESS: EXIT_FAILURE;
+	}
+
+	Path logicPath = gameplay.empty()? dataPath / "gameplay.ldl": gameplay;
+
+	if(!compile.empty()) {
+		return compileGameplay(logicPath, compile);
+	}
+
+	if(!generate.empty()) {
+		return generateGameplay(logicPath, scenario, generate);
+	}
+
+	if(!save.empty() && replay.empty()) {
+		dbgLogger.error("--save requires --replay.");
+		return EXIT_FAILURE;
+	}
+
+	if(!replay.empty()) {
+		return playReplay(logicPath, replay, stopTurn, recordEvents, save);
+	}
+
+	MatchSave startSave;
+	if(!load.empty() && !startSave.load(load))
+		return EXIT_FAILURE;
+
+	MatchRunner runner(logicPath, jobs);
+	runner.setTelemetryPath(telemetry);
+	for(unsigned match = 0; match < matches; ++match) {
+		runner.addMatch(MatchConfig{ seed + match, className, maxTurns, aiThreads,
+		                             searchAi, search, load.empty()? nullptr: &startSave });
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if(!runner.run())
+		return EXIT_FAILURE;
+	std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+	unsigned wins[3] = { 0, 0, 0 };
+	uint64   turns   = 0;
+	for(unsigned match = 0; match < matches; ++match) {
+		const MatchResult& result = runner.results()[match];
+		wins[result.winner] += 1;
+		turns += result.turns;
+		std::cout << "match " << match << " (seed " << runner.configs()[match].seed << "): "
+		          << ((result.winner != NEUTRAL)? teamName(result.winner): "draw")
+		          << " in " << result.turns << " turns\n";
+	}
+
+	std::cout << "blue: " << wins[BLUE] << ", red: " << wins[RED]
+	          << ", draw: " << wins[NEUTRAL] << "\n";
+	std::cout << turns << " turns in " << time.count() << "s on "
+	          << std::min(runner.threadCount(), matches) << " threads ("
+	          << turns / time.count() << " turns/s)\n";
+
+	return EXIT_SUCCESS;
+}
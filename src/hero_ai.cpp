@@ -31,7 +31,7 @@
 using namespace lair;
 
 
-HeroAi::HeroAi(CharacterSP character, Lane lane)
+HeroAi::HeroAi(Character* character, Lane lane)
     : Ai(character)
     , _status(PUSH_LANE)
     , _lane(lane)
@@ -39,11 +39,11 @@ HeroAi::HeroAi(CharacterSP character, Lane lane)
 }
 
 
-void HeroAi::play() {
-	CharacterSP c = character();
+AiAction HeroAi::decide() {
+	Character* c = character();
 
-	if(!c || !c->isAlive())
-		return;
+	if(!c->isAlive())
+		return AiAction::none();
 
 	_groups = c->node()->characterGroups();
 
@@ -66,18 +66,18 @@ void HeroAi::play() {
 
 		if(enemyCount && !redshirtCount && !towerCount) {
 			// Back if it doesn't look good.
-			move(BACKWARD);
+			return move(BACKWARD);
 		}
 		else if(enemyCount) {
 			if(c->range() == 1 && c->place() == BACK) {
-				c->goToPlace(FRONT);
+				return AiAction::goToPlace(FRONT);
 			}
 			else {
-				attackClosest();
+				return attackClosest();
 			}
 		}
 		else if(redshirtCount) {
-			move(FORWARD);
+			return move(FORWARD);
 		}
 		break;
 	}
@@ -92,47 +92,61 @@ void HeroAi::play() {
 		if(c->node() == c->_textMoba->fonxus(c->team())) {
 			// Attack enemies at the Fonxus.
 			if(_groups.count(c->enemyTeam())) {
-				attackClosest();
+				return attackClosest();
 			}
 		}
 		else {
-			move(BACKWARD);
+			return move(BACKWARD);
 		}
 		break;
 	}
 	}
+
+	return AiAction::none();
+}
+
+
+AiState HeroAi::state() const {
+	AiState state = Ai::state();
+	state.status = _status;
+	state.lane   = _lane;
+	return state;
 }
 
 
-void HeroAi::attackClosest() {
+void HeroAi::setState(const AiState& state) {
+	Ai::setState(state);
+	_status = Status(state.status);
+	_lane   = Lane(state.lane);
+}
+
+
+AiAction HeroAi::attackClosest() {
 	// TODO: Attack player target in FOLLOW_PLAYER mode ?
 
-	CharacterSP target = _target.lock();
+	Character* target = this->target();
 
 	if(!target || !target->isAlive() ||
 	        _groups.distanceBetween(character(), target) > character()->range()) {
 		target = _groups.pickClosestEnemy(character());
 	}
 
-	if(target) {
-		_target = target;
-		character()->attack(target);
-	}
+	if(!target)
+		return AiAction::none();
+
+	_target = target->handle();
+	return AiAction::attack(target);
 }
 
 
-bool HeroAi::move(Dir direction) {
+AiAction HeroAi::move(Dir direction) {
 	Team dir = (direction == FORWARD)?
 	               character()->enemyTeam():
 	               character()->team();
-	MapNodeSP dest = character()->node()->destination(teamName(dir));
-	if(!dest) {
-		dest = character()->node()->destination(laneName(_lane));
-	}
+	MapNode* dest = character()->node()->nextHop(dir, _lane);
 
-	if(dest) {
-		character()->moveTo(dest);
-	}
+	if(!dest)
+		return AiAction::none();
 
-	return bool(dest);
+	return AiAction::moveTo(dest);
 }
@@ -44,17 +44,19 @@ public:
 	};
 
 public:
-	HeroAi(CharacterSP character, Lane lane);
+	HeroAi(Character* character, Lane lane);
 
-	virtual void play() override;
+	virtual AiAction decide() override;
 
-	void attackClosest();
-	bool move(Dir direction);
+	virtual AiState state() const override;
+	virtual void setState(const AiState& state) override;
+
+	AiAction attackClosest();
+	AiAction move(Dir direction);
 
 public:
 	Status      _status;
 	Lane        _lane;
-	CharacterWP _target;
 
 	CharacterGroups _groups;
 };
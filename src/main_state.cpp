@@ -78,6 +78,9 @@ MainState::MainState(Game* game)
       _loop(sys()),
       _fpsTime(0),
       _fpsCount(0),
+      _idleRendering(true),
+      _redraw(true),
+      _lastRenderTime(0),
 
       _quitInput(nullptr),
       _leftInput(nullptr),
@@ -86,7 +89,11 @@ MainState::MainState(Game* game)
       _upInput(nullptr),
       _okInput(nullptr),
 
-      _textMoba(this, &_console)
+      _textMoba(&_console),
+      _mapIconStamp(0),
+
+      _consoleVersion(unsigned(-1)),
+      _textMobaVersion(unsigned(-1))
 {
 	_entities.registerComponentManager(&_sprites);
 	_entities.registerComponentManager(&_collisions);
@@ -102,7 +109,7 @@ MainState::~MainState() {
 void MainState::initialize() {
 	using namespace std::placeholders;
 
-	srand(time(nullptr));
+	_textMoba.seed(time(nullptr));
 
 	_loop.reset();
 	_loop.setTickDuration(    ONE_SEC /  TICKS_PER_SEC);
@@ -134,6 +141,7 @@ void MainState::initialize() {
 	_inputs.mapScanCode(_okInput,    SDL_SCANCODE_RETURN);
 	_inputs.mapScanCode(_okInput,    SDL_SCANCODE_RETURN2);
 
+	loadAtlas(_characterAtlas, "characters_atlas.ldl");
 	loadEntities("entities.ldl", _entities.root());
 
 	_models       = _entities.findByName("__models__");
@@ -153,9 +161,10 @@ void MainState::initialize() {
 
 //	AssetSP font = loader()->loadAsset<BitmapFontLoader>("droid_sans_24.json");
 
-	_textMoba.initialize("gameplay.ldl");
+	loadGameplay("gameplay.ldl");
 
-	loader()->waitAll();
+	// Images are still loading at this point: the splash state waits for
+	// everything in _manifest before starting this state.
 
 	// Set to true to debug OpenGL calls
 //	renderer()->context()->setLogCalls(true);
@@ -165,6 +174,9 @@ void MainState::initialize() {
 
 
 void MainState::shutdown() {
+	// Can be attached to bug reports, see league_of_adventure_headless --replay.
+	_textMoba.replay().save("last_replay.tmr");
+
 	_slotTracker.disconnectAll();
 
 	_initialized = false;
@@ -179,6 +191,7 @@ void MainState::run() {
 	_loop.start();
 	_fpsTime  = int64(sys()->getTimeNs());
 	_fpsCount = 0;
+	_redraw   = true;
 
 	startGame();
 
@@ -208,35 +221,152 @@ Game* MainState::game() {
 }
 
 
-void MainState::addMapIcon(CharacterSP character) {
+void MainState::updateMapIcon(Character* character) {
 	if(!character->isAlive() || !character->node())
 		return;
 
 	unsigned index = 5;
 	if(character->type() == REDSHIRT)
 		index = 4;
-	else if(character->cClass()->id() == "tower")
+	else if(character->cClass()->symbol() == SYM_TOWER)
 		index = 3;
-	else if(character->cClass()->id() == "ranger")
+	else if(character->cClass()->symbol() == SYM_RANGER)
 		index = 0;
-	else if(character->cClass()->id() == "warrior")
+	else if(character->cClass()->symbol() == SYM_WARRIOR)
 		index = 1;
-	else if(character->cClass()->id() == "mage")
+	else if(character->cClass()->symbol() == SYM_MAGE)
 		index = 2;
 
 	if(index == 5)
 		return;
 
-	EntityRef e = _entities.cloneEntity(_mapIconModel, _map);
-	e.placeAt(character->node()->pos());
+	// Icons follow their character until it dies or is removed, then go
+	// back to the free list to be reused by the next character displayed.
+	auto it = _mapIcons.find(character);
+	if(it == _mapIcons.end()) {
+		EntityRef e;
+		if(_freeMapIcons.empty()) {
+			e = _entities.cloneEntity(_mapIconModel, _map);
+		}
+		else {
+			e = _freeMapIcons.back();
+			_freeMapIcons.pop_back();
+			e.setEnabled(true);
+		}
+		it = _mapIcons.emplace(character, MapIcon{ e, 0 }).first;
+	}
+	MapIcon& icon = it->second;
+	icon.stamp = _mapIconStamp;
 
-	SpriteComponent* s = _sprites.get(e);
+	// Set every time: a freed character may be replaced by another one at
+	// the same address between two updates.
+	SpriteComponent* s = _sprites.get(icon.entity);
 	s->setTileIndex(index);
 	s->setColor((character->team() == BLUE)?
 	                Vector4(.2, .2, .8, 1):
 	                Vector4(.8, .2, .2, 1));
 
-	_mapCharMap[character->node().get()].push_back(e);
+	_mapCharMap[character->node()].push_back(icon.entity);
+}
+
+
+void MainState::updateMapIcons() {
+	_mapIconStamp += 1;
+
+	// Keep the previous occupancy of each node to only lay out the nodes
+	// that changed. Vectors are cleared, not freed, to keep their storage.
+	_prevMapCharMap.swap(_mapCharMap);
+	for(auto& pair: _mapCharMap) {
+		pair.second.clear();
+	}
+
+	if(_textMoba.player()) {
+		for(const CharacterSP& c: _textMoba.characters()) {
+			updateMapIcon(c.get());
+		}
+	}
+
+	for(auto it = _mapIcons.begin(); it != _mapIcons.end(); ) {
+		if(it->second.stamp != _mapIconStamp) {
+			it->second.entity.setEnabled(false);
+			_freeMapIcons.push_back(it->second.entity);
+			it = _mapIcons.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	const float offset = 16;
+	for(const auto& pair: _mapCharMap) {
+		const EntityVector& entities = pair.second;
+
+		auto prev = _prevMapCharMap.find(pair.first);
+		if(entities.empty() || (prev != _prevMapCharMap.end() && prev->second == entities))
+			continue;
+
+		int width = std::ceil(std::sqrt(entities.size()));
+		int height = (entities.size() - 1) / width + 1;
+		Vector2 base = pair.first->pos() - Vector2(width - 1, -height + 1) * offset / 2;
+
+		int i = 0;
+		for(EntityRef e: entities) {
+			e.placeAt(Vector2(base + Vector2(i % width, -i / width) * offset));
+			i += 1;
+		}
+	}
+}
+
+
+void MainState::updateCharacterView() {
+	CharacterSP player = _textMoba.player();
+
+	// View sprites are kept around and only enabled when needed.
+	unsigned index = 0;
+	if(player && player->isAlive() && player->node()) {
+		CharacterVector viewChars;
+		for(CharacterSP c: player->node()->characters()) {
+			if(c->team() == RED && c->type() != BUILDING) {
+				viewChars.push_back(c);
+			}
+		}
+		const float margin = 120;
+		for(CharacterSP c: viewChars) {
+			float x = 960 / 2;
+			if(viewChars.size() > 1) {
+				x = margin
+				  + index / float(viewChars.size() - 1) * (960 - 2 * margin);
+			}
+
+			if(index == _viewChars.size()) {
+				_viewChars.push_back(_entities.cloneEntity(_charModel, _view));
+			}
+			EntityRef e = _viewChars[index];
+			e.setEnabled(true);
+			e.placeAt(Vector2(x, (c->place() == BACK)? 60: 30));
+			index += 1;
+
+			// Portraits come from the same atlas texture, so the whole view
+			// is drawn without switching textures.
+			SpriteComponent* s = _sprites.get(e);
+			const String& image = c->cClass()->image();
+			int tile = _characterAtlas.tileIndex(image);
+			if(tile >= 0) {
+				s->setTexture(_characterAtlas.texture());
+				s->setTileGridSize(_characterAtlas.tileGrid());
+				s->setTileIndex(tile);
+			}
+			else {
+				s->setTexture(image);
+				s->setTileGridSize(Vector2i(1, 1));
+				s->setTileIndex(0);
+			}
+		}
+	}
+
+	for(; index < _viewChars.size(); ++index) {
+		_viewChars[index].setEnabled(false);
+	}
 }
 
 
@@ -382,6 +512,9 @@ void MainState::keyDown(unsigned scancode, unsigned /*keycode*/, uint16 /*mod*/,
 	case SDL_SCANCODE_BACKSPACE:
 		_console.backspace();
 		break;
+	case SDL_SCANCODE_TAB:
+		_console.complete();
+		break;
 	case SDL_SCANCODE_LEFT:
 		_console.moveCursor(-1);
 		break;
@@ -449,26 +582,7 @@ String alliesDesc(const CharacterSet& chars) {
 	return out.str();
 }
 
-void MainState::updateFrame() {
-	// Update
-
-	BitmapTextComponent* text = _texts.get(_text);
-	if(text) {
-		Vector2i cursor(-1, -1);
-		text->setText(_consoleView.text(&cursor));
-
-		const BitmapFont& font = text->font()->get();
-
-		Vector3 pos(
-		    cursor(0) * font.glyph('m').advance,
-		    -cursor(1) * font.height() + 1020,
-		    0.1
-		);
-		_cursor.setEnabled(cursor(0) >= 0);
-		_cursor.placeAt(pos);
-		_cursor.computeWorldTransform();
-	}
-
+void MainState::updateGameView() {
 	CharacterSP player = _textMoba.player();
 	String stats;
 	if(player) {
@@ -476,7 +590,7 @@ void MainState::updateFrame() {
 		    "lvl ", player->level() + 1, " ", player->teamName(), " ", player->className(), "\n",
 		    " hp:", hpDesc(player), "\n",
 		    " mana:", std::setw(4), player->mana(), " / ", player->maxMana(), "\n",
-		    " xp:", std::setw(6), player->xp(),   " / ", _textMoba.nextLevel(player), "\n",
+		    " xp:", std::setw(6), player->xp(),   " / ", _textMoba.nextLevel(player.get()), "\n",
 		    "\n",
 		    "Skills:\n",
 		    skillDesc(player),
@@ -496,62 +610,54 @@ void MainState::updateFrame() {
 		view->setTexture(player->node()->image());
 	}
 
-	while(_view.firstChild().isValid()) {
-		_view.firstChild().destroy();
-	}
-	if(player && player->isAlive() && player->node()) {
-		CharacterVector viewChars;
-		for(CharacterSP c: player->node()->characters()) {
-			if(c->team() == RED && c->type() != BUILDING) {
-				viewChars.push_back(c);
-			}
-		}
-		const float margin = 120;
-		unsigned index = 0;
-		for(CharacterSP c: viewChars) {
-			float x = 960 / 2;
-			if(viewChars.size() > 1) {
-				x = margin
-				  + index / float(viewChars.size() - 1) * (960 - 2 * margin);
-			}
+	updateCharacterView();
+	updateMapIcons();
+}
 
-			EntityRef e = _entities.cloneEntity(_charModel, _view);
-			e.placeAt(Vector2(x, (c->place() == BACK)? 60: 30));
-			index += 1;
 
-			SpriteComponent* s = _sprites.get(e);
-			s->setTexture(c->cClass()->image());
-		}
+void MainState::updateFrame() {
+	// The game is waiting for input most of the time. When nothing changed
+	// since the last frame, wait for the next event or tick instead of
+	// drawing the same image again. Still redraw from time to time in case
+	// the window content was lost.
+	int64 now = int64(sys()->getTimeNs());
+	bool changed = _redraw
+	            || _consoleVersion  != _consoleView.version()
+	            || _textMobaVersion != _textMoba.version()
+	            || now - _lastRenderTime >= ONE_SEC / IDLE_FRAMES_PER_SEC;
+	if(_idleRendering && !changed) {
+		SDL_WaitEventTimeout(nullptr, 1000 / TICKS_PER_SEC);
+		return;
 	}
+	_redraw         = false;
+	_lastRenderTime = now;
+	TurnProfiler& profiler = _textMoba.profiler();
 
+	// Update
 
-	_mapCharMap.clear();
-	while(_map.firstChild().isValid()) {
-		_map.firstChild().destroy();
-	}
-
-	if(player) {
-		for(CharacterSP c: _textMoba.characters()) {
-			addMapIcon(c);
-		}
+	// Texts and sprites are only rebuilt when what they show changed.
+	BitmapTextComponent* text = _texts.get(_text);
+	if(text && _consoleVersion != _consoleView.version()) {
+		_consoleVersion = _consoleView.version();
 
-		const float offset = 16;
-		for(const auto& pair: _mapCharMap) {
-			const EntityVector& entities = pair.second;
+		Vector2i cursor(-1, -1);
+		text->setText(_consoleView.text(&cursor));
 
-			if(entities.size() < 2)
-				continue;
+		const BitmapFont& font = text->font()->get();
 
-			int width = std::ceil(std::sqrt(entities.size()));
-			int height = (entities.size() - 1) / width + 1;
-			Vector2 base = entities[0].position2() - Vector2(width - 1, -height + 1) * offset / 2;
+		Vector3 pos(
+		    cursor(0) * font.glyph('m').advance,
+		    -cursor(1) * font.height() + 1020,
+		    0.1
+		);
+		_cursor.setEnabled(cursor(0) >= 0);
+		_cursor.placeAt(pos);
+		_cursor.computeWorldTransform();
+	}
 
-			int i = 0;
-			for(EntityRef e: entities) {
-				e.placeAt(Vector2(base + Vector2(i % width, -i / width) * offset));
-				i += 1;
-			}
-		}
+	if(_textMobaVersion != _textMoba.version()) {
+		_textMobaVersion = _textMoba.version();
+		updateGameView();
 	}
 
 
@@ -591,18 +697,23 @@ void MainState::updateFrame() {
 	window()->swapBuffers();
 //	glc->setLogCalls(true);
 
-	int64 now = int64(sys()->getTimeNs());
+	int64 end = int64(sys()->getTimeNs());
+	profiler.addSample(PROF_FRAME, end - now);
+
+	// See the perf command.
 	++_fpsCount;
-	int64 etime = now - _fpsTime;
+	int64 etime = end - _fpsTime;
 	if(etime >= ONE_SEC) {
-		log().info("Fps: ", _fpsCount * float(ONE_SEC) / etime);
-		_fpsTime  = now;
+		profiler.addSample(PROF_FPS, _fpsCount * uint64(ONE_SEC) / etime);
+		_fpsTime  = end;
 		_fpsCount = 0;
 	}
 }
 
 
 void MainState::resizeEvent() {
+	_redraw = true;
+
 	Box3 viewBox(Vector3(0, 0, 0),
 	             Vector3(VIEW_WIDTH,
 	                     VIEW_HEIGHT, 1));
@@ -627,5 +738,61 @@ bool MainState::loadEntities(const Path& path, EntityRef parent, const Path& cd)
 
 	errors.log(log());
 
+	_manifest.addEntities(realPath, localPath, log());
+
 	return success;
 }
+
+
+bool MainState::loadAtlas(TextureAtlas& atlas, const Path& path) {
+	log().info("Load atlas \"", path, "\"");
+
+	if(!atlas.load(game()->dataPath() / path, path, log()))
+		return false;
+
+	loader()->load<ImageLoader>(atlas.texture());
+	_manifest.addImage(atlas.texture());
+
+	return true;
+}
+
+
+bool MainState::loadGameplay(const Path& path) {
+	log().info("Load gameplay \"", path, "\"");
+
+	VirtualFile file = game()->fileSystem()->file(path);
+
+	Path realPath = file.realPath();
+	const MemFile* memFile = file.fileBuffer();
+	if(!realPath.empty()) {
+		Path::IStream in(realPath.native().c_str());
+		if(!_textMoba.initialize(in, path))
+			return false;
+	}
+	else if(memFile) {
+		String buffer((const char*)memFile->data, memFile->size);
+		std::istringstream in(buffer);
+		if(!_textMoba.initialize(in, path))
+			return false;
+	}
+	else {
+		log().error("Unable to read \"", path, "\".");
+		return false;
+	}
+
+	// TextMoba only knows about game rules, so we load the images it refers
+	// to here. Images packed in an atlas are never drawn on their own.
+	for(const String& img: _textMoba.images()) {
+		if(_characterAtlas.contains(img))
+			continue;
+		loader()->load<ImageLoader>(img);
+		_manifest.addImage(img);
+	}
+
+	return true;
+}
+
+
+const AssetManifest& MainState::manifest() const {
+	return _manifest;
+}
@@ -40,8 +40,10 @@
 #include <lair/ec/bitmap_text_component.h>
 #include <lair/ec/tile_layer_component.h>
 
+#include "asset_manifest.h"
 #include "console.h"
 #include "text_moba.h"
+#include "texture_atlas.h"
 
 
 using namespace lair;
@@ -53,6 +55,8 @@ class MainState;
 enum {
 	TICKS_PER_SEC  = 60,
 	FRAMES_PER_SEC = 60,
+	// Minimum redraw rate when idle, in frames per second.
+	IDLE_FRAMES_PER_SEC = 1,
 	VIEW_WIDTH     = 1920,
 	VIEW_HEIGHT    = 1080,
 };
@@ -72,6 +76,12 @@ typedef std::deque<CommandExpr> CommandList;
 typedef std::vector<EntityRef> EntityVector;
 typedef std::unordered_map<MapNode*, EntityVector> MapCharMap;
 
+struct MapIcon {
+	EntityRef entity;
+	unsigned  stamp;
+};
+typedef std::unordered_map<const Character*, MapIcon> MapIconMap;
+
 
 class MainState : public GameState {
 public:
@@ -86,7 +96,9 @@ public:
 
 	Game* game();
 
-	void addMapIcon(CharacterSP character);
+	void updateMapIcon(Character* character);
+	void updateMapIcons();
+	void updateCharacterView();
 
 	void exec(const std::string& cmd, EntityRef self = EntityRef());
 	void exec(const CommandList& commands);
@@ -110,12 +122,18 @@ public:
 	           bool pressed, bool repeat);
 
 	void updateTick();
+	void updateGameView();
 	void updateFrame();
 
 	void resizeEvent();
 
 	bool loadEntities(const Path& path, EntityRef parent = EntityRef(),
 	                  const Path& cd = Path());
+	bool loadAtlas(TextureAtlas& atlas, const Path& path);
+	bool loadGameplay(const Path& path);
+
+	// Images used by this state, see SplashState::preload.
+	const AssetManifest& manifest() const;
 
 public:
 	// More or less system stuff
@@ -146,6 +164,11 @@ public:
 	int64       _fpsTime;
 	unsigned    _fpsCount;
 
+	// When set, frames are only drawn when something changed on screen.
+	bool        _idleRendering;
+	bool        _redraw;
+	int64       _lastRenderTime;
+
 	CommandMap  _commands;
 	CommandList _commandList;
 
@@ -156,8 +179,20 @@ public:
 	Input*      _upInput;
 	Input*      _okInput;
 
+	AssetManifest _manifest;
+	TextureAtlas  _characterAtlas;
+
 	TextMoba    _textMoba;
 	MapCharMap  _mapCharMap;
+	MapCharMap  _prevMapCharMap;
+	MapIconMap  _mapIcons;
+	EntityVector _freeMapIcons;
+	unsigned    _mapIconStamp;
+	EntityVector _viewChars;
+
+	// Versions of the console view and of the game state last displayed.
+	unsigned    _consoleVersion;
+	unsigned    _textMobaVersion;
 
 	EntityRef   _models;
 	EntityRef   _charModel;
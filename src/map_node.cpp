@@ -19,6 +19,8 @@
  */
 
 
+#include <algorithm>
+
 #include <lair/core/log.h>
 
 #include "character_class.h"
@@ -33,69 +35,21 @@ using namespace lair;
 CharacterGroups::CharacterGroups(const MapNode* node)
     : _node(node)
 {
-	if(!_node) {
-		return;
-	}
-
-	_characters.resize(node->_characters.size());
-	std::copy(node->_characters.begin(), node->_characters.end(),
-	          _characters.begin());
-
-	std::stable_sort(_characters.begin(), _characters.end(),
-	                 [](CharacterSP c0, CharacterSP c1) {
-		if(c0->team() < c1->team())
-			return true;
-		if(c1->team() < c0->team())
-			return false;
-
-		if(c0->place() < c1->place())
-			return true;
-		return false;
-	});
-
-	_indices[0] = 0;
-
-	_indices[1] = _indices[0];
-	while(_indices[1] < count() &&
-	      get(_indices[1])->team() == BLUE &&
-	      get(_indices[1])->place() == BACK)
-		_indices[1] += 1;
-
-	_indices[2] = _indices[1];
-	while(_indices[2] < count() &&
-	      get(_indices[2])->team() == BLUE &&
-	      get(_indices[2])->place() == FRONT)
-		_indices[2] += 1;
-
-	_indices[3] = _indices[2];
-	while(_indices[3] < count() &&
-	      get(_indices[3])->team() == RED &&
-	      get(_indices[3])->place() == BACK)
-		_indices[3] += 1;
-
-	_indices[4] = count();
-
-//	dbgLogger.warning("Groups: ", _indices[0], ", ", _indices[1],
-//	        ", ", _indices[2], ", ", _indices[3], ", ", _indices[4]);
-//	unsigned i = 0;
-//	for(CharacterSP c: _characters) {
-//		dbgLogger.info("  ", i++, ": ", c->className(), " ", c->index());
-//	}
 }
 
 
 unsigned CharacterGroups::count() const {
-	return _characters.size();
+	return count(BLUE) + count(RED);
 }
 
 
 unsigned CharacterGroups::count(Team team) const {
-	return _index(team + 1, 0) - _index(team, 0);
+	return count(team, BACK) + count(team, FRONT);
 }
 
 
 unsigned CharacterGroups::count(Team team, Place place) const {
-	return _index(team, place + 1) - _index(team, place);
+	return _row(team, place).size();
 }
 
 
@@ -111,24 +65,30 @@ unsigned CharacterGroups::count(CharType type, Team team) const {
 }
 
 
-CharacterSP CharacterGroups::get(unsigned index) const {
-	return _characters.at(index);
+const CharacterSP& CharacterGroups::get(unsigned index) const {
+	unsigned blueCount = count(BLUE);
+	if(index < blueCount)
+		return get(BLUE, index);
+	return get(RED, index - blueCount);
 }
 
 
-CharacterSP CharacterGroups::get(Team team, unsigned index) const {
-	return _characters.at(_index(team, 0) + index);
+const CharacterSP& CharacterGroups::get(Team team, unsigned index) const {
+	unsigned backCount = count(team, BACK);
+	if(index < backCount)
+		return get(team, BACK, index);
+	return get(team, FRONT, index - backCount);
 }
 
 
-CharacterSP CharacterGroups::get(Team team, Place place, unsigned index) const {
-	return _characters.at(_index(team, place) + index);
+const CharacterSP& CharacterGroups::get(Team team, Place place, unsigned index) const {
+	return _row(team, place).at(index);
 }
 
 
-unsigned CharacterGroups::distanceBetween(CharacterSP c0, CharacterSP c1) const {
-	if(!c0->isAlive() || c0->node().get() != _node ||
-	   !c1->isAlive() || c1->node().get() != _node)
+unsigned CharacterGroups::distanceBetween(const Character* c0, const Character* c1) const {
+	if(!c0->isAlive() || c0->node() != _node ||
+	   !c1->isAlive() || c1->node() != _node)
 		return 9999;
 
 	int p0 = c0->placeIndex();
@@ -150,15 +110,16 @@ unsigned CharacterGroups::distanceBetween(CharacterSP c0, CharacterSP c1) const
 }
 
 
-CharacterSP CharacterGroups::pick(Team team, Place place) const {
+Character* CharacterGroups::pick(Team team, Place place) const {
 	unsigned c = count(team, place);
 	if(c == 0)
-		return CharacterSP();
-	return get(team, place, rand() % c);
+		return nullptr;
+	TextMoba* tm = get(team, place, 0)->_textMoba;
+	return get(team, place, tm->random(c)).get();
 }
 
 
-CharacterSP CharacterGroups::pickClosestEnemy(CharacterSP c, int range) const {
+Character* CharacterGroups::pickClosestEnemy(const Character* c, int range) const {
 	if(range < 0)
 		range = c->range();
 
@@ -179,12 +140,15 @@ CharacterSP CharacterGroups::pickClosestEnemy(CharacterSP c, int range) const {
 		return pick(enemy, BACK);
 	}
 
-	return CharacterSP();
+	return nullptr;
 }
 
 
-unsigned CharacterGroups::_index(unsigned team, unsigned place) const {
-	return _indices[2 * team + place];
+const CharacterVector& CharacterGroups::_row(unsigned team, unsigned place) const {
+	static const CharacterVector empty;
+	if(!_node)
+		return empty;
+	return _node->row(Team(team), Place(place));
 }
 
 
@@ -205,12 +169,22 @@ void CharacterGroups::dump() const {
 }
 
 
+MapNode::MapNode()
+    : _symbol(NO_SYMBOL)
+{
+}
+
 
 const String& MapNode::id() const {
 	return _id;
 }
 
 
+SymbolId MapNode::symbol() const {
+	return _symbol;
+}
+
+
 const String& MapNode::name() const {
 	return _name;
 }
@@ -221,21 +195,23 @@ const MapNode::NodeMap& MapNode::paths() const {
 }
 
 
-MapNodeSP MapNode::destination(const String& direction) const {
-	for(const auto& pair: _paths) {
-		for(const String& dir: pair.second) {
-			if(dir == direction) {
-				return pair.first->shared_from_this();
-			}
-		}
-	}
-	return MapNodeSP();
+MapNode* MapNode::destination(DirectionId direction) const {
+	if(direction >= _destinations.size())
+		return nullptr;
+	return _destinations[direction];
+}
+
+
+MapNode* MapNode::nextHop(Team toward, Lane lane) const {
+	if(lane >= _nextHop[toward].size())
+		return nullptr;
+	return _nextHop[toward][lane];
 }
 
 
 const String& MapNode::image() const {
 	for(CharacterSP c: _characters) {
-		if(c->cClass()->id() == "tower")
+		if(c->cClass()->symbol() == SYM_TOWER)
 			return _images.front();
 	}
 	return _images.back();
@@ -258,18 +234,13 @@ const String& MapNode::fonxus() const {
 
 
 CharacterSP MapNode::characterAt(unsigned index) const {
-	auto it  = _characters.begin();
-	auto end = _characters.end();
-	for(unsigned i = 0; it != end && i < index; ++i)
-		++it;
-
-	if(it == _characters.end())
+	if(index >= _characters.size())
 		return CharacterSP();
-	return *it;
+	return _characters[index];
 }
 
 
-const CharacterSet& MapNode::characters() const {
+const CharacterVector& MapNode::characters() const {
 	return _characters;
 }
 
@@ -279,11 +250,11 @@ CharacterGroups MapNode::characterGroups() const {
 }
 
 
-unsigned MapNode::characterIndex(CharacterCSP character) const {
-	auto it = _characters.find(std::const_pointer_cast<Character>(character));
+unsigned MapNode::characterIndex(const Character* character) const {
+	auto it = std::lower_bound(_characters.begin(), _characters.end(), character, CharacterOrder());
 
-	if(it == _characters.end()) {
-		dbgLogger.error("MapNode::characterName: character ", character->debugName(),
+	if(it == _characters.end() || it->get() != character) {
+		character->_textMoba->log().error("MapNode::characterName: character ", character->debugName(),
 		                " not found.");
 		return 0;
 	}
@@ -292,11 +263,65 @@ unsigned MapNode::characterIndex(CharacterCSP character) const {
 }
 
 
+const CharacterVector& MapNode::row(Team team, Place place) const {
+	return _rows[_rowIndex(team, place)];
+}
+
+
 void MapNode::addCharacter(CharacterSP character) {
-	_characters.emplace(character);
+	auto it = std::lower_bound(_characters.begin(), _characters.end(), character, CharacterOrder());
+	if(it != _characters.end() && *it == character)
+		return;
+	_characters.insert(it, character);
+
+	CharacterVector& row = _rows[_rowIndex(character->team(), character->place())];
+	auto rit = std::lower_bound(row.begin(), row.end(), character, CharacterOrder());
+	row.insert(rit, std::move(character));
+}
+
+
+CharacterSP MapNode::removeCharacter(const Character* character) {
+	auto cit = std::lower_bound(_characters.begin(), _characters.end(), character, CharacterOrder());
+	if(cit == _characters.end() || cit->get() != character)
+		return CharacterSP();
+	CharacterSP removed = std::move(*cit);
+	_characters.erase(cit);
+
+	CharacterVector& row = _rows[_rowIndex(character->team(), character->place())];
+	auto it = std::lower_bound(row.begin(), row.end(), character, CharacterOrder());
+	lairAssert(it != row.end() && it->get() == character);
+	row.erase(it);
+
+	return removed;
+}
+
+
+void MapNode::placeCharacter(Character* character, Place place) {
+	lairAssert(character->node() == this);
+
+	CharacterVector& from = _rows[_rowIndex(character->team(), character->place())];
+	auto it = std::lower_bound(from.begin(), from.end(), character, CharacterOrder());
+	lairAssert(it != from.end() && it->get() == character);
+	CharacterSP placed = std::move(*it);
+	from.erase(it);
+
+	character->_setPlace(place);
+
+	CharacterVector& to = _rows[_rowIndex(character->team(), place)];
+	to.insert(std::lower_bound(to.begin(), to.end(), character, CharacterOrder()),
+	          std::move(placed));
+}
+
+
+void MapNode::clearCharacters() {
+	_characters.clear();
+	for(CharacterVector& row: _rows) {
+		row.clear();
+	}
 }
 
 
-void MapNode::removeCharacter(CharacterSP character) {
-	_characters.erase(character);
+unsigned MapNode::_rowIndex(Team team, Place place) const {
+	lairAssert(team == BLUE || team == RED);
+	return 2 * team + place;
 }
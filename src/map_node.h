@@ -28,6 +28,9 @@
 #include "text_moba.h"
 
 
+// A view of the characters of a node sorted by team, then by place. It
+// does not copy anything: it reads the rows maintained by the node, so it
+// reflects changes made to the node after its creation.
 class CharacterGroups {
 public:
 	CharacterGroups(const MapNode* node = nullptr);
@@ -37,36 +40,41 @@ public:
 	unsigned count(Team team, Place place) const;
 	unsigned count(CharType type, Team team) const;
 
-	CharacterSP get(unsigned index) const;
-	CharacterSP get(Team team, unsigned index) const;
-	CharacterSP get(Team team, Place place, unsigned index) const;
+	const CharacterSP& get(unsigned index) const;
+	const CharacterSP& get(Team team, unsigned index) const;
+	const CharacterSP& get(Team team, Place place, unsigned index) const;
 
-	unsigned distanceBetween(CharacterSP c0, CharacterSP c1) const;
+	unsigned distanceBetween(const Character* c0, const Character* c1) const;
 
-	CharacterSP pick(Team team, Place place) const;
-	CharacterSP pickClosestEnemy(CharacterSP c, int range = -1) const;
+	Character* pick(Team team, Place place) const;
+	Character* pickClosestEnemy(const Character* c, int range = -1) const;
 
-	unsigned _index(unsigned team, unsigned place) const;
+	const CharacterVector& _row(unsigned team, unsigned place) const;
 
 	void dump() const;
 
 public:
 	const MapNode* _node;
-	CharacterVector _characters;
-	unsigned _indices[5];
 };
 
 
 class MapNode : public std::enable_shared_from_this<MapNode> {
 public:
 	typedef std::unordered_map<MapNode*, StringVector> NodeMap;
+	typedef std::vector<MapNode*> NodeVector;
 
 public:
+	MapNode();
+
 	const lair::String& id() const;
+	SymbolId symbol() const;
 	const lair::String& name() const;
 
 	const NodeMap& paths() const;
-	MapNodeSP destination(const lair::String& direction) const;
+	MapNode* destination(DirectionId direction) const;
+	// Where a character of a lane goes to walk toward the fonxus of team
+	// `toward`, or nullptr if it is there already or the lane does not exist.
+	MapNode* nextHop(Team toward, Lane lane) const;
 
 	const lair::String& image() const;
 	const lair::Vector2& pos() const;
@@ -75,16 +83,27 @@ public:
 	const lair::String& fonxus() const;
 
 	CharacterSP characterAt(unsigned index) const;
-	const CharacterSet& characters() const;
+	// Sorted in CharacterOrder: the index of a character is its position.
+	const CharacterVector& characters() const;
 	CharacterGroups characterGroups() const;
 
-	unsigned characterIndex(CharacterCSP character) const;
+	unsigned characterIndex(const Character* character) const;
+
+	const CharacterVector& row(Team team, Place place) const;
 
 	void addCharacter(CharacterSP character);
-	void removeCharacter(CharacterSP character);
+	// Returns the shared pointer the node held, or null if character was
+	// not there.
+	CharacterSP removeCharacter(const Character* character);
+	// Only moves character between rows, its index does not depend on place.
+	void placeCharacter(Character* character, Place place);
+	void clearCharacters();
+
+	unsigned _rowIndex(Team team, Place place) const;
 
 public:
 	lair::String  _id;
+	SymbolId      _symbol;
 	lair::String  _name;
 	NodeMap       _paths;
 	StringVector  _images;
@@ -92,12 +111,17 @@ public:
 	lair::String  _tower;
 	lair::String  _fonxus;
 
-	CharacterSet  _characters;
+	// Built from _paths by TextMoba::_buildNavigation().
+	NodeVector    _destinations;
+	// By team, then lane.
+	NodeVector    _nextHop[2];
+
+	// In CharacterOrder, so characters can be found by bisection and
+	// addressed by index.
+	CharacterVector _characters;
 
-	mutable CharacterVector _blueBackChars;
-	mutable CharacterVector _blueFrontChars;
-	mutable CharacterVector _redBackChars;
-	mutable CharacterVector _redFrontChars;
+	// Characters by (team, place), in CharacterOrder, indexed by _rowIndex.
+	CharacterVector _rows[4];
 };
 
 
@@ -0,0 +1,319 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "map_node.h"
+#include "character_class.h"
+#include "character.h"
+#include "skill.h"
+#include "gameplay_bundle.h"
+
+#include "match_batch.h"
+
+
+using namespace lair;
+
+
+MatchBatch::Game::Game(const GameplayBundleCSP& gameplay)
+    : masterLogger()
+    , logger("batch", &masterLogger, LogLevel::Warning)
+    , textMoba()
+    , seed(0)
+    , initialized(false)
+{
+	textMoba.setLogger(&logger);
+	textMoba.setLogEvents(false);
+	textMoba.setAutoPlayer(false);
+	initialized = textMoba.initialize(gameplay);
+}
+
+
+MatchBatch::MatchBatch(const GameplayBundleCSP& gameplay, unsigned gameCount,
+                       unsigned slotCount, unsigned threadCount)
+    : _slotCount(0)
+    , _maxTurns(10000)
+    , _className("warrior")
+    , _pool(threadCount)
+{
+	_games.reserve(gameCount);
+	for(unsigned i = 0; i < gameCount; ++i) {
+		_games.emplace_back(new Game(gameplay));
+	}
+
+	BatchObservations& obs = _observations;
+	obs.gameCount = gameCount;
+
+	obs.turn    .assign(gameCount, 0);
+	obs.done    .assign(gameCount, 0);
+	obs.winner  .assign(gameCount, NEUTRAL);
+	obs.invalid .assign(gameCount, 0);
+	obs.player  .assign(gameCount, 0);
+	obs.cooldown.assign(gameCount * MAX_SKILLS, 0);
+
+	_resize(slotCount);
+}
+
+
+MatchBatch::~MatchBatch() {
+}
+
+
+bool MatchBatch::isValid() const {
+	for(const GameUP& game: _games) {
+		if(!game->initialized)
+			return false;
+	}
+	return true;
+}
+
+
+unsigned MatchBatch::gameCount() const {
+	return _games.size();
+}
+
+
+unsigned MatchBatch::slotCount() const {
+	return _slotCount;
+}
+
+
+TextMoba& MatchBatch::game(unsigned index) {
+	return _games[index]->textMoba;
+}
+
+
+unsigned MatchBatch::maxTurns() const {
+	return _maxTurns;
+}
+
+
+void MatchBatch::setMaxTurns(unsigned maxTurns) {
+	_maxTurns = maxTurns;
+}
+
+
+const BatchObservations& MatchBatch::reset(const String& className, unsigned seed) {
+	lairAssert(isValid());
+	_className = className;
+
+	_pool.run(_games.size(), [this, seed](unsigned index) {
+		Game& game = *_games[index];
+		game.seed = seed + index;
+		game.textMoba.restart(_className, game.seed);
+
+		_observations.done[index]    = 0;
+		_observations.winner[index]  = NEUTRAL;
+		_observations.invalid[index] = 0;
+	});
+	_observeAll();
+
+	return _observations;
+}
+
+
+const BatchObservations& MatchBatch::step(const BatchAction* actions) {
+	lairAssert(isValid());
+	_pool.run(_games.size(), [this, actions](unsigned index) {
+		Game&     game     = *_games[index];
+		TextMoba& textMoba = game.textMoba;
+
+		_observations.invalid[index] = !_apply(textMoba, actions[index]);
+		textMoba.nextTurn();
+
+		bool done = textMoba.isOver() || textMoba._turn >= _maxTurns;
+		_observations.done[index]   = done;
+		_observations.winner[index] = textMoba.winner();
+		if(done) {
+			game.seed += _games.size();
+			textMoba.restart(_className, game.seed);
+		}
+	});
+	_observeAll();
+
+	return _observations;
+}
+
+
+const BatchObservations& MatchBatch::observations() const {
+	return _observations;
+}
+
+
+// Checks done as in AttackCommand and UseCommand, but actions name their
+// targets by slot instead of by position on the node.
+bool MatchBatch::_apply(TextMoba& textMoba, const BatchAction& action) {
+	const CharacterSP& player = textMoba.player();
+	if(action.type == ACTION_WAIT)
+		return true;
+	if(!player->isAlive())
+		return false;
+
+	// Characters in the slots of the store may have been destroyed, only
+	// those still on the node can be targeted.
+	MapNode* here = player->node();
+	auto target = [here](unsigned slot) -> CharacterSP {
+		for(const CharacterSP& c: here->characters()) {
+			if(c->handle().index == slot)
+				return c->isAlive()? c: CharacterSP();
+		}
+		return CharacterSP();
+	};
+
+	switch(action.type) {
+	case ACTION_GO: {
+		if(action.param >= textMoba.directionCount())
+			return false;
+		MapNode* dest = player->node()->destination(action.param);
+		if(!dest)
+			return false;
+		textMoba.moveCharacter(player, dest);
+		return true;
+	}
+	case ACTION_MOVE: {
+		if(action.param > FRONT || Place(action.param) == player->place())
+			return false;
+		textMoba.placeCharacter(player->handle(), Place(action.param));
+		return true;
+	}
+	case ACTION_ATTACK: {
+		CharacterSP foe = target(action.target);
+		if(!foe || foe->team() == player->team())
+			return false;
+		CharacterGroups groups = player->node()->characterGroups();
+		if(groups.distanceBetween(player.get(), foe.get()) > player->range())
+			return false;
+		player->attack(foe->handle());
+		return true;
+	}
+	case ACTION_SKILL: {
+		const SkillVector& skills = player->skills();
+		if(action.param >= skills.size() || !skills[action.param]->usable())
+			return false;
+		const SkillSP& skill = skills[action.param];
+
+		CharacterVector targets;
+		if(skill->target() == SINGLE) {
+			CharacterSP c = target(action.target);
+			if(!c || c->team() != skill->targetTeam())
+				return false;
+			targets = skill->targets(c);
+		}
+		else if(skill->target() == ANY_ROW) {
+			if(action.target > FRONT)
+				return false;
+			targets = skill->targets(Place(action.target));
+		}
+		else {
+			targets = skill->targets();
+		}
+		if(targets.empty())
+			return false;
+
+		player->_setMana(player->mana() - skill->manaCost());
+		skill->useOn(targets);
+		return true;
+	}
+	}
+
+	return false;
+}
+
+
+void MatchBatch::_resize(unsigned slotCount) {
+	_slotCount = slotCount;
+
+	BatchObservations& obs = _observations;
+	obs.slotCount = slotCount;
+
+	unsigned size = obs.gameCount * slotCount;
+	obs.classSymbol.assign(size, NO_SYMBOL);
+	obs.node       .assign(size, NO_SYMBOL);
+	obs.team       .assign(size, NEUTRAL);
+	obs.place      .assign(size, BACK);
+	obs.level      .assign(size, 0);
+	obs.hp         .assign(size, 0);
+	obs.mana       .assign(size, 0);
+}
+
+
+// Slot arrays first grow to fit every store, so no character is left out.
+// Each game then fills its own part of the arrays.
+void MatchBatch::_observeAll() {
+	unsigned slotCount = _slotCount;
+	for(const GameUP& game: _games) {
+		slotCount = std::max(slotCount, game->textMoba.characterStore().slotCount());
+	}
+	if(slotCount > _slotCount)
+		_resize(slotCount);
+
+	_pool.run(_games.size(), [this](unsigned index) {
+		_observe(index);
+	});
+}
+
+
+void MatchBatch::_observe(unsigned index) {
+	const TextMoba&       textMoba = _games[index]->textMoba;
+	const CharacterStore& store    = textMoba.characterStore();
+	BatchObservations&    obs      = _observations;
+
+	obs.turn[index]   = textMoba._turn;
+	obs.player[index] = textMoba.player()->handle().index;
+
+	const SkillVector& skills = textMoba.player()->skills();
+	uint32* cooldown = &obs.cooldown[index * MAX_SKILLS];
+	for(unsigned i = 0; i < MAX_SKILLS; ++i) {
+		cooldown[i] = (i < skills.size())? skills[i]->timeBeforeNextUse(): 0;
+	}
+
+	unsigned count  = store.slotCount();
+	unsigned offset = index * _slotCount;
+	lairAssert(count <= _slotCount);
+
+	std::copy(store._team .begin(), store._team .begin() + count, obs.team .begin() + offset);
+	std::copy(store._place.begin(), store._place.begin() + count, obs.place.begin() + offset);
+	std::copy(store._level.begin(), store._level.begin() + count, obs.level.begin() + offset);
+	std::copy(store._hp   .begin(), store._hp   .begin() + count, obs.hp   .begin() + offset);
+	std::copy(store._mana .begin(), store._mana .begin() + count, obs.mana .begin() + offset);
+
+	// Slots keep the pointers of characters destroyed during the turn until
+	// the next one starts, so present slots are marked from the live set.
+	uint32* classSymbol = &obs.classSymbol[offset];
+	uint32* node        = &obs.node[offset];
+	std::fill(classSymbol, classSymbol + _slotCount, NO_SYMBOL);
+	for(const CharacterSP& c: textMoba.characters()) {
+		unsigned slot = c->handle().index;
+		classSymbol[slot] = c->cClass()->symbol();
+		node[slot]        = c->node()? c->node()->symbol(): NO_SYMBOL;
+	}
+
+	for(unsigned i = 0; i < _slotCount; ++i) {
+		if(classSymbol[i] != NO_SYMBOL)
+			continue;
+		obs.node [offset + i] = NO_SYMBOL;
+		obs.team [offset + i] = NEUTRAL;
+		obs.place[offset + i] = BACK;
+		obs.level[offset + i] = 0;
+		obs.hp   [offset + i] = 0;
+		obs.mana [offset + i] = 0;
+	}
+}
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_MATCH_BATCH_H_
+#define LD41_MATCH_BATCH_H_
+
+
+#include <memory>
+#include <vector>
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+
+#include "text_moba.h"
+#include "worker_pool.h"
+
+
+// What the hero controlled in a game of a MatchBatch does during a turn.
+enum BatchActionType {
+	ACTION_WAIT,
+	ACTION_GO,     // Walk toward direction param, see TextMoba::directionId().
+	ACTION_MOVE,   // Move to row param (a Place).
+	ACTION_ATTACK, // Attack the character in slot target.
+	ACTION_SKILL,  // Use skill param on the character in slot target, on row
+	               // target for row skills, ignored for the others.
+};
+
+struct BatchAction {
+	lair::uint8  type;
+	lair::uint8  param;
+	lair::uint16 target;
+};
+
+
+// Observations of all the games of a MatchBatch after a step, as dense
+// arrays. Per-slot arrays hold slotCount values per game, slot i of game g
+// being at g * slotCount + i. Slots are those of the CharacterStore of the
+// game: a character keeps its slot while it lives. slotCount grows with the
+// largest store of the games, so it may change after any step.
+struct BatchObservations {
+	unsigned gameCount = 0;
+	unsigned slotCount = 0;
+
+	// Per game.
+	std::vector<lair::uint32> turn;
+	std::vector<lair::uint8>  done;     // The game ended during the step and restarted.
+	std::vector<lair::uint8>  winner;   // Of the game that ended, NEUTRAL on draws.
+	std::vector<lair::uint8>  invalid;  // The action could not be done, the hero waited.
+	std::vector<lair::uint32> player;   // Slot of the controlled hero.
+	// MAX_SKILLS per game: turns before each skill of the hero is ready.
+	std::vector<lair::uint32> cooldown;
+
+	// Per slot. Free slots have classSymbol and node NO_SYMBOL, team
+	// NEUTRAL and zero elsewhere.
+	std::vector<lair::uint32> classSymbol;
+	std::vector<lair::uint32> node;     // NO_SYMBOL when not on the map.
+	std::vector<lair::uint8>  team;
+	std::vector<lair::uint8>  place;
+	std::vector<lair::uint32> level;
+	std::vector<lair::uint32> hp;
+	std::vector<lair::uint32> mana;
+};
+
+
+// Steps many small headless games in lockstep, for training hero AIs: each
+// step applies one action per game to its player, then plays a turn.
+//
+// Rules are those of TextMoba, so batched games play exactly like regular
+// ones. Games are spread over a WorkerPool, each game only touching its own
+// state, and observations are copied from the structure-of-arrays
+// CharacterStore of each game with plain loops over its arrays.
+class MatchBatch {
+public:
+	static const unsigned MAX_SKILLS = 4;
+
+public:
+	// slotCount is the initial number of slots per game in the observations.
+	MatchBatch(const GameplayBundleCSP& gameplay, unsigned gameCount,
+	           unsigned slotCount = 256, unsigned threadCount = 1);
+	MatchBatch(const MatchBatch&) = delete;
+	~MatchBatch();
+
+	MatchBatch& operator=(const MatchBatch&) = delete;
+
+	// False if the games could not be initialized from the gameplay data, in
+	// which case the batch must not be reset or stepped.
+	bool isValid() const;
+
+	unsigned gameCount() const;
+	unsigned slotCount() const;
+	TextMoba& game(unsigned index);
+
+	// Games stopped after maxTurns count as draws (default: 10000).
+	unsigned maxTurns() const;
+	void setMaxTurns(unsigned maxTurns);
+
+	// Restarts every game with a player of class className. Game i plays
+	// seeds seed + i, then seed + i + gameCount, etc. each time it ends, so
+	// results do not depend on the number of threads.
+	const BatchObservations& reset(const lair::String& className, unsigned seed);
+
+	// actions must hold gameCount() actions.
+	const BatchObservations& step(const BatchAction* actions);
+
+	const BatchObservations& observations() const;
+
+private:
+	struct Game {
+		Game(const GameplayBundleCSP& gameplay);
+
+		lair::MasterLogger masterLogger;
+		lair::Logger       logger;
+		TextMoba           textMoba;
+		unsigned           seed;
+		bool               initialized;
+	};
+
+	typedef std::unique_ptr<Game> GameUP;
+	typedef std::vector<GameUP>   GameVector;
+
+private:
+	bool _apply(TextMoba& textMoba, const BatchAction& action);
+	void _resize(unsigned slotCount);
+	void _observeAll();
+	void _observe(unsigned index);
+
+private:
+	GameVector        _games;
+	unsigned          _slotCount;
+	unsigned          _maxTurns;
+	lair::String      _className;
+	WorkerPool        _pool;
+	BatchObservations _observations;
+};
+
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <iostream>
+#include <thread>
+
+#include "match_save.h"
+#include "gameplay_bundle.h"
+
+#include "match_runner.h"
+
+
+using namespace lair;
+
+
+MatchRunner::Worker::Worker(TelemetryFile* telemetryFile)
+    : logBackend(std::clog)
+    , masterLogger()
+    , logger("match", &masterLogger, LogLevel::Warning)
+    , textMoba()
+    , telemetry(telemetryFile)
+{
+	masterLogger.addBackend(&logBackend);
+
+	textMoba.setLogger(&logger);
+	textMoba.setLogEvents(false);
+	textMoba.setAutoPlayer(true);
+}
+
+
+MatchRunner::MatchRunner(const Path& logicPath, unsigned threadCount)
+    : _logicPath(logicPath)
+    , _threadCount(threadCount)
+    , _nextMatch(0)
+{
+	if(_threadCount == 0)
+		_threadCount = std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+unsigned MatchRunner::threadCount() const {
+	return _threadCount;
+}
+
+
+void MatchRunner::addMatch(const MatchConfig& config) {
+	_configs.push_back(config);
+}
+
+
+bool MatchRunner::run() {
+	unsigned threadCount = std::min<unsigned>(_threadCount, _configs.size());
+
+	// Gameplay data is loaded from the main thread, as the parser reports
+	// errors through the shared dbgLogger.
+	if(!_gameplay) {
+		std::shared_ptr<GameplayBundle> gameplay = std::make_shared<GameplayBundle>();
+		if(!gameplay->load(_logicPath, dbgLogger)) {
+			_results.assign(_configs.size(), MatchResult{ NEUTRAL, 0 });
+			return false;
+		}
+		_gameplay = gameplay;
+	}
+	while(_workers.size() < threadCount) {
+		WorkerUP worker(new Worker(&_telemetryFile));
+		if(!worker->textMoba.initialize(_gameplay)) {
+			_results.assign(_configs.size(), MatchResult{ NEUTRAL, 0 });
+			return false;
+		}
+		_workers.push_back(std::move(worker));
+	}
+
+	// Saves are checked before any match starts: a match that cannot load
+	// its save would only report a draw in 0 turns. Loading leaves the game
+	// untouched on failure and is redone by each match.
+	const MatchSave* checked = nullptr;
+	for(const MatchConfig& config: _configs) {
+		if(!config.start || config.start == checked)
+			continue;
+		if(!_workers.front()->textMoba.loadMatch(*config.start)) {
+			dbgLogger.error("Cannot start matches from the saved match.");
+			_results.assign(_configs.size(), MatchResult{ NEUTRAL, 0 });
+			return false;
+		}
+		checked = config.start;
+	}
+
+	if(!_telemetryPath.empty() && !_telemetryFile.open(_telemetryPath, _gameplay->_symbols)) {
+		_results.assign(_configs.size(), MatchResult{ NEUTRAL, 0 });
+		return false;
+	}
+
+	_results.resize(_configs.size());
+	_nextMatch = 0;
+
+	std::vector<std::thread> threads;
+	for(unsigned i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&MatchRunner::_work, this, _workers[i].get());
+	}
+	for(std::thread& thread: threads) {
+		thread.join();
+	}
+
+	return _telemetryFile.close();
+}
+
+
+const Path& MatchRunner::telemetryPath() const {
+	return _telemetryPath;
+}
+
+
+void MatchRunner::setTelemetryPath(const Path& path) {
+	_telemetryPath = path;
+}
+
+
+const MatchConfigVector& MatchRunner::configs() const {
+	return _configs;
+}
+
+
+const MatchResultVector& MatchRunner::results() const {
+	return _results;
+}
+
+
+MatchResult MatchRunner::play(TextMoba& textMoba, const MatchConfig& config) {
+	if(textMoba.aiThreadCount() != config.aiThreads)
+		textMoba.setPhasedAi(config.aiThreads != 0, config.aiThreads);
+	textMoba.setSearchAi(config.searchAi, config.search);
+	if(config.start) {
+		if(!textMoba.loadMatch(*config.start))
+			return MatchResult{ NEUTRAL, 0 };
+		textMoba.seed(config.seed);
+	}
+	else {
+		textMoba.restart(config.className, config.seed);
+	}
+
+	while(!textMoba.isOver() && textMoba._turn < config.maxTurns) {
+		textMoba.nextTurn();
+	}
+
+	return MatchResult{ textMoba.winner(), textMoba._turn };
+}
+
+
+void MatchRunner::_work(Worker* worker) {
+	Telemetry* telemetry = _telemetryFile.isOpen()? &worker->telemetry: nullptr;
+	worker->textMoba.setTelemetry(telemetry);
+
+	while(true) {
+		unsigned match = _nextMatch++;
+		if(match >= _configs.size())
+			break;
+
+		if(telemetry)
+			telemetry->beginMatch(match, worker->textMoba);
+
+		_results[match] = play(worker->textMoba, _configs[match]);
+
+		// Finished matches are recorded by TextMoba::gameOver().
+		if(telemetry && !worker->textMoba.isOver())
+			telemetry->endMatch(worker->textMoba._turn, NEUTRAL);
+	}
+
+	if(telemetry)
+		telemetry->flush();
+}
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_MATCH_RUNNER_H_
+#define LD41_MATCH_RUNNER_H_
+
+
+#include <atomic>
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+#include <lair/core/path.h>
+
+#include "text_moba.h"
+#include "telemetry.h"
+
+
+struct MatchConfig {
+	unsigned       seed;
+	lair::String   className;
+	unsigned       maxTurns;
+	// Threads used by the AIs of a match, or 0 to play them one after the
+	// other, see TextMoba::setPhasedAi().
+	unsigned       aiThreads;
+	// Team whose heroes look ahead, or NEUTRAL, see TextMoba::setSearchAi().
+	Team           searchAi;
+	SearchAiConfig search;
+	// If set, the match continues from this save instead of starting from
+	// scratch, reseeded with seed. Must outlive the MatchRunner.
+	const MatchSave* start;
+};
+
+struct MatchResult {
+	Team     winner; // NEUTRAL if the match was stopped after maxTurns.
+	unsigned turns;
+};
+
+typedef std::vector<MatchConfig> MatchConfigVector;
+typedef std::vector<MatchResult> MatchResultVector;
+
+
+// Plays independent headless matches on a pool of threads.
+//
+// Each thread owns a TextMoba instance with its own random number generator
+// and logger, so matches never share mutable state. As a match only depends
+// on its config, results do not depend on the number of threads.
+class MatchRunner {
+public:
+	MatchRunner(const lair::Path& logicPath, unsigned threadCount = 0);
+
+	unsigned threadCount() const;
+
+	void addMatch(const MatchConfig& config);
+	// Returns false, without playing anything, if the gameplay data cannot
+	// be loaded, a saved match to start from does not fit it or the
+	// telemetry file cannot be created. Also returns false, once the
+	// matches are played, if writing the telemetry failed.
+	bool run();
+
+	// If set, run() writes the statistics of its matches to path, the match
+	// number being the index of its config. See Telemetry.
+	const lair::Path& telemetryPath() const;
+	void setTelemetryPath(const lair::Path& path);
+
+	const MatchConfigVector& configs() const;
+	const MatchResultVector& results() const;
+
+	static MatchResult play(TextMoba& textMoba, const MatchConfig& config);
+
+private:
+	struct Worker {
+		Worker(TelemetryFile* telemetryFile);
+
+		// Each worker writes its own messages to std::clog.
+		lair::OStreamLogger logBackend;
+		lair::MasterLogger  masterLogger;
+		lair::Logger        logger;
+		TextMoba            textMoba;
+		Telemetry           telemetry;
+	};
+
+	typedef std::unique_ptr<Worker> WorkerUP;
+	typedef std::vector<WorkerUP>   WorkerVector;
+
+private:
+	void _work(Worker* worker);
+
+private:
+	lair::Path        _logicPath;
+	// Loaded once and shared by the games of all the workers.
+	GameplayBundleCSP _gameplay;
+	unsigned          _threadCount;
+	WorkerVector      _workers;
+
+	MatchConfigVector _configs;
+	MatchResultVector _results;
+	std::atomic<unsigned> _nextMatch;
+
+	lair::Path        _telemetryPath;
+	TelemetryFile     _telemetryFile;
+};
+
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <lair/core/log.h>
+
+#include "match_save.h"
+
+
+using namespace lair;
+
+
+// File layout: magic, version, then little-endian varints for everything
+// else, like replays. The replay of the match is embedded in its own format
+// after the header.
+
+static const char     matchMagic[4] = { 'T', 'M', 'S', 'V' };
+static const unsigned matchVersion  = 1;
+
+
+MatchSave::MatchSave()
+    : _dataHash(0)
+    , _turn(0)
+    , _nextWaveTurn(0)
+    , _winner(NEUTRAL)
+    , _charIndex(0)
+{
+}
+
+
+void MatchSave::clear() {
+	_characters.clear();
+	_buffs.clear();
+	_skills.clear();
+	_heroes.clear();
+}
+
+
+bool MatchSave::write(std::ostream& out) const {
+	out.write(matchMagic, sizeof(matchMagic));
+	writeVarint(out, matchVersion);
+	writeVarint(out, _dataHash);
+	writeVarint(out, _turn);
+	writeVarint(out, _nextWaveTurn);
+	writeVarint(out, _winner);
+	writeVarint(out, _charIndex);
+	writeString(out, _rng);
+	_replay.write(out);
+
+	// Indices are stored + 1 so NO_INDEX and NO_SYMBOL take a single byte.
+	writeVarint(out, _characters.size());
+	const Buff*       buff  = _buffs.data();
+	const SkillState* skill = _skills.data();
+	for(const CharacterState& c: _characters) {
+		writeVarint(out, c.classSymbol);
+		writeVarint(out, c.index);
+		writeVarint(out, c.team);
+		writeVarint(out, c.node + 1u);
+		writeVarint(out, c.place);
+		writeVarint(out, c.level);
+		writeVarint(out, c.hp);
+		writeVarint(out, c.mana);
+		writeVarint(out, c.respawnTurn);
+		writeVarint(out, c.xp);
+		writeVarint(out, c.turnsPlayed);
+		writeVarint(out, c.lastTurn);
+		writeVarint(out, c.hasAi);
+		if(c.hasAi) {
+			writeVarint(out, c.aiTarget + 1u);
+			writeVarint(out, c.aiStatus);
+			writeVarint(out, c.aiLane);
+		}
+
+		writeVarint(out, c.buffCount);
+		for(unsigned i = 0; i < c.buffCount; ++i, ++buff) {
+			writeVarint(out, buff->ticks);
+			writeVarint(out, zigzag(buff->amount));
+			writeVarint(out, uint8(buff->type));
+		}
+		writeVarint(out, c.skillCount);
+		for(unsigned i = 0; i < c.skillCount; ++i, ++skill) {
+			writeVarint(out, skill->level);
+			writeVarint(out, skill->readyTime);
+		}
+	}
+
+	writeVarint(out, _heroes.size());
+	for(unsigned index: _heroes) {
+		writeVarint(out, index);
+	}
+
+	return bool(out);
+}
+
+
+bool MatchSave::read(std::istream& in) {
+	clear();
+
+	char magic[sizeof(matchMagic)];
+	in.read(magic, sizeof(magic));
+	if(!in || std::memcmp(magic, matchMagic, sizeof(magic)) != 0) {
+		dbgLogger.error("MatchSave: invalid file.");
+		return false;
+	}
+
+	uint64 version;
+	if(!readVarint(in, version) || version != matchVersion) {
+		dbgLogger.error("MatchSave: unsupported version ", version, ".");
+		return false;
+	}
+
+	unsigned winner;
+	if(!readVarint(in, _dataHash) || !readUnsigned(in, _turn) ||
+	        !readUnsigned(in, _nextWaveTurn) || !readUnsigned(in, winner) ||
+	        !readUnsigned(in, _charIndex) || !readString(in, _rng) ||
+	        winner > NEUTRAL) {
+		dbgLogger.error("MatchSave: truncated header.");
+		return false;
+	}
+	_winner = Team(winner);
+
+	if(!_replay.read(in))
+		return false;
+
+	unsigned count;
+	bool ok = readUnsigned(in, count);
+	for(unsigned ci = 0; ok && ci < count; ++ci) {
+		CharacterState c;
+		unsigned team  = 0;
+		unsigned node  = 0;
+		unsigned place = 0;
+		unsigned hasAi = 0;
+		ok = readUnsigned(in, c.classSymbol) && readUnsigned(in, c.index) &&
+		     readUnsigned(in, team) && readUnsigned(in, node) &&
+		     readUnsigned(in, place) && readUnsigned(in, c.level) &&
+		     readUnsigned(in, c.hp) && readUnsigned(in, c.mana) &&
+		     readUnsigned(in, c.respawnTurn) && readUnsigned(in, c.xp) &&
+		     readUnsigned(in, c.turnsPlayed) && readUnsigned(in, c.lastTurn) &&
+		     readUnsigned(in, hasAi) && team < NEUTRAL && place <= FRONT;
+		c.team  = Team(team);
+		c.node  = node - 1u;
+		c.place = Place(place);
+		c.hasAi = hasAi;
+
+		c.aiTarget = NO_INDEX;
+		c.aiStatus = 0;
+		c.aiLane   = 0;
+		if(ok && c.hasAi) {
+			unsigned target = 0;
+			ok = readUnsigned(in, target) && readUnsigned(in, c.aiStatus) &&
+			     readUnsigned(in, c.aiLane);
+			c.aiTarget = target - 1u;
+		}
+
+		ok = ok && readUnsigned(in, c.buffCount);
+		for(unsigned i = 0; ok && i < c.buffCount; ++i) {
+			Buff buff;
+			uint64 amount = 0;
+			unsigned type = 0;
+			ok = readUnsigned(in, buff.ticks) && readVarint(in, amount) &&
+			     readUnsigned(in, type);
+			buff.amount = unzigzag(amount);
+			buff.type   = char(type);
+			_buffs.push_back(buff);
+		}
+		ok = ok && readUnsigned(in, c.skillCount);
+		for(unsigned i = 0; ok && i < c.skillCount; ++i) {
+			SkillState skill;
+			ok = readUnsigned(in, skill.level) && readUnsigned(in, skill.readyTime);
+			_skills.push_back(skill);
+		}
+
+		_characters.push_back(c);
+	}
+
+	ok = ok && readUnsigned(in, count);
+	for(unsigned i = 0; ok && i < count; ++i) {
+		unsigned index;
+		ok = readUnsigned(in, index);
+		_heroes.push_back(index);
+	}
+
+	if(!ok) {
+		dbgLogger.error("MatchSave: truncated file.");
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+bool MatchSave::save(const Path& path) const {
+	String tmpPath = path.utf8String() + ".tmp";
+	{
+		std::ofstream out(tmpPath.c_str(), std::ios::binary);
+		if(!out.good() || !write(out)) {
+			dbgLogger.error("Unable to write \"", tmpPath, "\".");
+			return false;
+		}
+	}
+
+	if(std::rename(tmpPath.c_str(), path.utf8String().c_str()) != 0) {
+		dbgLogger.error("Unable to write \"", path.utf8String(), "\".");
+		return false;
+	}
+	return true;
+}
+
+
+bool MatchSave::load(const Path& path) {
+	Path::IStream in(path.native().c_str(), std::ios::binary | std::ios::ate);
+	if(!in.good()) {
+		dbgLogger.error("Unable to read \"", path.utf8String(), "\".");
+		return false;
+	}
+
+	std::streamoff size = in.tellg();
+	in.seekg(0);
+	if(size >= 0)
+		_buffer.resize(size);
+	if(size < 0 || !in.read(_buffer.data(), size)) {
+		dbgLogger.error("Unable to read \"", path.utf8String(), "\".");
+		return false;
+	}
+
+	MemoryStreamBuf buffer(_buffer.data(), _buffer.data() + _buffer.size());
+	std::istream bufferIn(&buffer);
+	return read(bufferIn);
+}
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_MATCH_SAVE_H_
+#define LD41_MATCH_SAVE_H_
+
+
+#include <lair/core/lair.h>
+#include <lair/core/path.h>
+
+#include "text_moba.h"
+#include "symbol_table.h"
+#include "replay.h"
+#include "character.h"
+
+
+// The complete state of a match between two turns, see TextMoba::saveMatch()
+// and TextMoba::loadMatch(). Unlike a GameSnapshot, it does not refer to the
+// game it comes from, so it can be written to a file and loaded into another
+// TextMoba with the same gameplay data: to recover from a crash, to start
+// matches from a preset scenario or to move a match to another process.
+//
+// Classes and nodes are stored as symbols, characters refer to each other by
+// index, and buffs and skills are stored in flat arrays, so saving again in
+// the same MatchSave does not allocate once warmed up.
+class MatchSave {
+public:
+	static const unsigned NO_INDEX = unsigned(-1);
+
+	struct CharacterState {
+		SymbolId classSymbol;
+		unsigned index;
+		Team     team;
+		// NO_SYMBOL for dead heroes.
+		SymbolId node;
+		Place    place;
+		unsigned level;
+		unsigned hp;
+		unsigned mana;
+		unsigned respawnTurn;
+		unsigned xp;
+		unsigned turnsPlayed;
+		unsigned lastTurn;
+		bool     hasAi;
+		// Index of the target of the AI, or NO_INDEX.
+		unsigned aiTarget;
+		unsigned aiStatus;
+		unsigned aiLane;
+		// Number of entries of _buffs and _skills used by this character.
+		unsigned buffCount;
+		unsigned skillCount;
+	};
+
+	struct SkillState {
+		unsigned level;
+		unsigned readyTime;
+	};
+
+	typedef std::vector<CharacterState> CharacterStateVector;
+	typedef std::vector<SkillState>     SkillStateVector;
+
+public:
+	MatchSave();
+
+	void clear();
+
+	bool write(std::ostream& out) const;
+	bool read(std::istream& in);
+
+	// The file is replaced atomically, so a crash while saving a checkpoint
+	// leaves the previous one intact. Loading reads the whole file at once.
+	bool save(const lair::Path& path) const;
+	bool load(const lair::Path& path);
+
+public:
+	lair::uint64 _dataHash;
+	unsigned     _turn;
+	unsigned     _nextWaveTurn;
+	Team         _winner;
+	unsigned     _charIndex;
+	// The std::mt19937 of the game, in its text form.
+	lair::String _rng;
+	// The match so far, so it can still be replayed from the beginning.
+	Replay       _replay;
+
+	// In the order of TextMoba::characters().
+	CharacterStateVector  _characters;
+	BuffVector            _buffs;
+	SkillStateVector      _skills;
+	// Indices of the heroes, the player first.
+	std::vector<unsigned> _heroes;
+
+private:
+	// Reused by load().
+	std::vector<char> _buffer;
+};
+
+
+#endif
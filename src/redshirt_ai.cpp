@@ -31,18 +31,18 @@
 using namespace lair;
 
 
-RedshirtAi::RedshirtAi(CharacterSP character, Lane lane)
+RedshirtAi::RedshirtAi(Character* character, Lane lane)
     : Ai(character)
     , _lane(lane)
 {
 }
 
 
-void RedshirtAi::play() {
-	CharacterSP c = character();
+AiAction RedshirtAi::decide() {
+	Character* c = character();
 
-	if(!c || !c->isAlive())
-		return;
+	if(!c->isAlive())
+		return AiAction::none();
 
 //	dbgLogger.log(c->debugName(), " turn:");
 
@@ -50,7 +50,7 @@ void RedshirtAi::play() {
 
 	CharacterGroups groups = c->node()->characterGroups();
 	if(groups.count(enemy)) {
-		CharacterSP target = _target.lock();
+		Character* target = this->target();
 
 		if(!target || !target->isAlive() ||
 		        groups.distanceBetween(c, target) > c->range()) {
@@ -58,20 +58,32 @@ void RedshirtAi::play() {
 		}
 
 		if(target) {
-			_target = target;
+			_target = target->handle();
 //			dbgLogger.info("  Attack ", target->debugName());
-			c->attack(target);
+			return AiAction::attack(target);
 		}
 	}
 	else {
-		MapNodeSP dest = c->node()->destination((c->team() == BLUE)? "red": "blue");
-		if(!dest) {
-			dest = c->node()->destination((_lane == TOP)? "top": "bot");
-		}
+		MapNode* dest = c->node()->nextHop(c->enemyTeam(), _lane);
 
 		if(dest) {
 //			dbgLogger.info("  Go to ", dest->name());
-			c->moveTo(dest);
+			return AiAction::moveTo(dest);
 		}
 	}
+
+	return AiAction::none();
+}
+
+
+AiState RedshirtAi::state() const {
+	AiState state = Ai::state();
+	state.lane = _lane;
+	return state;
+}
+
+
+void RedshirtAi::setState(const AiState& state) {
+	Ai::setState(state);
+	_lane = Lane(state.lane);
 }
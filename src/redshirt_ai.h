@@ -30,13 +30,15 @@
 
 class RedshirtAi : public Ai {
 public:
-	RedshirtAi(CharacterSP character, Lane lane);
+	RedshirtAi(Character* character, Lane lane);
 
-	virtual void play() override;
+	virtual AiAction decide() override;
+
+	virtual AiState state() const override;
+	virtual void setState(const AiState& state) override;
 
 public:
 	Lane        _lane;
-	CharacterWP _target;
 };
 
 
@@ -0,0 +1,234 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cstring>
+#include <fstream>
+
+#include <lair/core/log.h>
+
+#include "replay.h"
+
+
+using namespace lair;
+
+
+// File layout: magic, version, then little-endian varints for everything
+// else. Turns are stored relative to the previous command.
+
+static const char     replayMagic[4] = { 'T', 'M', 'R', 'P' };
+static const unsigned replayVersion  = 1;
+
+
+void writeVarint(std::ostream& out, uint64 value) {
+	do {
+		uint8 byte = value & 0x7f;
+		value >>= 7;
+		if(value)
+			byte |= 0x80;
+		out.put(char(byte));
+	} while(value);
+}
+
+
+bool readVarint(std::istream& in, uint64& value) {
+	value = 0;
+	for(unsigned shift = 0; shift < 64; shift += 7) {
+		int byte = in.get();
+		if(byte == std::istream::traits_type::eof())
+			return false;
+		value |= uint64(byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+
+bool readUnsigned(std::istream& in, unsigned& value) {
+	uint64 v;
+	if(!readVarint(in, v) || v > 0xffffffffu)
+		return false;
+	value = unsigned(v);
+	return true;
+}
+
+
+uint64 zigzag(int value) {
+	return (uint64(value) << 1) ^ uint64(int64(value) >> 63);
+}
+
+
+int unzigzag(uint64 value) {
+	return int(value >> 1) ^ -int(value & 1);
+}
+
+
+void writeString(std::ostream& out, const String& string) {
+	writeVarint(out, string.size());
+	out.write(string.data(), string.size());
+}
+
+
+bool readString(std::istream& in, String& string) {
+	uint64 size;
+	if(!readVarint(in, size) || size > (1 << 20))
+		return false;
+	string.resize(size);
+	in.read(&string[0], size);
+	return bool(in);
+}
+
+
+
+Replay::Replay()
+    : _dataHash(0)
+    , _seed(0)
+{
+}
+
+
+uint64 Replay::dataHash() const {
+	return _dataHash;
+}
+
+
+unsigned Replay::seed() const {
+	return _seed;
+}
+
+
+const String& Replay::className() const {
+	return _className;
+}
+
+
+const Replay::CommandVector& Replay::commands() const {
+	return _commands;
+}
+
+
+void Replay::reset(uint64 dataHash, unsigned seed, const String& className) {
+	_dataHash  = dataHash;
+	_seed      = seed;
+	_className = className;
+	_commands.clear();
+}
+
+
+void Replay::addCommand(unsigned turn, const String& command) {
+	_commands.push_back(Command{ turn, command });
+}
+
+
+bool Replay::write(std::ostream& out) const {
+	out.write(replayMagic, sizeof(replayMagic));
+	writeVarint(out, replayVersion);
+	writeVarint(out, _dataHash);
+	writeVarint(out, _seed);
+	writeString(out, _className);
+
+	writeVarint(out, _commands.size());
+	unsigned turn = 0;
+	for(const Command& command: _commands) {
+		writeVarint(out, command.turn - turn);
+		writeString(out, command.command);
+		turn = command.turn;
+	}
+
+	return bool(out);
+}
+
+
+bool Replay::read(std::istream& in) {
+	char magic[sizeof(replayMagic)];
+	in.read(magic, sizeof(magic));
+	if(!in || std::memcmp(magic, replayMagic, sizeof(magic)) != 0) {
+		dbgLogger.error("Replay: invalid file.");
+		return false;
+	}
+
+	uint64 version;
+	if(!readVarint(in, version) || version != replayVersion) {
+		dbgLogger.error("Replay: unsupported version ", version, ".");
+		return false;
+	}
+
+	uint64 seed;
+	uint64 count;
+	if(!readVarint(in, _dataHash) || !readVarint(in, seed) ||
+	        !readString(in, _className) || !readVarint(in, count)) {
+		dbgLogger.error("Replay: truncated header.");
+		return false;
+	}
+	_seed = seed;
+
+	_commands.clear();
+	unsigned turn = 0;
+	for(uint64 i = 0; i < count; ++i) {
+		uint64 delta;
+		String command;
+		if(!readVarint(in, delta) || !readString(in, command)) {
+			dbgLogger.error("Replay: truncated command list.");
+			return false;
+		}
+		turn += delta;
+		_commands.push_back(Command{ turn, command });
+	}
+
+	return true;
+}
+
+
+bool Replay::save(const Path& path) const {
+	std::ofstream out(path.utf8String().c_str(), std::ios::binary);
+	if(!out.good()) {
+		dbgLogger.error("Unable to write \"", path.utf8String(), "\".");
+		return false;
+	}
+	return write(out);
+}
+
+
+bool Replay::load(const Path& path) {
+	Path::IStream in(path.native().c_str(), std::ios::binary);
+	if(!in.good()) {
+		dbgLogger.error("Unable to read \"", path.utf8String(), "\".");
+		return false;
+	}
+	return read(in);
+}
+
+
+
+// 64-bit FNV-1a.
+uint64 hashData(const char* data, size_t size) {
+	uint64 hash = 0xcbf29ce484222325ull;
+	for(size_t i = 0; i < size; ++i) {
+		hash ^= uint8(data[i]);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+
+MemoryStreamBuf::MemoryStreamBuf(char* begin, char* end) {
+	setg(begin, begin, end);
+}
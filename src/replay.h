@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_REPLAY_H_
+#define LD41_REPLAY_H_
+
+
+#include <istream>
+
+#include <lair/core/lair.h>
+#include <lair/core/path.h>
+
+
+// Everything required to re-simulate a match: the hash of the gameplay data,
+// the seed of the match and the player's class and input. Commands are
+// stored with the turn at which they were entered.
+class Replay {
+public:
+	struct Command {
+		unsigned     turn;
+		lair::String command;
+	};
+
+	typedef std::vector<Command> CommandVector;
+
+public:
+	Replay();
+
+	lair::uint64 dataHash() const;
+	unsigned seed() const;
+	const lair::String& className() const;
+	const CommandVector& commands() const;
+
+	void reset(lair::uint64 dataHash, unsigned seed, const lair::String& className);
+	void addCommand(unsigned turn, const lair::String& command);
+
+	bool write(std::ostream& out) const;
+	bool read(std::istream& in);
+
+	bool save(const lair::Path& path) const;
+	bool load(const lair::Path& path);
+
+private:
+	lair::uint64  _dataHash;
+	unsigned      _seed;
+	lair::String  _className;
+	CommandVector _commands;
+};
+
+
+lair::uint64 hashData(const char* data, size_t size);
+
+// Little-endian base 128 varints, shared by the binary file formats.
+void writeVarint(std::ostream& out, lair::uint64 value);
+bool readVarint(std::istream& in, lair::uint64& value);
+// Fails on values that do not fit.
+bool readUnsigned(std::istream& in, unsigned& value);
+// Signed values are zigzag-encoded, so small negative ones stay short.
+lair::uint64 zigzag(int value);
+int unzigzag(lair::uint64 value);
+void writeString(std::ostream& out, const lair::String& string);
+bool readString(std::istream& in, lair::String& string);
+
+// Lets the binary formats parse a file they read at once, without copying it.
+class MemoryStreamBuf : public std::streambuf {
+public:
+	MemoryStreamBuf(char* begin, char* end);
+};
+
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#include <algorithm>
+#include <sstream>
+
+#include <lair/core/log.h>
+
+#include "scenario.h"
+
+
+using namespace lair;
+
+
+static String laneNodeId(unsigned lane, unsigned i) {
+	return cat("l", lane + 1, "_", i);
+}
+
+
+static String jungleNodeId(unsigned lane, unsigned i) {
+	return cat("j", lane + 1, "_", i);
+}
+
+
+String scenarioLaneName(unsigned lane) {
+	return cat("lane", lane + 1);
+}
+
+
+String generateScenario(const String& data, const ScenarioConfig& config) {
+	size_t nodesBegin = data.find("\nnodes = {");
+	size_t infoBegin  = data.find("\ninfo = {");
+	if(nodesBegin == String::npos || infoBegin == String::npos || infoBegin < nodesBegin) {
+		dbgLogger.error("Unexpected gameplay data layout, cannot generate the scenario.");
+		return data;
+	}
+
+	unsigned lanes  = std::max(config.lanes, 1u);
+	unsigned length = std::max(config.laneLength, 1u);
+	// Two towers per team and lane, near the fonxus like on the regular
+	// map, if the lanes are long enough.
+	unsigned towers = (length >= 6)? 2: (length >= 2)? 1: 0;
+
+	auto laneY = [lanes](float lane) {
+		return (lanes > 1)? 40 + 400 * lane / (lanes - 1): 240;
+	};
+	auto nodeX = [length](unsigned i) {
+		return 55 + 490 * i / std::max(length - 1, 1u);
+	};
+
+	std::ostringstream out;
+	out << data.substr(0, nodesBegin + 1);
+
+	out << "nodes = {\n"
+	    << "\tbf = { name = \"the blue fonxus\" images = [ 'blue_fonxus.png' ]"
+	    << " position = Vector(35, 240) tower = blue fonxus = blue }\n"
+	    << "\trf = { name = \"the red fonxus\" images = [ 'red_fonxus.png' ]"
+	    << " position = Vector(565, 240) tower = red fonxus = red }\n";
+	for(unsigned lane = 0; lane < lanes; ++lane) {
+		for(unsigned i = 0; i < length; ++i) {
+			const char* tower = (i < 2 * towers && i % 2 == 0)? "blue":
+			                    (i + 2 * towers >= length + 1 && (length - 1 - i) % 2 == 0)? "red":
+			                    nullptr;
+			out << "\t" << laneNodeId(lane, i) << " = { name = \"the "
+			    << scenarioLaneName(lane) << " node " << i << "\"";
+			if(tower)
+				out << " images = [ '" << tower << "_lane_tower.png', '"
+				    << tower << "_lane_tower_down.png' ] tower = " << tower;
+			else
+				out << " images = [ 'lane.png' ]";
+			out << " position = Vector(" << nodeX(i) << ", " << laneY(lane) << ") }\n";
+		}
+	}
+	for(unsigned lane = 0; config.jungleSpacing && lane + 1 < lanes; ++lane) {
+		for(unsigned i = config.jungleSpacing; i + 1 < length; i += config.jungleSpacing) {
+			out << "\t" << jungleNodeId(lane, i) << " = { name = \"the jungle between "
+			    << scenarioLaneName(lane) << " and " << scenarioLaneName(lane + 1)
+			    << "\" images = [ 'jungle.png' ]"
+			    << " position = Vector(" << nodeX(i) << ", " << laneY(lane + .5f) << ") }\n";
+		}
+	}
+	out << "}\n\n";
+
+	auto path = [&out](const String& from, const String& to,
+	                   const String& fromDirs, const String& toDirs) {
+		out << "\t{ from = " << from << " to = " << to
+		    << " from_dirs = [ " << fromDirs << " ] to_dirs = [ " << toDirs << " ] }\n";
+	};
+	auto quote = [](const String& str) {
+		return cat("\"", str, "\"");
+	};
+
+	out << "paths = [\n";
+	for(unsigned lane = 0; lane < lanes; ++lane) {
+		String laneDir = quote(scenarioLaneName(lane));
+		path("bf", laneNodeId(lane, 0), laneDir, "\"blue\", \"back\", \"fonxus\"");
+		for(unsigned i = 0; i + 1 < length; ++i) {
+			path(laneNodeId(lane, i), laneNodeId(lane, i + 1), "\"red\", \"ahead\"", "\"blue\", \"back\"");
+		}
+		path("rf", laneNodeId(lane, length - 1), laneDir, "\"red\", \"ahead\", \"fonxus\"");
+	}
+	// Jungle nodes are off the way of the AIs, which only follow lanes.
+	for(unsigned lane = 0; config.jungleSpacing && lane + 1 < lanes; ++lane) {
+		String fromDir = quote(scenarioLaneName(lane));
+		String toDir   = quote(scenarioLaneName(lane + 1));
+		for(unsigned i = config.jungleSpacing; i + 1 < length; i += config.jungleSpacing) {
+			path(laneNodeId(lane, i), jungleNodeId(lane, i), cat(toDir, ", \"jungle\""), fromDir);
+			path(jungleNodeId(lane, i), laneNodeId(lane + 1, i), toDir, cat(fromDir, ", \"jungle\""));
+		}
+	}
+	out << "]\n\n";
+
+	out << "lanes = [";
+	for(unsigned lane = 0; lane < lanes; ++lane) {
+		out << " " << quote(scenarioLaneName(lane));
+	}
+	out << " ]\n\n";
+
+	out << "heroes = {\n";
+	for(unsigned team = 0; team < 2; ++team) {
+		out << "\t" << teamName(Team(team)) << " = [\n";
+		for(unsigned i = 0; i < config.heroes.size(); ++i) {
+			out << "\t\t{ class = " << config.heroes[i]
+			    << " lane = " << scenarioLaneName(i % lanes) << " }\n";
+		}
+		out << "\t]\n";
+	}
+	out << "}\n";
+
+	out << data.substr(infoBegin);
+	return out.str();
+}
@@ -0,0 +1,56 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#ifndef LD41_SCENARIO_H_
+#define LD41_SCENARIO_H_
+
+
+#include <lair/core/lair.h>
+
+#include "text_moba.h"
+
+
+// A generated map: `lanes` lanes of `laneLength` nodes between the two
+// fonxus, optional jungle nodes linking neighbor lanes, and the hero roster
+// of both teams.
+struct ScenarioConfig {
+	unsigned     lanes         = 2;
+	unsigned     laneLength    = 7;
+	// A jungle node links each pair of neighbor lanes every jungleSpacing
+	// nodes, 0 for no jungle.
+	unsigned     jungleSpacing = 0;
+	// Classes of the heroes of each team, spread over the lanes in order.
+	StringVector heroes        = { "ranger", "warrior", "mage" };
+};
+
+
+// Name of a lane of a generated map, also the direction leading to it from
+// the fonxus.
+lair::String scenarioLaneName(unsigned lane);
+
+// Returns data, the source of a gameplay.ldl, with its map and hero roster
+// replaced by the ones described by config. Classes, skills and settings are
+// kept. Returns data unchanged if it has no "nodes" or "info" section.
+lair::String generateScenario(const lair::String& data, const ScenarioConfig& config);
+
+
+#endif
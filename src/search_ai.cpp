@@ -0,0 +1,169 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <limits>
+
+#include <lair/core/log.h>
+
+#include "map_node.h"
+#include "character_class.h"
+#include "character.h"
+
+#include "search_ai.h"
+
+
+using namespace lair;
+
+
+SearchHeroAi::SearchHeroAi(Character* character, Lane lane)
+    : HeroAi(character, lane)
+    , _hasPlan(false)
+    , _plan(AiAction::none())
+    , _hasForced(false)
+    , _forced(AiAction::none())
+{
+}
+
+
+AiAction SearchHeroAi::decide() {
+	if(_hasForced) {
+		_hasForced = false;
+		return _forced;
+	}
+
+	// HeroAi still updates its status when the plan is used, it is part of
+	// the state the next plans are simulated from.
+	AiAction action = HeroAi::decide();
+	if(_hasPlan && !character()->_textMoba->isSimulating()) {
+		_hasPlan = false;
+		return _plan;
+	}
+	return action;
+}
+
+
+void SearchHeroAi::plan() {
+	_hasPlan = false;
+
+	Character* c  = character();
+	TextMoba*  tm = c->_textMoba;
+	if(!c->isAlive() || !c->node() || tm->isOver())
+		return;
+
+	const SearchAiConfig& config = tm->searchAiConfig();
+	Clock::time_point deadline = Clock::now() + std::chrono::microseconds(config.budget);
+
+	// Every candidate is simulated with the same seeds, so they are compared
+	// on the same futures.
+	unsigned seed = tm->random(std::numeric_limits<unsigned>::max());
+	tm->saveSnapshot(_snapshot);
+
+	// HeroAi::decide() updates the Ai, which is restored with the rest.
+	_candidates.clear();
+	_addCandidate(HeroAi::decide());
+	_addCandidate(AiAction::none());
+	_addCandidate(move(FORWARD));
+	_addCandidate(move(BACKWARD));
+	_addCandidate(AiAction::goToPlace((c->place() == FRONT)? BACK: FRONT));
+	for(unsigned place = 0; place < 2; ++place) {
+		for(const CharacterSP& enemy: c->node()->row(c->enemyTeam(), Place(place))) {
+			if(enemy->isAlive() && _groups.distanceBetween(c, enemy.get()) <= c->range())
+				_addCandidate(AiAction::attack(enemy.get()));
+		}
+	}
+
+	unsigned best      = 0;
+	float    bestScore = -std::numeric_limits<float>::infinity();
+	tm->setSimulating(true);
+	for(unsigned i = 0; i < _candidates.size() && _candidates.size() > 1; ++i) {
+		float score = 0;
+		for(unsigned rollout = 0; rollout < config.rollouts; ++rollout) {
+			tm->restoreSnapshot(_snapshot);
+			tm->seed(seed + rollout);
+
+			_hasForced = true;
+			_forced    = _candidates[i];
+			for(unsigned turn = 0; turn < config.depth && !tm->isOver(); ++turn) {
+				tm->nextTurn();
+			}
+			_hasForced = false;
+
+			score += evaluate();
+		}
+
+		if(score > bestScore) {
+			best      = i;
+			bestScore = score;
+		}
+
+		if(config.budget && Clock::now() >= deadline)
+			break;
+	}
+	tm->restoreSnapshot(_snapshot);
+	tm->setSimulating(false);
+
+	_snapshot.release();
+
+	_hasPlan = true;
+	_plan    = _candidates[best];
+}
+
+
+// The weights are arbitrary: winning trumps everything, then buildings,
+// then the health and experience of the character, then other heroes.
+float SearchHeroAi::evaluate() const {
+	const Character* c  = character();
+	const TextMoba*  tm = c->_textMoba;
+	Team team = c->team();
+
+	if(tm->isOver())
+		return (tm->winner() == team)? 1000: -1000;
+
+	float score = 0;
+
+	if(c->respawnTurn())
+		score -= 20;
+	else
+		score += 10.f * c->hp() / c->maxHP();
+
+	unsigned nextLevel = tm->nextLevel(c);
+	score += 20.f * c->level();
+	if(nextLevel)
+		score += 20.f * c->xp() / nextLevel;
+
+	for(const CharacterSP& other: tm->characters()) {
+		if(other->type() == REDSHIRT || other.get() == c)
+			continue;
+
+		float value  = (other->type() == BUILDING)? 30: 5;
+		float health = float(other->hp()) / other->maxHP();
+		score += ((other->team() == team)? value: -value) * health;
+	}
+
+	return score;
+}
+
+
+void SearchHeroAi::_addCandidate(const AiAction& action) {
+	if(std::find(_candidates.begin(), _candidates.end(), action) == _candidates.end())
+		_candidates.push_back(action);
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_SEARCH_AI_H_
+#define LD41_SEARCH_AI_H_
+
+
+#include <chrono>
+#include <vector>
+
+#include <lair/core/lair.h>
+
+#include "game_snapshot.h"
+#include "hero_ai.h"
+
+
+typedef std::vector<AiAction> AiActionVector;
+
+
+// A hero that looks ahead. Before each turn, it tries each action it could
+// do on the current game: it plays it, simulates the next turns with the
+// other AIs (and itself) playing as usual, scores the result and restores
+// the game. The best action is played during the turn.
+//
+// HeroAi's choice is tried first, and kept when the time budget does not
+// allow to try anything else. See TextMoba::setSearchAi().
+class SearchHeroAi : public HeroAi {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+public:
+	SearchHeroAi(Character* character, Lane lane);
+
+	virtual AiAction decide() override;
+	virtual void plan() override;
+
+	// How good the game looks for the team of the character.
+	float evaluate() const;
+
+	void _addCandidate(const AiAction& action);
+
+public:
+	GameSnapshot   _snapshot;
+	AiActionVector _candidates;
+
+	bool           _hasPlan;
+	AiAction       _plan;
+
+	// Played by the first decision of a simulation.
+	bool           _hasForced;
+	AiAction       _forced;
+};
+
+
+#endif
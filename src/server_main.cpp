@@ -0,0 +1,96 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <lair/core/log.h>
+
+#include "game_server.h"
+
+
+using namespace lair;
+
+
+static GameServer* server = nullptr;
+
+
+void stopServer(int) {
+	if(server)
+		server->stop();
+}
+
+
+void usage(const char* prog) {
+	std::cerr << "Usage: " << prog << " [options]\n"
+	          << "  --data <dir>      Directory containing gameplay.ldl (default: assets)\n"
+	          << "  --gameplay <file> Gameplay data, as LDL or as a bundle compiled by the\n"
+	          << "                    headless game (default: <data>/gameplay.ldl)\n"
+	          << "  --port <n>        TCP port to listen on (default: 4141)\n"
+	          << "  --threads <n>     Number of threads running the games, 0 to use all cores\n"
+	          << "                    (default: 0)\n"
+	          << "  --max-sessions <n>\n"
+	          << "                    Refuse connections beyond n players (default: 1024)\n";
+}
+
+
+int main(int argc, char** argv) {
+	Path     dataPath    = "assets";
+	Path     gameplay;
+	unsigned port        = 4141;
+	unsigned threads     = 0;
+	unsigned maxSessions = 1024;
+
+	for(int i = 1; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if(hasValue && std::strcmp(argv[i], "--data") == 0)
+			dataPath = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--gameplay") == 0)
+			gameplay = argv[++i];
+		else if(hasValue && std::strcmp(argv[i], "--port") == 0)
+			port = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--threads") == 0)
+			threads = std::atoi(argv[++i]);
+		else if(hasValue && std::strcmp(argv[i], "--max-sessions") == 0)
+			maxSessions = std::atoi(argv[++i]);
+		else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	GameServer gameServer(gameplay.empty()? dataPath / "gameplay.ldl": gameplay,
+	                      threads, maxSessions);
+	if(!gameServer.listen(port))
+		return EXIT_FAILURE;
+
+	server = &gameServer;
+	std::signal(SIGINT,  stopServer);
+	std::signal(SIGTERM, stopServer);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	gameServer.run();
+
+	server = nullptr;
+	return EXIT_SUCCESS;
+}
@@ -19,6 +19,8 @@
  */
 
 
+#include <algorithm>
+
 #include <lair/core/log.h>
 
 #include "map_node.h"
@@ -51,6 +53,11 @@ const String& SkillModel::id() const {
 }
 
 
+SymbolId SkillModel::symbol() const {
+	return _symbol;
+}
+
+
 const String& SkillModel::name() const {
 	return _name;
 }
@@ -66,39 +73,83 @@ const SkillModel::EffectVector& SkillModel::effects() const {
 }
 
 
+unsigned SkillModel::levelCount() const {
+	return _levels.size();
+}
+
+
+const SkillModel::LevelStats& SkillModel::stats(unsigned level) const {
+	return _levels[level];
+}
+
+
 SkillTarget SkillModel::target(unsigned level) const {
-	if(level == 0)
-		return NO_TARGET;
-	return SkillTarget(_target.at(level - 1));
+	return _levels[level].target;
 }
 
 
 unsigned SkillModel::range(unsigned level) const {
-	if(level == 0)
-		return 0;
-	return _range.at(level - 1);
+	return _levels[level].range;
 }
 
 
 unsigned SkillModel::cooldown(unsigned level) const {
-	if(level == 0)
-		return 0;
-	return _cooldown.at(level - 1);
+	return _levels[level].cooldown;
 }
 
 
 unsigned SkillModel::manaCost(unsigned level) const {
-	if(level == 0)
-		return 999999;
-	return _manaCost.at(level - 1);
+	return _levels[level].manaCost;
 }
 
 
+static int statAt(const IntVector& stats, unsigned index, int defaultValue = 0) {
+	return (index < stats.size())? stats[index]: defaultValue;
+}
+
+
+void SkillModel::_buildLevels(Logger& log) {
+	if(_effects.size() > MAX_EFFECTS)
+		log.error("Skill \"", _id, "\" has more than ", MAX_EFFECTS, " effects.");
+	unsigned effectCount = std::min<unsigned>(_effects.size(), MAX_EFFECTS);
+
+	size_t count = std::max(std::max(_target.size(), _range.size()),
+	                        std::max(_cooldown.size(), _manaCost.size()));
+	for(unsigned i = 0; i < effectCount; ++i) {
+		count = std::max(count, std::max(_effects[i]._type.size(), _effects[i]._power.size()));
+	}
+
+	_levels.assign(count + 1, LevelStats());
+	LevelStats& unlearned = _levels[0];
+	unlearned.target      = NO_TARGET;
+	unlearned.range       = 0;
+	unlearned.cooldown    = 0;
+	unlearned.manaCost    = 999999;
+	unlearned.effectCount = effectCount;
+	for(unsigned i = 0; i < effectCount; ++i) {
+		unlearned.effects[i] = EffectStats{ NO_EFFECT, 0 };
+	}
+
+	for(unsigned level = 1; level <= count; ++level) {
+		LevelStats& stats = _levels[level];
+		stats.target      = SkillTarget(statAt(_target, level - 1, NO_TARGET));
+		stats.range       = statAt(_range,    level - 1);
+		stats.cooldown    = statAt(_cooldown, level - 1);
+		stats.manaCost    = statAt(_manaCost, level - 1);
+		stats.effectCount = effectCount;
+		for(unsigned i = 0; i < effectCount; ++i) {
+			stats.effects[i].type  = SkillEffect(statAt(_effects[i]._type, level - 1, NO_EFFECT));
+			stats.effects[i].power = statAt(_effects[i]._power, level - 1);
+		}
+	}
+}
+
 
-Skill::Skill(SkillModelSP model, unsigned level, CharacterSP character)
+
+Skill::Skill(SkillModelSP model, unsigned level, Character* character)
     : _model(model)
     , _level(level)
-    , _timeBeforeNextUse(0)
+    , _readyTime(0)
     , _character(character)
 {
 }
@@ -155,26 +206,33 @@ unsigned Skill::level() const {
 }
 
 
+const SkillModel::LevelStats& Skill::stats() const {
+	return _model->_levels[_level];
+}
+
+
 unsigned Skill::timeBeforeNextUse() const {
-	return _timeBeforeNextUse;
+	unsigned played = character()->_turnsPlayed;
+	return (_readyTime > played)? _readyTime - played: 0;
 }
 
 
-CharacterSP Skill::character() const {
-	return _character.lock();
+Character* Skill::character() const {
+	return _character;
 }
 
 
 bool Skill::usable() const {
-	CharacterSP c = character();
-	return c->isAlive() && _level && _timeBeforeNextUse == 0
+	Character* c = character();
+	return c->isAlive() && _level && timeBeforeNextUse() == 0
 	    && c->mana() >= manaCost();
 }
 
 
 Team Skill::targetTeam() const {
-	for(const SkillModel::Effect& effect: _model->effects()) {
-		switch(effect.type(_level)) {
+	const SkillModel::LevelStats& stats = this->stats();
+	for(unsigned i = 0; i < stats.effectCount; ++i) {
+		switch(stats.effects[i].type) {
 		case NO_EFFECT:
 			return BLUE;
 		case DAMAGE:
@@ -195,22 +253,22 @@ CharacterVector Skill::targets() const {
 	if(!usable())
 		return chars;
 
-	CharacterSP c = character();
+	Character* c = character();
 	CharacterGroups groups = c->node()->characterGroups();
 	Team team = targetTeam();
 	switch(target()) {
 	case NO_TARGET:
 	case SINGLE:
 	case ANY_ROW:
-		dbgLogger.error("Invalid Skill::target call");
+		c->_textMoba->log().error("Invalid Skill::target call");
 		break;
 	case SELF:
-		chars.push_back(c);
+		chars.push_back(c->shared_from_this());
 		break;
 	case FRONT_ROW:
 		for(unsigned i = 0; i < groups.count(team, FRONT); ++i) {
 			CharacterSP t = groups.get(team, FRONT, i);
-			if(groups.distanceBetween(c, t) <= range()) {
+			if(groups.distanceBetween(c, t.get()) <= range()) {
 				chars.push_back(t);
 			}
 		}
@@ -218,7 +276,7 @@ CharacterVector Skill::targets() const {
 	case BACK_ROW:
 		for(unsigned i = 0; i < groups.count(team, BACK); ++i) {
 			CharacterSP t = groups.get(team, BACK, i);
-			if(groups.distanceBetween(c, t) <= range()) {
+			if(groups.distanceBetween(c, t.get()) <= range()) {
 				chars.push_back(t);
 			}
 		}
@@ -226,7 +284,7 @@ CharacterVector Skill::targets() const {
 	case BOTH_ROWS:
 		for(unsigned i = 0; i < groups.count(team); ++i) {
 			CharacterSP t = groups.get(team, i);
-			if(groups.distanceBetween(c, t) <= range()) {
+			if(groups.distanceBetween(c, t.get()) <= range()) {
 				chars.push_back(t);
 			}
 		}
@@ -243,46 +301,46 @@ CharacterVector Skill::targets(Place place) const {
 	if(!usable())
 		return chars;
 
-	CharacterSP c = character();
+	Character* c = character();
 	CharacterGroups groups = c->node()->characterGroups();
 	Team team = targetTeam();
 	if(target() == ANY_ROW) {
 		for(unsigned i = 0; i < groups.count(team, place); ++i) {
 			CharacterSP t = groups.get(team, place, i);
-			if(groups.distanceBetween(c, t) <= range()) {
+			if(groups.distanceBetween(c, t.get()) <= range()) {
 				chars.push_back(t);
 			}
 		}
 	} else if (target() == HEROES) {
 		for(unsigned i = 0; i < groups.count(team); ++i) {
 			CharacterSP t = groups.get(team, i);
-			if(groups.distanceBetween(c, t) <= range() && t->type() == HERO) {
+			if(groups.distanceBetween(c, t.get()) <= range() && t->type() == HERO) {
 				chars.push_back(t);
 			}
 		}
 	} else {
-		dbgLogger.error("Invalid Skill::target(Place) call");
+		c->_textMoba->log().error("Invalid Skill::target(Place) call");
 	}
 
 	return chars;
 }
 
 
-CharacterVector Skill::targets(CharacterSP target) const {
+CharacterVector Skill::targets(const CharacterSP& target) const {
 	CharacterVector chars;
 
 	if(!usable())
 		return chars;
 
-	CharacterSP c = character();
+	Character* c = character();
 	CharacterGroups groups = c->node()->characterGroups();
 	if(this->target() == SINGLE) {
-		if(groups.distanceBetween(c, target) <= range()) {
+		if(groups.distanceBetween(c, target.get()) <= range()) {
 			chars.push_back(target);
 		}
 	}
 	else {
-		dbgLogger.error("Invalid Skill::target(CharacterSP) call");
+		c->_textMoba->log().error("Invalid Skill::target(CharacterSP) call");
 	}
 
 	return chars;
@@ -299,7 +357,7 @@ void Skill::use(Place place) {
 }
 
 
-void Skill::use(CharacterSP target) {
+void Skill::use(const CharacterSP& target) {
 	useOn(targets(target));
 }
 
@@ -66,12 +66,40 @@ public:
 
 	typedef std::vector<Effect> EffectVector;
 
+	enum {
+		MAX_EFFECTS = 4,
+	};
+
+	struct EffectStats {
+		SkillEffect type;
+		unsigned    power;
+	};
+
+	// The stats of a level, built from the stat lists by _buildLevels(), so
+	// using a skill reads one struct smaller than a cache line instead of a
+	// vector per stat. Level 0 is a skill that has not been learned.
+	struct LevelStats {
+		SkillTarget target;
+		unsigned    range;
+		unsigned    cooldown;
+		unsigned    manaCost;
+		unsigned    effectCount;
+		EffectStats effects[MAX_EFFECTS];
+	};
+
+	typedef std::vector<LevelStats> LevelStatsVector;
+
 public:
 	const lair::String& id() const;
+	SymbolId symbol() const;
 	const lair::String& name() const;
 	const lair::String& desc() const;
 
 	const EffectVector& effects() const;
+	unsigned levelCount() const;
+	// level must be lower than levelCount().
+	const LevelStats& stats(unsigned level) const;
+
 	SkillTarget target(unsigned level) const;
 	unsigned range(unsigned level) const;
 	unsigned cooldown(unsigned level) const;
@@ -79,8 +107,12 @@ public:
 
 	void _use(unsigned level, CharacterSP character, CharacterSP target);
 
+	// Effects beyond MAX_EFFECTS are ignored.
+	void _buildLevels(lair::Logger& log);
+
 public:
 	lair::String _id;
+	SymbolId     _symbol;
 	lair::String _name;
 	lair::String _desc;
 
@@ -90,12 +122,14 @@ public:
 	IntVector    _range;
 	IntVector    _cooldown;
 	IntVector    _manaCost;
+
+	LevelStatsVector _levels;
 };
 
 
 class Skill : public std::enable_shared_from_this<Skill> {
 public:
-	Skill(SkillModelSP model, unsigned level, CharacterSP character);
+	Skill(SkillModelSP model, unsigned level, Character* character);
 
 	const lair::String& id() const;
 	const lair::String& name() const;
@@ -108,20 +142,21 @@ public:
 	unsigned cooldown() const;
 	unsigned manaCost() const;
 	unsigned level() const;
+	const SkillModel::LevelStats& stats() const;
 	unsigned timeBeforeNextUse() const;
 
-	CharacterSP character() const;
+	Character* character() const;
 
 	bool usable() const;
 	Team targetTeam() const;
 
 	CharacterVector targets() const;
 	CharacterVector targets(Place place) const;
-	CharacterVector targets(CharacterSP target) const;
+	CharacterVector targets(const CharacterSP& target) const;
 
 	void use();
 	void use(Place place);
-	void use(CharacterSP target);
+	void use(const CharacterSP& target);
 
 	void useOn(const CharacterVector& chars);
 
@@ -134,9 +169,11 @@ public:
 	SkillModelSP _model;
 
 	unsigned     _level;
-	unsigned     _timeBeforeNextUse;
+	// Value of the owner's Character::_turnsPlayed when it can be used again.
+	unsigned     _readyTime;
 
-	CharacterWP  _character;
+	// A skill is owned by its character, so this is always valid.
+	Character*   _character;
 };
 
 
@@ -31,6 +31,10 @@
 
 #define ONE_SEC (1000000000)
 
+// Time we wait for the preloaded images once the splash screens are over
+// before blocking on the loader.
+#define LOAD_TIMEOUT 30
+
 
 SplashState::SplashState(Game* game)
 	: GameState(game),
@@ -54,7 +58,12 @@ SplashState::SplashState(Game* game)
       _skipInput(nullptr),
 
       _skipTime(1.e20),
-      _nextState(nullptr) {
+      _nextState(nullptr),
+
+      _loadedCount(0),
+      _texturesResident(true),
+      _splashDone(false),
+      _loadTimeout(LOAD_TIMEOUT) {
 
 	_entities.registerComponentManager(&_sprites);
 	_entities.registerComponentManager(&_texts);
@@ -85,6 +94,12 @@ void SplashState::initialize() {
 	_splash = _entities.createEntity(_entities.root(), "splash_screen");
 	_splash.placeAt(Vector3(0, 0, 0));
 
+	_progress = _entities.createEntity(_entities.root(), "progress");
+	BitmapTextComponent* progressText = _texts.addComponent(_progress);
+	progressText->setFont("anonymous_pro_28.json");
+	progressText->setAnchor(Vector2(.5, 0));
+	resizeEvent();
+
 //	EntityRef text = loadEntity("text.json", _entities.root());
 //	text.place(Vector3(160, 90, .5));
 
@@ -151,6 +166,8 @@ void SplashState::setNextState(GameState* nextState) {
 
 void SplashState::addSplash(const Path& splashImage) {
 	_splashQueue.emplace_back(splashImage);
+	loader()->load<ImageLoader>(splashImage);
+	loader()->waitAll();
 }
 
 
@@ -159,6 +176,40 @@ void SplashState::clearSplash() {
 }
 
 
+void SplashState::preload(const AssetManifest& manifest) {
+	for(const Path& image: manifest.images()) {
+		_preloads.push_back(loader()->load<ImageLoader>(image));
+	}
+	log().info("Preloading ", _preloads.size(), " images...");
+
+	_texturesResident = false;
+	updateProgress();
+}
+
+
+bool SplashState::isLoaded() const {
+	return _loadedCount == _preloads.size() && _texturesResident;
+}
+
+
+void SplashState::updateProgress() {
+	unsigned loadedCount = 0;
+	for(const AspectSP& aspect: _preloads) {
+		if(aspect && aspect->isValid())
+			loadedCount += 1;
+	}
+
+	BitmapTextComponent* progressText = _texts.get(_progress);
+	if(progressText) {
+		progressText->setText((loadedCount == _preloads.size())?
+		                          String():
+		                          cat("Loading... ", loadedCount, " / ", _preloads.size()));
+	}
+
+	_loadedCount = loadedCount;
+}
+
+
 bool SplashState::nextSplash() {
 	if(_splashQueue.empty())
 		return false;
@@ -170,7 +221,8 @@ bool SplashState::nextSplash() {
 	splashSprite->setTexture(_splashQueue.front());
 //	splashSprite->setTextureFlags(Texture::BILINEAR_NO_MIPMAP);
 
-	loader()->waitAll();
+	// Already loaded by addSplash(), waiting here would wait for the
+	// preloaded images too.
 
 	_splashQueue.pop_front();
 
@@ -198,7 +250,12 @@ void SplashState::updateTick() {
 	_inputs.sync();
 	_entities.setPrevWorldTransforms();
 
-	_skipTime -= float(_loop.tickDuration()) / float(ONE_SEC);
+	// Loaded images are committed on this thread.
+	loader()->finalizePending();
+	updateProgress();
+
+	float dt = float(_loop.tickDuration()) / float(ONE_SEC);
+	_skipTime -= dt;
 
 	if (_skipTime <= 0
 	|| _skipInput->justPressed()) {
@@ -209,7 +266,18 @@ void SplashState::updateTick() {
 		}
 
 		if(!nextSplash())
+			_splashDone = true;
+	}
+
+	if(_splashDone) {
+		_loadTimeout -= dt;
+		if(!_nextState || isLoaded())
 			quit();
+		else if(_loadTimeout <= 0) {
+			log().warning("Images not loaded after ", LOAD_TIMEOUT, "s, waiting for them.");
+			loader()->waitAll();
+			quit();
+		}
 	}
 
 	_entities.updateWorldTransforms();
@@ -220,6 +288,11 @@ void SplashState::updateFrame() {
 	_texts.createTextures();
 	renderer()->uploadPendingTextures();
 
+	// Textures are resident once a frame uploaded them after their images
+	// finished loading.
+	if(_loadedCount == _preloads.size())
+		_texturesResident = true;
+
 	// Rendering
 	Context* glc = renderer()->context();
 
@@ -258,5 +331,6 @@ void SplashState::resizeEvent() {
 	                     1080,
 	                     1));
 	_camera.setViewBox(viewBox);
+	_progress.placeAt(Vector3(viewBox.max()(0) / 2, 40, .5));
 	renderer()->context()->viewport(0, 0, window()->width(), window()->height());
 }
@@ -39,6 +39,8 @@
 #include <lair/ec/sprite_component.h>
 #include <lair/ec/bitmap_text_component.h>
 
+#include "asset_manifest.h"
+
 
 using namespace lair;
 
@@ -46,6 +48,7 @@ using namespace lair;
 class Game;
 
 typedef std::deque<Path> PathQueue;
+typedef std::vector<AspectSP> AspectVector;
 
 class SplashState : public GameState {
 public:
@@ -64,6 +67,13 @@ public:
 	void addSplash(const Path& splashImage);
 	void clearSplash();
 	bool nextSplash();
+
+	// Starts loading the images of manifest on the loader threads. The next
+	// state only starts once they are all loaded and uploaded to the GPU.
+	void preload(const AssetManifest& manifest);
+	bool isLoaded() const;
+	void updateProgress();
+
 //	void setup(GameState* nextState, const Path& splashImage, float skipTime = 1.e20);
 	void updateTick();
 	void updateFrame();
@@ -96,6 +106,13 @@ protected:
 	GameState*  _nextState;
 	PathQueue   _splashQueue;
 	EntityRef   _splash;
+
+	AspectVector _preloads;
+	unsigned    _loadedCount;
+	bool        _texturesResident;
+	bool        _splashDone;
+	float       _loadTimeout;
+	EntityRef   _progress;
 };
 
 
@@ -0,0 +1,123 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_STRING_VIEW_H_
+#define LD41_STRING_VIEW_H_
+
+
+#include <cstring>
+#include <ostream>
+
+#include <lair/core/lair.h>
+
+
+// A non-owning part of a string, valid as long as the string it refers to.
+// Lets command arguments point into the typed line instead of copying each
+// word (a subset of C++17 std::string_view).
+class StringView {
+public:
+	typedef const char* const_iterator;
+
+	static const size_t npos = size_t(-1);
+
+public:
+	inline StringView()
+		: _data(nullptr), _size(0) {}
+	inline StringView(const char* data, size_t size)
+		: _data(data), _size(size) {}
+	inline StringView(const char* str)
+		: _data(str), _size(std::strlen(str)) {}
+	inline StringView(const lair::String& str)
+		: _data(str.data()), _size(str.size()) {}
+
+	inline const char* data() const { return _data; }
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return _size == 0; }
+
+	inline const_iterator begin() const { return _data; }
+	inline const_iterator end() const { return _data + _size; }
+
+	inline char operator[](size_t i) const { return _data[i]; }
+
+	inline StringView substr(size_t pos, size_t count = npos) const {
+		pos = std::min(pos, _size);
+		return StringView(_data + pos, std::min(count, _size - pos));
+	}
+
+	inline bool startsWith(StringView prefix) const {
+		return prefix._size <= _size
+		    && std::memcmp(_data, prefix._data, prefix._size) == 0;
+	}
+
+	inline lair::String str() const {
+		return lair::String(_data, _size);
+	}
+
+private:
+	const char* _data;
+	size_t      _size;
+};
+
+
+inline bool operator==(StringView lhs, StringView rhs) {
+	return lhs.size() == rhs.size()
+	    && std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+inline bool operator!=(StringView lhs, StringView rhs) {
+	return !(lhs == rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& out, StringView str) {
+	return out.write(str.data(), str.size());
+}
+
+
+// Parses an optional sign followed by decimal digits at the beginning of str,
+// like std::stoi. Returns false if there is no digit or if the number does not
+// fit. If count is set, it receives the number of characters parsed.
+inline bool parseInt(StringView str, int& value, size_t* count = nullptr) {
+	size_t i = 0;
+	bool negative = false;
+	if(i < str.size() && (str[i] == '-' || str[i] == '+')) {
+		negative = (str[i] == '-');
+		i += 1;
+	}
+
+	size_t first = i;
+	lair::int64 number = 0;
+	for(; i < str.size() && str[i] >= '0' && str[i] <= '9'; ++i) {
+		number = number * 10 + (str[i] - '0');
+		if(number > lair::int64(1) << 31)
+			return false;
+	}
+
+	if(i == first || (!negative && number > 0x7fffffff))
+		return false;
+
+	value = int(negative? -number: number);
+	if(count)
+		*count = i;
+	return true;
+}
+
+
+#endif
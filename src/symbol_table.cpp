@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <lair/core/log.h>
+
+#include "symbol_table.h"
+
+
+using namespace lair;
+
+
+SymbolTable::SymbolTable() {
+	clear();
+}
+
+
+unsigned SymbolTable::size() const {
+	return _names.size();
+}
+
+
+SymbolId SymbolTable::intern(const String& name) {
+	auto inserted = _symbols.emplace(name, _names.size());
+	if(inserted.second)
+		_names.push_back(name);
+	return inserted.first->second;
+}
+
+
+SymbolId SymbolTable::find(const String& name) const {
+	auto it = _symbols.find(name);
+	if(it == _symbols.end())
+		return NO_SYMBOL;
+	return it->second;
+}
+
+
+const String& SymbolTable::name(SymbolId symbol) const {
+	return _names.at(symbol);
+}
+
+
+void SymbolTable::clear() {
+	static const char* builtins[] = {
+	    "warrior",
+	    "ranger",
+	    "mage",
+	    "blueshirt",
+	    "redshirt",
+	    "tower",
+	    "fonxus",
+	    "bf",
+	    "rf",
+	};
+	static_assert(sizeof(builtins) / sizeof(*builtins) == SYM_BUILTIN_COUNT,
+	              "Missing builtin symbol");
+
+	_symbols.clear();
+	_names.clear();
+	for(const char* name: builtins) {
+		intern(name);
+	}
+}
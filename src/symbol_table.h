@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_SYMBOL_TABLE_H_
+#define LD41_SYMBOL_TABLE_H_
+
+
+#include <unordered_map>
+#include <vector>
+
+#include <lair/core/lair.h>
+
+
+// The ids of classes, skills and map nodes are interned to small integers
+// when the gameplay data is loaded, so the game compares and indexes
+// integers. Strings are only used to read the data and the commands.
+typedef unsigned SymbolId;
+const SymbolId NO_SYMBOL = SymbolId(-1);
+
+// Ids the code refers to. They are interned first by every SymbolTable, so
+// their symbols are constants.
+enum BuiltinSymbol {
+	SYM_WARRIOR,
+	SYM_RANGER,
+	SYM_MAGE,
+	SYM_BLUESHIRT,
+	SYM_REDSHIRT,
+	SYM_TOWER,
+	SYM_FONXUS,
+	SYM_BLUE_FONXUS_NODE,
+	SYM_RED_FONXUS_NODE,
+
+	SYM_BUILTIN_COUNT,
+};
+
+
+class SymbolTable {
+public:
+	SymbolTable();
+
+	unsigned size() const;
+
+	// Returns the symbol of name, creating it if needed.
+	SymbolId intern(const lair::String& name);
+	// Returns NO_SYMBOL if name has not been interned.
+	SymbolId find(const lair::String& name) const;
+	const lair::String& name(SymbolId symbol) const;
+
+	// Forgets everything but the builtin symbols.
+	void clear();
+
+private:
+	typedef std::unordered_map<lair::String, SymbolId> SymbolMap;
+
+private:
+	SymbolMap                 _symbols;
+	std::vector<lair::String> _names;
+};
+
+
+#endif
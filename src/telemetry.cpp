@@ -0,0 +1,429 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include <lair/core/log.h>
+
+#include "character_class.h"
+#include "character.h"
+#include "skill.h"
+#include "replay.h"
+
+#include "telemetry.h"
+
+
+using namespace lair;
+
+
+static const char     telemetryMagic[4] = { 'T', 'M', 'T', 'L' };
+static const unsigned telemetryVersion  = 1;
+
+
+static const char* statNames[] = {
+    "damage",
+    "damage_taken",
+    "healing",
+    "healing_taken",
+    "xp",
+    "kills",
+    "deaths",
+    "tower_kills",
+    "skill_uses",
+};
+
+static const char* recordNames[] = {
+    "turn",
+    "class",
+    "skill",
+    "match",
+};
+
+
+const char* telemetryStatName(TelemetryStat stat) {
+	return statNames[stat];
+}
+
+
+const char* telemetryRecordName(TelemetryRecordType type) {
+	return recordNames[type];
+}
+
+
+static inline char* putUint(char* out, uint32 value, unsigned size) {
+	for(unsigned i = 0; i < size; ++i) {
+		*(out++) = char(value & 0xff);
+		value >>= 8;
+	}
+	return out;
+}
+
+
+static inline uint32 getUint(const unsigned char* data, unsigned size) {
+	uint32 value = 0;
+	for(unsigned i = 0; i < size; ++i) {
+		value |= uint32(data[i]) << (8 * i);
+	}
+	return value;
+}
+
+
+
+TelemetryFile::TelemetryFile()
+    : _failed(false)
+{
+}
+
+
+TelemetryFile::~TelemetryFile() {
+	close();
+}
+
+
+bool TelemetryFile::isOpen() const {
+	return _out.is_open();
+}
+
+
+bool TelemetryFile::open(const Path& path, const SymbolTable& symbols) {
+	close();
+
+	_path   = path;
+	_failed = false;
+	_out.open(path.native().c_str(), std::ios::binary | std::ios::trunc);
+	if(!_out) {
+		dbgLogger.error("Unable to write telemetry to \"", path, "\".");
+		_failed = true;
+		return false;
+	}
+
+	_out.write(telemetryMagic, sizeof(telemetryMagic));
+	writeVarint(_out, telemetryVersion);
+	writeVarint(_out, symbols.size());
+	for(unsigned symbol = 0; symbol < symbols.size(); ++symbol) {
+		writeString(_out, symbols.name(symbol));
+	}
+
+	return bool(_out);
+}
+
+
+bool TelemetryFile::close() {
+	if(!_out.is_open())
+		return !_failed;
+
+	_out.close();
+	if(!_out)
+		_failed = true;
+	if(_failed)
+		dbgLogger.error("Failed to write telemetry to \"", _path, "\".");
+	return !_failed;
+}
+
+
+bool TelemetryFile::write(const char* data, size_t size) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if(!_out.is_open())
+		return false;
+
+	_out.write(data, size);
+	if(!_out)
+		_failed = true;
+	return !_failed;
+}
+
+
+bool TelemetryFile::decode(const Path& path, std::ostream& out) {
+	std::ifstream in(path.native().c_str(), std::ios::binary);
+	char magic[4];
+	if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, telemetryMagic, sizeof(magic)) != 0) {
+		dbgLogger.error("\"", path, "\" is not a telemetry file.");
+		return false;
+	}
+
+	uint64 version = 0;
+	uint64 symbolCount = 0;
+	if(!readVarint(in, version) || version != telemetryVersion
+	|| !readVarint(in, symbolCount)) {
+		dbgLogger.error("Unsupported telemetry file \"", path, "\".");
+		return false;
+	}
+
+	StringVector names(symbolCount);
+	for(String& name: names) {
+		if(!readString(in, name)) {
+			dbgLogger.error("Truncated telemetry file \"", path, "\".");
+			return false;
+		}
+	}
+
+	out << "match,turn,record,team,name";
+	for(unsigned stat = 0; stat < STAT_COUNT; ++stat)
+		out << "," << statNames[stat];
+	out << "\n";
+
+	unsigned char record[TelemetryFile::RECORD_SIZE];
+	while(in.read((char*)record, sizeof(record))) {
+		unsigned type = record[8];
+		unsigned team = record[9];
+		unsigned name = getUint(record + 10, 2);
+		if(type > RECORD_MATCH || team > NEUTRAL) {
+			dbgLogger.error("Invalid record in telemetry file \"", path, "\".");
+			return false;
+		}
+
+		out << getUint(record, 4) << "," << getUint(record + 4, 4) << ","
+		    << recordNames[type] << "," << teamName(Team(team)) << ",";
+		if(type == RECORD_MATCH)
+			out << teamName(Team(name));
+		else if(name < names.size())
+			out << names[name];
+		for(unsigned stat = 0; stat < STAT_COUNT; ++stat)
+			out << "," << getUint(record + 12 + 4 * stat, 4);
+		out << "\n";
+	}
+
+	if(in.gcount() != 0) {
+		dbgLogger.error("Truncated telemetry file \"", path, "\".");
+		return false;
+	}
+
+	return true;
+}
+
+
+
+Telemetry::Telemetry(TelemetryFile* file, unsigned bufferSize)
+    : _file(file)
+    , _bufferSize(std::max<unsigned>(bufferSize, TelemetryFile::RECORD_SIZE))
+    , _match(0)
+    , _turnIndex(0)
+    , _symbolCount(0)
+    , _currentSkill(nullptr)
+{
+	_buffer.reserve(_bufferSize);
+	std::memset(_turnStats,  0, sizeof(_turnStats));
+	std::memset(_matchStats, 0, sizeof(_matchStats));
+}
+
+
+Telemetry::~Telemetry() {
+	flush();
+}
+
+
+TelemetryFile* Telemetry::file() const {
+	return _file;
+}
+
+
+void Telemetry::beginMatch(unsigned match, const TextMoba& textMoba) {
+	_match        = match;
+	_turnIndex    = NO_TURN;
+	_symbolCount  = textMoba.symbols().size();
+	_currentSkill = nullptr;
+
+	std::memset(_turnStats,  0, sizeof(_turnStats));
+	std::memset(_matchStats, 0, sizeof(_matchStats));
+	_classStats.assign(_symbolCount * 2 * STAT_COUNT, 0);
+	_skillStats.assign(_symbolCount * 2 * STAT_COUNT, 0);
+}
+
+
+void Telemetry::endTurn(unsigned turn) {
+	_turnIndex = turn;
+	for(unsigned team = 0; team < 2; ++team) {
+		_record(RECORD_TURN, Team(team), NO_NAME, _turnStats[team]);
+		for(unsigned stat = 0; stat < STAT_COUNT; ++stat) {
+			_matchStats[team][stat] += _turnStats[team][stat];
+		}
+	}
+	std::memset(_turnStats, 0, sizeof(_turnStats));
+}
+
+
+void Telemetry::endMatch(unsigned turns, Team winner) {
+	// A match won ends during a turn, which is not recorded yet.
+	if(_turnIndex != turns)
+		endTurn(turns);
+
+	// Only the rows of the classes and skills that were used.
+	for(unsigned symbol = 0; symbol < _symbolCount; ++symbol) {
+		for(unsigned team = 0; team < 2; ++team) {
+			unsigned index = (symbol * 2 + team) * STAT_COUNT;
+			const uint32* classStats = &_classStats[index];
+			const uint32* skillStats = &_skillStats[index];
+			if(std::any_of(classStats, classStats + STAT_COUNT, [](uint32 v) { return v != 0; }))
+				_record(RECORD_CLASS, Team(team), symbol, classStats);
+			if(std::any_of(skillStats, skillStats + STAT_COUNT, [](uint32 v) { return v != 0; }))
+				_record(RECORD_SKILL, Team(team), symbol, skillStats);
+		}
+	}
+
+	for(unsigned team = 0; team < 2; ++team) {
+		_record(RECORD_MATCH, Team(team), winner, _matchStats[team]);
+	}
+	std::memset(_matchStats, 0, sizeof(_matchStats));
+}
+
+
+void Telemetry::setSkill(const Skill* skill) {
+	_currentSkill = skill;
+	if(skill) {
+		uint32* stats = _skill(skill->character()->team());
+		if(stats)
+			stats[STAT_SKILL_USES] += 1;
+	}
+}
+
+
+void Telemetry::damage(const Character* target, unsigned amount, const Character* source) {
+	if(uint32* stats = _class(target))
+		stats[STAT_DAMAGE_TAKEN] += amount;
+	if(uint32* stats = _turn(target->team()))
+		stats[STAT_DAMAGE_TAKEN] += amount;
+
+	if(source) {
+		if(uint32* stats = _class(source))
+			stats[STAT_DAMAGE] += amount;
+		if(uint32* stats = _turn(source->team()))
+			stats[STAT_DAMAGE] += amount;
+		if(_currentSkill && _currentSkill->character() == source) {
+			if(uint32* stats = _skill(source->team()))
+				stats[STAT_DAMAGE] += amount;
+		}
+	}
+}
+
+
+void Telemetry::heal(const Character* target, unsigned amount, const Character* source) {
+	if(uint32* stats = _class(target))
+		stats[STAT_HEALING_TAKEN] += amount;
+	if(uint32* stats = _turn(target->team()))
+		stats[STAT_HEALING_TAKEN] += amount;
+
+	if(source) {
+		if(uint32* stats = _class(source))
+			stats[STAT_HEALING] += amount;
+		if(uint32* stats = _turn(source->team()))
+			stats[STAT_HEALING] += amount;
+		if(_currentSkill && _currentSkill->character() == source) {
+			if(uint32* stats = _skill(source->team()))
+				stats[STAT_HEALING] += amount;
+		}
+	}
+}
+
+
+void Telemetry::xp(const Character* character, unsigned amount) {
+	if(uint32* stats = _class(character))
+		stats[STAT_XP] += amount;
+	if(uint32* stats = _turn(character->team()))
+		stats[STAT_XP] += amount;
+}
+
+
+void Telemetry::kill(const Character* target, const Character* killer) {
+	if(uint32* stats = _class(target))
+		stats[STAT_DEATHS] += 1;
+	if(uint32* stats = _turn(target->team()))
+		stats[STAT_DEATHS] += 1;
+
+	if(killer) {
+		TelemetryStat stat = (target->cClass()->symbol() == SYM_TOWER)?
+		                         STAT_TOWER_KILLS: STAT_KILLS;
+		if(uint32* stats = _class(killer))
+			stats[stat] += 1;
+		if(uint32* stats = _turn(killer->team()))
+			stats[stat] += 1;
+		if(_currentSkill && _currentSkill->character() == killer) {
+			if(uint32* stats = _skill(killer->team()))
+				stats[stat] += 1;
+		}
+	}
+}
+
+
+const uint32* Telemetry::turnStats(Team team) const {
+	return (team < 2)? _turnStats[team]: nullptr;
+}
+
+
+const uint32* Telemetry::classStats(SymbolId classSymbol, Team team) const {
+	if(classSymbol >= _symbolCount || team >= 2)
+		return nullptr;
+	return &_classStats[(classSymbol * 2 + team) * STAT_COUNT];
+}
+
+
+bool Telemetry::flush() {
+	if(_buffer.empty())
+		return true;
+
+	bool success = !_file || _file->write(_buffer.data(), _buffer.size());
+	_buffer.clear();
+	return success;
+}
+
+
+inline uint32* Telemetry::_class(const Character* character) {
+	SymbolId symbol = character->cClass()->symbol();
+	Team     team   = character->team();
+	if(symbol >= _symbolCount || team >= 2)
+		return nullptr;
+	return &_classStats[(symbol * 2 + team) * STAT_COUNT];
+}
+
+
+inline uint32* Telemetry::_skill(Team team) {
+	SymbolId symbol = _currentSkill->_model->symbol();
+	if(symbol >= _symbolCount || team >= 2)
+		return nullptr;
+	return &_skillStats[(symbol * 2 + team) * STAT_COUNT];
+}
+
+
+inline uint32* Telemetry::_turn(Team team) {
+	return (team < 2)? _turnStats[team]: nullptr;
+}
+
+
+void Telemetry::_record(TelemetryRecordType type, Team team, uint16 name,
+                        const uint32* stats) {
+	if(_buffer.size() + TelemetryFile::RECORD_SIZE > _bufferSize)
+		flush();
+
+	size_t offset = _buffer.size();
+	_buffer.resize(offset + TelemetryFile::RECORD_SIZE);
+
+	char* out = &_buffer[offset];
+	out = putUint(out, _match, 4);
+	out = putUint(out, _turnIndex, 4);
+	out = putUint(out, type, 1);
+	out = putUint(out, team, 1);
+	out = putUint(out, name, 2);
+	for(unsigned stat = 0; stat < STAT_COUNT; ++stat) {
+		out = putUint(out, stats[stat], 4);
+	}
+}
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_TELEMETRY_H_
+#define LD41_TELEMETRY_H_
+
+
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <lair/core/lair.h>
+#include <lair/core/path.h>
+
+#include "text_moba.h"
+
+
+// Per-match statistics for balance runs. Each counter exists per team for
+// each turn, and per team and class or skill for the whole match.
+enum TelemetryStat {
+	STAT_DAMAGE,        // Damage dealt (effective, i.e. at most the hp left).
+	STAT_DAMAGE_TAKEN,
+	STAT_HEALING,       // Hit points healed on others or self.
+	STAT_HEALING_TAKEN, // Including the regeneration of heroes.
+	STAT_XP,
+	STAT_KILLS,
+	STAT_DEATHS,
+	STAT_TOWER_KILLS,
+	STAT_SKILL_USES,
+
+	STAT_COUNT,
+};
+
+enum TelemetryRecordType {
+	RECORD_TURN,  // Counters of team during turn.
+	RECORD_CLASS, // Counters of the characters of class name and team.
+	RECORD_SKILL, // Counters of the uses of skill name by team.
+	RECORD_MATCH, // Counters of team for the match. name is the winner.
+};
+
+const char* telemetryStatName(TelemetryStat stat);
+const char* telemetryRecordName(TelemetryRecordType type);
+
+
+// A file of telemetry records. Several Telemetry instances, on different
+// threads, can write to the same file: each write is a whole block of
+// records.
+//
+// Layout: magic, version and the symbol table of the gameplay data (count,
+// then names) as varints, then RECORD_SIZE bytes records, little-endian:
+// match (4), turn (4), type (1), team (1), name (2), then STAT_COUNT
+// counters (4 each).
+class TelemetryFile {
+public:
+	enum {
+		RECORD_SIZE = 12 + 4 * STAT_COUNT,
+	};
+
+public:
+	TelemetryFile();
+	~TelemetryFile();
+
+	bool isOpen() const;
+	bool open(const lair::Path& path, const SymbolTable& symbols);
+	bool close();
+
+	bool write(const char* data, size_t size);
+
+	// Prints the records of a file as CSV, one record per line.
+	static bool decode(const lair::Path& path, std::ostream& out);
+
+private:
+	std::mutex    _mutex;
+	std::ofstream _out;
+	lair::Path    _path;
+	bool          _failed;
+};
+
+
+// Aggregates the statistics of the match played by a TextMoba (see
+// TextMoba::setTelemetry()). Counters are fixed-size arrays, allocated once
+// for the gameplay data; records are encoded in a buffer which is written
+// to the file when full, so the cost per event is a few additions.
+class Telemetry {
+public:
+	Telemetry(TelemetryFile* file = nullptr, unsigned bufferSize = 1 << 20);
+	~Telemetry();
+
+	TelemetryFile* file() const;
+
+	// Must be called before the match starts, once textMoba is initialized.
+	void beginMatch(unsigned match, const TextMoba& textMoba);
+	void endTurn(unsigned turn);
+	void endMatch(unsigned turns, Team winner);
+
+	// Damage and heals done while skill is set are counted for skill too.
+	void setSkill(const Skill* skill);
+
+	void damage(const Character* target, unsigned amount, const Character* source);
+	void heal(const Character* target, unsigned amount, const Character* source);
+	void xp(const Character* character, unsigned amount);
+	void kill(const Character* target, const Character* killer);
+
+	const lair::uint32* turnStats(Team team) const;
+	const lair::uint32* classStats(SymbolId classSymbol, Team team) const;
+
+	bool flush();
+
+private:
+	typedef lair::uint32 Counters[STAT_COUNT];
+	typedef std::vector<lair::uint32> CounterVector;
+
+	static const lair::uint16 NO_NAME = 0xffff;
+	static const unsigned     NO_TURN = unsigned(-1);
+
+private:
+	inline lair::uint32* _class(const Character* character);
+	inline lair::uint32* _skill(Team team);
+	inline lair::uint32* _turn(Team team);
+
+	void _record(TelemetryRecordType type, Team team, lair::uint16 name,
+	             const lair::uint32* stats);
+
+private:
+	TelemetryFile* _file;
+	unsigned       _bufferSize;
+	std::vector<char> _buffer;
+
+	unsigned       _match;
+	// Last turn recorded.
+	unsigned       _turnIndex;
+	unsigned       _symbolCount;
+	const Skill*   _currentSkill;
+
+	Counters       _turnStats[2];
+	Counters       _matchStats[2];
+	// STAT_COUNT counters for each (symbol, team).
+	CounterVector  _classStats;
+	CounterVector  _skillStats;
+};
+
+
+#endif
@@ -19,22 +19,32 @@
  */
 
 
+#include <algorithm>
+#include <sstream>
+
 #include <lair/core/log.h>
 
-#include "game.h"
-#include "main_state.h"
 #include "console.h"
 #include "commands.h"
 
 #include "map_node.h"
 #include "character_class.h"
+#include "character_store.h"
 #include "character.h"
 #include "skill.h"
 #include "ai.h"
 #include "redshirt_ai.h"
 #include "tower_ai.h"
 #include "hero_ai.h"
+#include "search_ai.h"
 #include "tm_command.h"
+#include "game_event.h"
+#include "gameplay_log.h"
+#include "worker_pool.h"
+#include "game_snapshot.h"
+#include "match_save.h"
+#include "gameplay_bundle.h"
+#include "telemetry.h"
 
 #include "text_moba.h"
 
@@ -42,143 +52,21 @@
 using namespace lair;
 
 
-// TODO: Move this to Lair
-
-
-const Variant& getVarItem(const Variant& var, const String& key, bool* success = nullptr) {
-	if(!var.isVarMap()) {
-		dbgLogger.error("Expected VarMap for key \"", key, "\", got \"", var.type()->identifier, "\".");
-		if(success)
-			*success = false;
-		return Variant::null;
-	}
-
-	return var.get(key);
-}
-
-bool getBool(const Variant& var, const String& key, bool defaultValue = false, bool* success = nullptr) {
-	const Variant& v = getVarItem(var, key, success);
-
-	if(v.isBool()) {
-		return v.asBool();
-	}
-	else if(!v.isNull()) {
-		dbgLogger.error("Expected Bool for key \"", key, "\", got \"", var.type()->identifier, "\".");
-		if(success)
-			*success = false;
-	}
-
-	return defaultValue;
-}
-
-int64 getInt(const Variant& var, const String& key, int64 defaultValue = 0, bool* success = nullptr) {
-	const Variant& v = getVarItem(var, key, success);
-
-	if(v.isInt()) {
-		return v.asInt();
-	}
-	else if(!v.isNull()) {
-		dbgLogger.error("Expected Int for key \"", key, "\", got \"", var.type()->identifier, "\".");
-		if(success)
-			*success = false;
-	}
-
-	return defaultValue;
-}
-
-float getFloat(const Variant& var, const String& key, float defaultValue = 0, bool* success = nullptr) {
-	const Variant& v = getVarItem(var, key, success);
-
-	if(v.isFloat()) {
-		return v.asFloat();
-	}
-	else if(!v.isNull()) {
-		dbgLogger.error("Expected Float for key \"", key, "\", got \"", var.type()->identifier, "\".");
-		if(success)
-			*success = false;
-	}
-
-	return defaultValue;
-}
-
-const String& getString(const Variant& var, const String& key, const String& defaultValue = String(), bool* success = nullptr) {
-	const Variant& v = getVarItem(var, key, success);
-
-	if(v.isString()) {
-		return v.asString();
-	}
-	else if(!v.isNull()) {
-		dbgLogger.error("Expected String for key \"", key, "\", got \"", var.type()->identifier, "\".");
-		if(success)
-			*success = false;
-	}
-
-	return defaultValue;
-}
-
-IntVector getIntList(const Variant& var, const String& key, unsigned size, int defaultValue, bool* success = nullptr) {
-	const Variant& v = getVarItem(var, key, success);
-
-	if(v.isInt()) {
-		return IntVector(size, v.asInt());
-	}
-	if(v.isVarList()) {
-		IntVector stats(size, defaultValue);
-		unsigned i = 0;
-		for(const Variant& v2: v.asVarList()) {
-			if(i < size) {
-				stats[i] = v2.asInt();
-				i += 1;
-			}
-			else {
-				dbgLogger.warning("Too much value in array ", key);
-				break;
-			}
-		}
-		return stats;
-	}
-	else if(!v.isNull()) {
-		dbgLogger.error("Expected Int list.");
-		if(success)
-			*success = false;
-	}
-
-	return IntVector(6, defaultValue);
-}
-
-StringVector getStringList(const Variant& var, const String& key, bool* success = nullptr) {
-	const Variant& v = getVarItem(var, key, success);
-
-	StringVector strings;
-	if(v.isString()) {
-		strings.push_back(v.asString());
-	}
-	if(v.isVarList()) {
-		for(const Variant& v2: v.asVarList()) {
-			if(v2.isString()) {
-				strings.push_back(v2.asString());
-			}
-			else {
-				dbgLogger.warning("Expected String");
-			}
-		}
-	}
-	else if(!v.isNull()) {
-		dbgLogger.error("Expected String list.");
-		if(success)
-			*success = false;
-	}
-
-	return strings;
+template<typename T>
+void setBySymbol(std::vector<T>& table, SymbolId symbol, const T& value) {
+	if(table.size() <= symbol)
+		table.resize(symbol + 1);
+	table[symbol] = value;
 }
 
-IntVector getClassStats(const Variant& var, const String& key, bool* success = nullptr) {
-	return getIntList(var, key, 6, 0, success);
+template<typename T>
+T getBySymbol(const std::vector<T>& table, SymbolId symbol) {
+	return (symbol < table.size())? table[symbol]: T();
 }
 
 
 
-bool CharacterOrder::operator()(const CharacterSP& c0, const CharacterSP& c1) const {
+bool CharacterOrder::operator()(const Character* c0, const Character* c1) const {
 	if(c0->team() < c1->team())
 		return true;
 	if(c1->team() < c0->team())
@@ -195,6 +83,16 @@ bool CharacterOrder::operator()(const CharacterSP& c0, const CharacterSP& c1) co
 }
 
 
+bool CharacterOrder::operator()(const CharacterSP& c0, const CharacterSP& c1) const {
+	return (*this)(c0.get(), c1.get());
+}
+
+
+bool CharacterOrder::operator()(const CharacterSP& c0, const Character* c1) const {
+	return (*this)(c0.get(), c1);
+}
+
+
 
 const String& teamName(Team team) {
 	static const String names[] = {
@@ -213,14 +111,6 @@ const String& placeName(Place place) {
 	return names[place];
 }
 
-const String& laneName(Lane lane) {
-	static const String names[] = {
-	    "top",
-	    "bot",
-	};
-	return names[lane];
-}
-
 const lair::String& charTypeName(CharType charType) {
 	static const String names[] = {
 	    "hero",
@@ -256,14 +146,52 @@ Place placeFromPlaceIndex(unsigned pi) {
 
 
 
-TextMoba::TextMoba(MainState* mainState, Console* console)
-    : _mainState(mainState)
-    , _console(console)
+// The state of the phased AI mode, see TextMoba::setPhasedAi().
+struct AiPhase {
+	AiPhase(unsigned threadCount)
+	    : workers(threadCount) {
+	}
+
+	WorkerPool              workers;
+	std::vector<Character*> characters;
+	std::vector<unsigned>   seeds;
+	std::vector<AiAction>   actions;
+};
+
+
+// While an Ai decides in phased mode, random numbers come from a generator
+// owned by the decision instead of the shared one, see _playNpcsPhased().
+static thread_local std::minstd_rand* decisionRng = nullptr;
+
+
+
+TextMoba::TextMoba(Console* console)
+    : _console(console)
+    , _logger(&dbgLogger)
+    , _autoPlayer(false)
+    , _logEvents(true)
+    , _version(0)
+    , _telemetry(nullptr)
+    , _simulating(false)
+    , _searchAiTeam(NEUTRAL)
+    , _fastForward(false)
+    , _fastForwardStart(0)
+    , _fastForwardEnd(unsigned(-1))
+    , _maxFastForward(unsigned(-1))
     , _currentCommand(nullptr)
+    , _fonxusNodes{ nullptr, nullptr }
+    , _dataHash(0)
+    , _store(new CharacterStore)
+    , _winner(NEUTRAL)
 {
 	using namespace std::placeholders;
 
-	_console->setExecCommand(std::bind(&TextMoba::_execCommand, this, _1, false));
+	if(_console) {
+		_console->setExecCommand(std::bind(&TextMoba::execInput, this, _1));
+		_console->setCompleteCommand(std::bind(&TextMoba::completeCommand, this, _1, _2));
+		addEventListener(EventPrinter(this));
+		_profiler.setEnabled(true);
+	}
 
 	_addCommand<HelpCommand>();
 	_addCommand<InfoCommand>();
@@ -275,34 +203,482 @@ TextMoba::TextMoba(MainState* mainState, Console* console)
 	_addCommand<AttackCommand>();
 	_addCommand<UseCommand>();
 	_addCommand<RestartCommand>();
+	_addCommand<PerfCommand>();
+}
+
+
+TextMoba::~TextMoba() {
+}
+
+
+bool TextMoba::initialize(const Path& logicPath) {
+	std::shared_ptr<GameplayBundle> bundle = std::make_shared<GameplayBundle>();
+	if(!bundle->load(logicPath, log()))
+		return false;
+	return initialize(bundle);
+}
+
+
+Console* TextMoba::console() {
+	return _console;
+}
+
+
+Logger& TextMoba::log() {
+	return *_logger;
+}
+
+
+void TextMoba::setLogger(Logger* logger) {
+	_logger = logger? logger: &dbgLogger;
+}
+
+
+TurnProfiler& TextMoba::profiler() {
+	return _profiler;
+}
+
+
+Telemetry* TextMoba::telemetry() const {
+	return _telemetry;
+}
+
+
+void TextMoba::setTelemetry(Telemetry* telemetry) {
+	_telemetry = telemetry;
+}
+
+
+unsigned TextMoba::version() const {
+	return _version;
+}
+
+
+void TextMoba::addEventListener(const GameEventListener& listener) {
+	_eventListeners.push_back(listener);
+}
+
+
+bool TextMoba::logEvents() const {
+	return _logEvents;
+}
+
+
+void TextMoba::setLogEvents(bool logEvents) {
+	_logEvents = logEvents;
+}
+
+
+void TextMoba::_emit(const GameEvent& event) {
+	if(_simulating)
+		return;
+	if(LD41_GAMEPLAY_LOG_LEVEL > LD41_LOG_NONE && _logEvents) {
+		logGameEvent(log(), event);
+	}
+	if(_fastForward) {
+		summarizeGameEvent(_summary, event, _player.get());
+	}
+	for(const GameEventListener& listener: _eventListeners) {
+		listener(event);
+	}
+}
+
+
+void TextMoba::seed(unsigned seed) {
+	_rng.seed(seed);
+}
+
+
+// Returns a random number in [0, count). We don't use std::uniform_int_distribution
+// because its output is implementation-defined.
+unsigned TextMoba::random(unsigned count) {
+	if(decisionRng)
+		return (*decisionRng)() % count;
+	return _rng() % count;
+}
+
+
+bool TextMoba::autoPlayer() const {
+	return _autoPlayer;
+}
+
+
+void TextMoba::setAutoPlayer(bool autoPlayer) {
+	_autoPlayer = autoPlayer;
+}
+
+
+bool TextMoba::phasedAi() const {
+	return bool(_aiPhase);
+}
+
+
+// 0 if not in phased mode.
+unsigned TextMoba::aiThreadCount() const {
+	return _aiPhase? _aiPhase->workers.threadCount(): 0;
+}
+
+
+void TextMoba::setPhasedAi(bool phasedAi, unsigned threadCount) {
+	_aiPhase.reset(phasedAi? new AiPhase(std::max(threadCount, 1u)): nullptr);
+}
+
+
+Team TextMoba::searchAiTeam() const {
+	return _searchAiTeam;
+}
+
+
+const SearchAiConfig& TextMoba::searchAiConfig() const {
+	return _searchAiConfig;
+}
+
+
+void TextMoba::setSearchAi(Team team, const SearchAiConfig& config) {
+	_searchAiTeam   = team;
+	_searchAiConfig = config;
+}
+
+
+void TextMoba::saveSnapshot(GameSnapshot& snapshot) const {
+	snapshot.release();
+	snapshot._valid = true;
+
+	snapshot._turn         = _turn;
+	snapshot._nextWaveTurn = _nextWaveTurn;
+	snapshot._winner       = _winner;
+	snapshot._charIndex    = _charIndex;
+	snapshot._rng          = _rng;
+	snapshot._store        = *_store;
+
+	snapshot._buffs.clear();
+	snapshot._readyTimes.clear();
+	for(const CharacterSP& c: _characters) {
+		snapshot._characters.push_back(GameSnapshot::CharacterState{
+		    c, c->_handle, c->_index, c->_xp, c->_turnsPlayed, c->_lastTurn,
+		    unsigned(snapshot._buffs.size()), unsigned(snapshot._readyTimes.size()),
+		    c->_ai? c->_ai->state(): AiState() });
+
+		snapshot._buffs.insert(snapshot._buffs.end(), c->_buffs.begin(), c->_buffs.end());
+		for(const SkillSP& skill: c->_skills) {
+			snapshot._readyTimes.push_back(skill->_readyTime);
+		}
+	}
+
+	snapshot._killedCharacters = _killedCharacters;
+	snapshot._redshirtPool[BLUE] = _redshirtPool[BLUE];
+	snapshot._redshirtPool[RED]  = _redshirtPool[RED];
 }
 
 
-void TextMoba::initialize(const Path& logicPath) {
-	VirtualFile file = _mainState->game()->fileSystem()->file(logicPath);
+void TextMoba::restoreSnapshot(const GameSnapshot& snapshot) {
+	lairAssert(snapshot.isValid());
+
+	_turn         = snapshot._turn;
+	_nextWaveTurn = snapshot._nextWaveTurn;
+	_winner       = snapshot._winner;
+	_charIndex    = snapshot._charIndex;
+	_rng          = snapshot._rng;
+	*_store       = snapshot._store;
+	++_version;
 
-	Path realPath = file.realPath();
-	if(!realPath.empty()) {
-		Path::IStream in(realPath.native().c_str());
-		_initialize(in, logicPath);
+	// Node rows are sorted, so adding the characters back in any order
+	// gives the same nodes.
+	for(const auto& pair: _nodes) {
+		pair.second->clearCharacters();
 	}
+	_characters.clear();
 
-	const MemFile* memFile = file.fileBuffer();
-	if(memFile) {
-		String buffer((const char*)memFile->data, memFile->size);
-		std::istringstream in(buffer);
-		_initialize(in, logicPath);
+	const GameSnapshot::CharacterStateVector& states = snapshot._characters;
+	for(unsigned i = 0; i < states.size(); ++i) {
+		const GameSnapshot::CharacterState& state = states[i];
+		Character* c = state.character.get();
+
+		c->_handle      = state.handle;
+		c->_index       = state.index;
+		c->_xp          = state.xp;
+		c->_turnsPlayed = state.turnsPlayed;
+		c->_lastTurn    = state.lastTurn;
+
+		unsigned buffEnd = (i + 1 < states.size())? states[i + 1].buffBegin:
+		                                            snapshot._buffs.size();
+		c->_buffs.assign(snapshot._buffs.begin() + state.buffBegin,
+		                 snapshot._buffs.begin() + buffEnd);
+		for(unsigned si = 0; si < c->_skills.size(); ++si) {
+			c->_skills[si]->_readyTime = snapshot._readyTimes[state.skillBegin + si];
+		}
+		if(c->_ai)
+			c->_ai->setState(state.ai);
+
+		_characters.emplace_hint(_characters.end(), state.character);
+		if(c->node())
+			c->node()->addCharacter(state.character);
 	}
+
+	_killedCharacters   = snapshot._killedCharacters;
+	_redshirtPool[BLUE] = snapshot._redshirtPool[BLUE];
+	_redshirtPool[RED]  = snapshot._redshirtPool[RED];
 }
 
 
-MainState* TextMoba::mainState() {
-	return _mainState;
+void TextMoba::saveMatch(MatchSave& save) const {
+	save.clear();
+
+	save._dataHash     = _dataHash;
+	save._turn         = _turn;
+	save._nextWaveTurn = _nextWaveTurn;
+	save._winner       = _winner;
+	save._charIndex    = _charIndex;
+	save._replay       = _replay;
+
+	std::ostringstream rng;
+	rng << _rng;
+	save._rng = rng.str();
+
+	for(const CharacterSP& c: _characters) {
+		// Killed redshirts and towers are only removed at the next turn.
+		if(!_store->isValid(c->handle()))
+			continue;
+
+		MatchSave::CharacterState state;
+		state.classSymbol = c->cClass()->symbol();
+		state.index       = c->index();
+		state.team        = c->team();
+		state.node        = c->node()? c->node()->symbol(): NO_SYMBOL;
+		state.place       = c->place();
+		state.level       = c->level();
+		state.hp          = c->hp();
+		state.mana        = c->mana();
+		state.respawnTurn = c->respawnTurn();
+		state.xp          = c->_xp;
+		state.turnsPlayed = c->_turnsPlayed;
+		state.lastTurn    = c->_lastTurn;
+		state.hasAi       = bool(c->_ai);
+		state.aiTarget    = MatchSave::NO_INDEX;
+		state.aiStatus    = 0;
+		state.aiLane      = 0;
+		if(c->_ai) {
+			AiState ai = c->_ai->state();
+			if(Character* target = character(ai.target))
+				state.aiTarget = target->index();
+			state.aiStatus = ai.status;
+			state.aiLane   = ai.lane;
+		}
+		state.buffCount  = c->_buffs.size();
+		state.skillCount = c->_skills.size();
+		save._characters.push_back(state);
+
+		save._buffs.insert(save._buffs.end(), c->_buffs.begin(), c->_buffs.end());
+		for(const SkillSP& skill: c->_skills) {
+			save._skills.push_back(MatchSave::SkillState{ skill->_level, skill->_readyTime });
+		}
+	}
+
+	for(const CharacterSP& hero: _heroes) {
+		save._heroes.push_back(hero->index());
+	}
 }
 
 
-Console* TextMoba::console() {
-	return _console;
+bool TextMoba::loadMatch(const MatchSave& save) {
+	if(save._dataHash != _dataHash) {
+		log().error("Saved match was made with different gameplay data.");
+		return false;
+	}
+
+	std::mt19937 rng;
+	std::istringstream rngIn(save._rng);
+	rngIn >> rng;
+
+	// Check everything first so an invalid save leaves the game untouched.
+	bool valid = bool(rngIn) && save._heroes.size() && save._winner <= NEUTRAL;
+	unsigned buffCount  = 0;
+	unsigned skillCount = 0;
+	unsigned fonxusCount[2] = { 0, 0 };
+	for(const MatchSave::CharacterState& state: save._characters) {
+		CharacterClassSP cClass = characterClass(state.classSymbol);
+		valid = valid && cClass && state.team < NEUTRAL && state.place <= FRONT &&
+		        state.index < save._charIndex && state.level < cClass->levelCount() &&
+		        state.hp <= unsigned(cClass->maxHP(state.level)) &&
+		        state.mana <= unsigned(cClass->maxMana(state.level)) &&
+		        state.skillCount == cClass->skillModels().size() &&
+		        skillCount + state.skillCount <= save._skills.size() &&
+		        buffCount + state.buffCount <= save._buffs.size();
+		if(!valid)
+			break;
+
+		// Only dead heroes are off the map.
+		CharType type = cClass->type();
+		valid = (state.node == NO_SYMBOL)? type == HERO && state.respawnTurn:
+		                                   mapNode(state.node) != nullptr;
+
+		// Heroes and redshirts follow a lane, towers are the only buildings
+		// with an AI.
+		if(state.hasAi) {
+			valid = valid && (type != BUILDING || cClass->symbol() == SYM_TOWER) &&
+			        (type == BUILDING || state.aiLane < laneCount()) &&
+			        (type != HERO || state.aiStatus <= HeroAi::BACK_TO_BASE);
+		}
+
+		for(unsigned i = 0; valid && i < state.skillCount; ++i) {
+			valid = save._skills[skillCount + i].level <
+			        cClass->skillModels()[i]->levelCount();
+		}
+		for(unsigned i = 0; valid && i < state.buffCount; ++i) {
+			const Buff& b = save._buffs[buffCount + i];
+			valid = b.ticks && (b.type == 'h' || b.type == 'd');
+		}
+		if(cClass->symbol() == SYM_FONXUS)
+			fonxusCount[state.team] += 1;
+
+		buffCount  += state.buffCount;
+		skillCount += state.skillCount;
+	}
+	valid = valid && buffCount == save._buffs.size() && skillCount == save._skills.size() &&
+	        fonxusCount[BLUE] == 1 && fonxusCount[RED] == 1;
+
+	// Characters refer to each other by index.
+	struct IndexedCharacter {
+		unsigned index;
+		const MatchSave::CharacterState* state;
+		CharacterSP character;
+	};
+	auto byIndexOrder = [](const IndexedCharacter& c0, const IndexedCharacter& c1) {
+		return c0.index < c1.index;
+	};
+	std::vector<IndexedCharacter> byIndex;
+	byIndex.reserve(save._characters.size());
+	for(const MatchSave::CharacterState& state: save._characters) {
+		byIndex.push_back(IndexedCharacter{ state.index, &state, CharacterSP() });
+	}
+	std::sort(byIndex.begin(), byIndex.end(), byIndexOrder);
+	for(unsigned i = 1; valid && i < byIndex.size(); ++i) {
+		valid = byIndex[i - 1].index != byIndex[i].index;
+	}
+	auto find = [&byIndex, &byIndexOrder](unsigned index) {
+		auto it = std::lower_bound(byIndex.begin(), byIndex.end(),
+		                           IndexedCharacter{ index, nullptr, CharacterSP() },
+		                           byIndexOrder);
+		return (it != byIndex.end() && it->index == index)? it: byIndex.end();
+	};
+	for(const MatchSave::CharacterState& state: save._characters) {
+		valid = valid && (state.aiTarget == MatchSave::NO_INDEX ||
+		                  find(state.aiTarget) != byIndex.end());
+	}
+
+	// Heroes are listed once each, the player first, who is blue.
+	std::vector<unsigned> heroes = save._heroes;
+	std::sort(heroes.begin(), heroes.end());
+	valid = valid && std::adjacent_find(heroes.begin(), heroes.end()) == heroes.end();
+	for(unsigned i = 0; valid && i < save._heroes.size(); ++i) {
+		auto it = find(save._heroes[i]);
+		valid = it != byIndex.end() &&
+		        characterClass(it->state->classSymbol)->type() == HERO &&
+		        (i != 0 || it->state->team == BLUE);
+	}
+
+	if(!valid) {
+		log().error("Invalid saved match.");
+		return false;
+	}
+
+	_clearCharacters();
+
+	_rng          = rng;
+	_replay       = save._replay;
+	_turn         = save._turn;
+	_nextWaveTurn = save._nextWaveTurn;
+	_winner       = save._winner;
+	_charIndex    = save._charIndex;
+	++_version;
+
+	// Like in restart(), the player only has an AI in auto-player mode.
+	unsigned playerIndex = save._heroes.front();
+
+	unsigned buff  = 0;
+	unsigned skill = 0;
+	for(const MatchSave::CharacterState& state: save._characters) {
+		CharacterClassSP cClass = characterClass(state.classSymbol);
+		CharacterSP c = std::make_shared<Character>(this, cClass, state.index, state.level);
+		c->_setTeam(state.team);
+		c->_setPlace(state.place);
+		c->_setHp(state.hp);
+		c->_setMana(state.mana);
+		c->_setRespawnTurn(state.respawnTurn);
+		c->_xp          = state.xp;
+		c->_turnsPlayed = state.turnsPlayed;
+		c->_lastTurn    = state.lastTurn;
+
+		c->_buffs.assign(save._buffs.begin() + buff,
+		                 save._buffs.begin() + buff + state.buffCount);
+		buff += state.buffCount;
+		for(const SkillModelSP& sm: cClass->skillModels()) {
+			c->addSkill(sm, save._skills[skill].level);
+			c->_skills.back()->_readyTime = save._skills[skill].readyTime;
+			++skill;
+		}
+
+		Lane lane = Lane(state.aiLane);
+		if(c->type() == HERO) {
+			if(state.index != playerIndex || _autoPlayer) {
+				if(c->team() == _searchAiTeam)
+					c->setAi<SearchHeroAi>(lane);
+				else
+					c->setAi<HeroAi>(lane);
+			}
+		}
+		else if(state.hasAi) {
+			if(c->type() == REDSHIRT)
+				c->setAi<RedshirtAi>(lane);
+			else
+				c->setAi<TowerAi>();
+		}
+
+		if(MapNode* node = mapNode(state.node)) {
+			c->_setNode(node);
+			node->addCharacter(c);
+		}
+		if(cClass->symbol() == SYM_FONXUS) {
+			if(c->team() == BLUE)
+				_blueFonxus = c;
+			else
+				_redFonxus = c;
+		}
+
+		_characters.emplace(c);
+		find(state.index)->character = c;
+	}
+
+	for(const MatchSave::CharacterState& state: save._characters) {
+		const CharacterSP& c = find(state.index)->character;
+		if(!c->_ai)
+			continue;
+
+		auto target = find(state.aiTarget);
+		c->_ai->setState(AiState{
+		    (target != byIndex.end())? target->character->handle(): CharacterHandle(),
+		    state.aiStatus, state.aiLane });
+	}
+
+	for(unsigned index: save._heroes) {
+		_heroes.push_back(find(index)->character);
+	}
+	_player = _heroes.front();
+
+	if(_console)
+		execCommand("look");
+
+	return true;
+}
+
+
+bool TextMoba::isSimulating() const {
+	return _simulating;
+}
+
+
+void TextMoba::setSimulating(bool simulating) {
+	_simulating = simulating;
 }
 
 
@@ -326,12 +702,12 @@ unsigned TextMoba::towerXpWorth(unsigned level) const {
 }
 
 
-unsigned TextMoba::nextLevel(CharacterSP character) const {
+unsigned TextMoba::nextLevel(const Character* character) const {
 	return (character->type() == HERO)? heroNextLevel(character->level()): 0;
 }
 
 
-unsigned TextMoba::xpWorth(CharacterSP character) const {
+unsigned TextMoba::xpWorth(const Character* character) const {
 	switch(character->type()) {
 	case HERO:
 		return heroXpWorth(character->level());
@@ -344,24 +720,56 @@ unsigned TextMoba::xpWorth(CharacterSP character) const {
 }
 
 
-MapNodeSP TextMoba::mapNode(const String& id) {
-	auto it = _nodes.find(id);
-	if(it == _nodes.end())
-		return nullptr;
+const SymbolTable& TextMoba::symbols() const {
+	return _symbols;
+}
+
+
+MapNode* TextMoba::mapNode(const String& id) {
+	return mapNode(_symbols.find(id));
+}
+
+
+MapNode* TextMoba::mapNode(SymbolId symbol) const {
+	return getBySymbol(_nodeBySymbol, symbol);
+}
+
+
+MapNode* TextMoba::fonxus(Team team) const {
+	return _fonxusNodes[team];
+}
+
+
+unsigned TextMoba::laneCount() const {
+	return _gameplay->_lanes.size();
+}
+
+
+const String& TextMoba::laneName(Lane lane) const {
+	return _gameplay->_lanes.at(lane);
+}
+
+
+DirectionId TextMoba::directionId(const String& direction) const {
+	auto it = _directions.find(direction);
+	if(it == _directions.end())
+		return NO_DIRECTION;
 	return it->second;
 }
 
 
-MapNodeSP TextMoba::fonxus(Team team) {
-	return mapNode((team == BLUE)? "bf": "rf");
+unsigned TextMoba::directionCount() const {
+	return _directions.size();
 }
 
 
 CharacterClassSP TextMoba::characterClass(const lair::String& id) {
-	auto it = _classes.find(id);
-	if(it == _classes.end())
-		return nullptr;
-	return it->second;
+	return characterClass(_symbols.find(id));
+}
+
+
+CharacterClassSP TextMoba::characterClass(SymbolId symbol) const {
+	return getBySymbol(_classBySymbol, symbol);
 }
 
 
@@ -370,16 +778,33 @@ const CharacterSet& TextMoba::characters() const {
 }
 
 
-CharacterSP TextMoba::player() {
+const CharacterSP& TextMoba::player() const {
 	return _player;
 }
 
 
+Character* TextMoba::character(CharacterHandle handle) const {
+	return _store->get(handle);
+}
+
+
+CharacterStore& TextMoba::characterStore() {
+	return *_store;
+}
+
+
+const CharacterStore& TextMoba::characterStore() const {
+	return *_store;
+}
+
+
 SkillModelSP TextMoba::skillModel(const lair::String id) {
-	auto it = _skillModels.find(id);
-	if(it == _skillModels.end())
-		return nullptr;
-	return it->second;
+	return skillModel(_symbols.find(id));
+}
+
+
+SkillModelSP TextMoba::skillModel(SymbolId symbol) const {
+	return getBySymbol(_skillModelBySymbol, symbol);
 }
 
 
@@ -396,208 +821,265 @@ const lair::String* TextMoba::infos(const String& topic) {
 }
 
 
+StringVector TextMoba::images() const {
+	StringVector images;
+	for(const auto& pair: _nodes) {
+		for(const String& img: pair.second->_images) {
+			images.push_back(img);
+		}
+	}
+	for(const auto& pair: _classes) {
+		if(pair.second->image().size()) {
+			images.push_back(pair.second->image());
+		}
+	}
+	return images;
+}
+
+
 CharacterSP TextMoba::spawnCharacter(const lair::String& className, Team team,
-                                     MapNodeSP node) {
+                                     MapNode* node) {
 	CharacterClassSP cc = characterClass(className);
 	if(!cc) {
-		dbgLogger.error("Invalid character class: \"", className, "\"");
+		log().error("Invalid character class: \"", className, "\"");
 		return CharacterSP();
 	}
 
-	CharacterSP character = std::make_shared<Character>(this, cc, _charIndex);
-	character->_team = team;
+	return spawnCharacter(cc, team, node);
+}
 
-	for(const String& skillName: cc->skills()) {
-		SkillModelSP sm = skillModel(skillName);
-		if(sm) {
-			character->addSkill(sm, 1);
-		}
-		else {
-			dbgLogger.warning("Skill model not found: \"", skillName, "\"");
-		}
-	}
 
-	if(node) {
-		moveCharacter(character, node);
-	}
+CharacterSP TextMoba::spawnCharacter(const CharacterClassSP& cClass, Team team,
+                                     MapNode* node) {
+	CharacterSP character = std::make_shared<Character>(this, cClass, _charIndex);
+	character->_setTeam(team);
 
-	dbgLogger.log("Spawn ", character->teamName(), " ", character->className(),
-	              " ", character->index(), " at ", node? node->name(): "<nowhere>");
+	for(const SkillModelSP& sm: cClass->skillModels()) {
+		character->addSkill(sm, 1);
+	}
 
-	_characters.emplace(character);
-	++_charIndex;
+	_addCharacter(character, node);
 
 	return character;
 }
 
 
 CharacterSP TextMoba::spawnRedshirt(Team team, Lane lane) {
-	static const String classes[] = {
-	    "blueshirt",
-	    "redshirt",
-	};
+	MapNode* fonxus = this->fonxus(team);
+
+	// Waves are spawned all game long, so we recycle killed redshirts
+	// instead of allocating a character, its skills and its AI each time.
+	CharacterSP redshirt;
+	CharacterVector& pool = _redshirtPool[team];
+	if(pool.size()) {
+		redshirt = std::move(pool.back());
+		pool.pop_back();
 
-	MapNodeSP fonxus = mapNode((team == BLUE)? "bf": "rf");
-	CharacterSP redshirt = spawnCharacter(classes[team], team, fonxus);
-	redshirt->setAi<RedshirtAi>(lane);
-	dbgLogger.info("  RedshirtAi: ", lane);
+		redshirt->_reset(_charIndex, team);
+		static_cast<RedshirtAi*>(redshirt->ai().get())->_lane = lane;
+		_addCharacter(redshirt, fonxus);
+	}
+	else {
+		redshirt = spawnCharacter(characterClass((team == BLUE)? SYM_BLUESHIRT: SYM_REDSHIRT),
+		                          team, fonxus);
+		redshirt->setAi<RedshirtAi>(lane);
+	}
+	gpInfo(log(), "  RedshirtAi: ", lane);
 	return redshirt;
 }
 
 
 void TextMoba::spawnRedshirts(Team team, unsigned count) {
+	unsigned lanes = laneCount();
 	for(unsigned i = 0; i < count; ++i) {
-		spawnRedshirt(team, TOP);
-		spawnRedshirt(team, BOT);
+		for(Lane lane = 0; lane < lanes; ++lane) {
+			spawnRedshirt(team, lane);
+		}
 	}
 }
 
 
-void TextMoba::killCharacter(CharacterSP character, CharacterSP attacker) {
-	bool printMessage = character->type() == HERO
-	                 || character->node() == player()->node();
-	if(attacker) {
-		dbgLogger.log(attacker->name(), " killed ", character->name(), ".");
-		if(printMessage) {
-			print(attacker->name(), " killed ", character->name(), ".");
-		}
-	}
-	else {
-		dbgLogger.log(character->debugName(), " killed.");
-		if(printMessage) {
-			print(character->name(), " killed.");
-		}
+void TextMoba::_addCharacter(const CharacterSP& character, MapNode* node) {
+	if(node) {
+		moveCharacter(character, node);
 	}
 
-	unsigned xp = xpWorth(character);
-	for(CharacterSP c: character->node()->characters()) {
+	_emit(GameEvent{ EVENT_SPAWN, nullptr, character.get(), nullptr, 0 });
+
+	_characters.emplace(character);
+	++_charIndex;
+}
+
+
+void TextMoba::killCharacter(const CharacterSP& character, Character* attacker) {
+	_emit(GameEvent{ EVENT_KILL, attacker, character.get(), nullptr, 0 });
+	if(_telemetry && !_simulating)
+		_telemetry->kill(character.get(), attacker);
+
+	unsigned xp = xpWorth(character.get());
+	for(const CharacterSP& c: character->node()->characters()) {
 		if(c->team() == character->team() || c->type() != HERO)
 			continue;
 
-		grantXp(c, xp);
+		grantXp(c.get(), xp);
 	}
 
 	if(character->type() == HERO) {
 		moveCharacter(character, fonxus(character->team()));
 
 		moveCharacter(character, nullptr);
-		// +1 because it will be decremented almost instantly.
-		character->_deathTime = _respawnTime[character->_level] + 1;
-		dbgLogger.error(character->debugName(), " death time ", character->deathTime());
+		// The hero comes back on its respawn_time-th turn after this one,
+		// including this one if it did not play yet.
+		unsigned respawnTime = _respawnTime[character->level()];
+		if(character->_lastTurn != _turn)
+			respawnTime -= 1;
+		character->_setRespawnTurn(_turn + respawnTime + 1);
+		_emit(GameEvent{ EVENT_DEATH, nullptr, character.get(), nullptr,
+		                 character->deathTime() });
 	}
 	else {
 		if(character->node()) {
-			character->node()->removeCharacter(character);
+			character->node()->removeCharacter(character.get());
 			moveCharacter(character, nullptr);
 		}
-		_characters.erase(character);
+		// Removing the character now would invalidate the iterators of
+		// nextTurn(), see _removeKilledCharacters().
+		_store->destroy(character->handle());
+		_killedCharacters.push_back(character);
 	}
 }
 
 
-void TextMoba::moveCharacter(CharacterSP character, MapNodeSP dest) {
-	if(player() && character != player() && player()->isAlive()
-	        && character->type() != BUILDING
-	        && character->node() == player()->node()) {
-		print(character->name(), " leaves the area.");
+void TextMoba::moveCharacter(CharacterHandle handle, MapNode* dest) {
+	Character* character = _store->_character[handle.index];
+	MapNode*   node      = _store->_node[handle.index];
+	lairAssert(node || !dest);
+
+	_emit(GameEvent{ EVENT_LEAVE, nullptr, character, nullptr, 0 });
+
+	CharacterSP owned;
+	if(node) {
+		owned = node->removeCharacter(character);
 	}
 
-	if(character->node()) {
-		character->node()->removeCharacter(character);
+	_store->_node [handle.index] = dest;
+	_store->_place[handle.index] = character->cClass()->defaultPlace();
+
+	_emit(GameEvent{ EVENT_ENTER, nullptr, character, nullptr, 0 });
+
+	if(dest) {
+		dest->addCharacter(std::move(owned));
 	}
+}
 
-	character->_node = dest;
-	character->_place = character->cClass()->defaultPlace();
 
-	if(player() && character != player() && player()->isAlive()
-	        && character->type() != BUILDING
-	        && character->node() == player()->node()) {
-		print(character->name(false), " enters the area.");
+void TextMoba::moveCharacter(const CharacterSP& character, MapNode* dest) {
+	if(character->node()) {
+		moveCharacter(character->handle(), dest);
+		return;
 	}
 
+	_emit(GameEvent{ EVENT_LEAVE, nullptr, character.get(), nullptr, 0 });
+
+	character->_setNode(dest);
+	character->_setPlace(character->cClass()->defaultPlace());
+
+	_emit(GameEvent{ EVENT_ENTER, nullptr, character.get(), nullptr, 0 });
+
 	if(dest) {
 		dest->addCharacter(character);
 	}
 }
 
 
-void TextMoba::placeCharacter(CharacterSP character, Place place) {
-	if(player() && player()->isAlive()
-	        && character->node() == player()->node()) {
-		print(character->name(), " moves to the ", placeName(place), " row.");
-	}
-	character->_place = place;
+void TextMoba::placeCharacter(CharacterHandle handle, Place place) {
+	Character* character = _store->_character[handle.index];
+
+	_emit(GameEvent{ EVENT_PLACE, nullptr, character, nullptr, place });
+
+	if(MapNode* node = _store->_node[handle.index])
+		node->placeCharacter(character, place);
+	else
+		_store->_place[handle.index] = place;
 }
 
 
-void TextMoba::attack(CharacterSP attacker, CharacterSP target) {
+void TextMoba::attack(Character* attacker, CharacterHandle target) {
 	unsigned damage = attacker->damage();
 
-	dbgLogger.log(attacker->debugName(), " attack ", target->debugName(),
-	              " for ", damage, " damage.");
-
-	if(attacker->node() == player()->node()) {
-		print(attacker->name(), " attack ", target->name(), " for ",
-		      damage, " damage.");
-	}
+	_emit(GameEvent{ EVENT_ATTACK, attacker, _store->_character[target.index],
+	                 nullptr, damage });
 
 	dealDamage(target, damage, attacker);
 }
 
 
-void TextMoba::dealDamage(CharacterSP target, unsigned damage, CharacterSP attacker) {
-	if(damage >= target->hp()) {
-		target->_hp = 0;
-		killCharacter(target, attacker);
+void TextMoba::dealDamage(CharacterHandle target, unsigned damage, Character* attacker) {
+	Character* character = _store->_character[target.index];
+	unsigned   hp        = _store->_hp[target.index];
+
+	if(_telemetry && !_simulating)
+		_telemetry->damage(character, std::min(damage, hp), attacker);
+
+	if(damage >= hp) {
+		_store->_hp[target.index] = 0;
+		// Killed characters are kept until the next turn, which needs a
+		// shared pointer. Only kills acquire one.
+		killCharacter(character->shared_from_this(), attacker);
 	}
 	else {
-		target->_hp -= damage;
+		_store->_hp[target.index] = hp - damage;
 	}
 }
 
 
-void TextMoba::healCharacter(CharacterSP target, unsigned amount, CharacterSP /*healer*/) {
-	if(target->isAlive()) {
-		target->_hp = std::min(target->hp() + amount, target->maxHP());
+void TextMoba::healCharacter(CharacterHandle target, unsigned amount, Character* healer) {
+	unsigned hp = _store->_hp[target.index];
+	if(hp) {
+		Character* character = _store->_character[target.index];
+		unsigned healed = std::min(hp + amount, character->maxHP());
+		if(_telemetry && !_simulating && healed > hp)
+			_telemetry->heal(character, healed - hp, healer);
+		_store->_hp[target.index] = healed;
 	}
 }
 
 
-void TextMoba::useSkillOn(SkillSP skill, const CharacterVector& targets) {
-	CharacterSP character = skill->character();
+void TextMoba::useSkillOn(const SkillSP& skill, const CharacterVector& targets) {
+	Character* character = skill->character();
 
-	if(player()->isAlive() && character->node() == player()->node()) {
-		print(character->name(), " uses ", skill->name(), "...");
-	}
+	_emit(GameEvent{ EVENT_SKILL, character, nullptr, skill.get(), 0 });
+	Telemetry* telemetry = _simulating? nullptr: _telemetry;
+	if(telemetry)
+		telemetry->setSkill(skill.get());
 
-	for(CharacterSP c: targets) {
+	for(const CharacterSP& c: targets) {
 		_useSkillOn(skill, c);
 	}
-	skill->_timeBeforeNextUse = skill->cooldown() + 1;
-}
 
+	if(telemetry)
+		telemetry->setSkill(nullptr);
+	skill->_readyTime = character->_turnsPlayed + skill->cooldown() + 1;
+}
 
-void TextMoba::_useSkillOn(SkillSP skill, CharacterSP target) {
-	CharacterSP character = skill->character();
 
-	dbgLogger.log(character->debugName(), " uses skill ", skill->id(), " lvl ", skill->_level,
-	              " on ", target->debugName());
+void TextMoba::_useSkillOn(const SkillSP& skill, const CharacterSP& target) {
+	Character* character = skill->character();
 
-	bool printMessage = player()->isAlive() && character->node() == player()->node();
+	_emit(GameEvent{ EVENT_SKILL_TARGET, character, target.get(), skill.get(), 0 });
 
-	for(const SkillModel::Effect& effect: skill->_model->effects()) {
-		SkillEffect effectType = effect.type(skill->level());
-		unsigned power = effect.power(skill->level());
+	const SkillModel::LevelStats& stats = skill->stats();
+	for(unsigned i = 0; i < stats.effectCount; ++i) {
+		SkillEffect effectType = stats.effects[i].type;
+		unsigned power = stats.effects[i].power;
 
-//		dbgLogger.info("  effect ", effectType, ": power ", power);
+//		log().info("  effect ", effectType, ": power ", power);
 
 		switch(effectType) {
 		case NO_EFFECT:
 			break;
 		case DAMAGE:
-			if(printMessage) {
-				print("  ", target->name(), " takes ", power, " damage.");
-			}
+			_emit(GameEvent{ EVENT_SKILL_DAMAGE, character, target.get(), skill.get(), power });
 
 			// Don't call attack to avoid the "x attack y" message
 			target->takeDamage(power, character);
@@ -605,26 +1087,20 @@ void TextMoba::_useSkillOn(SkillSP skill, CharacterSP target) {
 
 		case HEAL:
 			if(target->hp() != target->maxHP()) {
-				if(printMessage) {
-					print("  ", target->name(), " heal ", power, " hp.");
-				}
+				_emit(GameEvent{ EVENT_SKILL_HEAL, character, target.get(), skill.get(), power });
 
 				target->heal(power, character);
 			}
 			break;
 
 		case DOT:
-			if(printMessage) {
-				print("  ", target->name(), " will take ", power, " damage for 3 turns.");
-			}
+			_emit(GameEvent{ EVENT_SKILL_DOT, character, target.get(), skill.get(), power });
 
 			target->_buffs.push_back(Buff {3, (int) power, 'd'});
 			break;
 
 		case HOT:
-			if(printMessage) {
-				print("  ", target->name(), " regenerates ", power, " hp for 3 turns.");
-			}
+			_emit(GameEvent{ EVENT_SKILL_HOT, character, target.get(), skill.get(), power });
 
 			target->_buffs.push_back(Buff {3, (int) power, 'h'});
 			break;
@@ -633,14 +1109,14 @@ void TextMoba::_useSkillOn(SkillSP skill, CharacterSP target) {
 }
 
 
-void TextMoba::grantXp(CharacterSP character, unsigned xp) {
+void TextMoba::grantXp(Character* character, unsigned xp) {
 	unsigned nextLevelXp = nextLevel(character);
 	if(nextLevelXp == 0)
 		return;
 
-	if(character == player()) {
-		print(character->name(), " gains ", xp, " xp.");
-	}
+	_emit(GameEvent{ EVENT_XP, nullptr, character, nullptr, xp });
+	if(_telemetry && !_simulating)
+		_telemetry->xp(character, xp);
 
 	character->_xp += xp;
 	if(character->xp() < nextLevelXp)
@@ -651,12 +1127,12 @@ void TextMoba::grantXp(CharacterSP character, unsigned xp) {
 		float hpRatio = float(character->hp()) / float(character->maxHP());
 		float manaRatio = float(character->mana()) / float(character->maxMana());
 
-		character->_level += 1;
-		character->_xp    -= nextLevelXp;
-		print(character->name(), " reaches lvl ", character->level() + 1);
+		character->_setLevel(character->level() + 1);
+		character->_xp -= nextLevelXp;
+		_emit(GameEvent{ EVENT_LEVEL_UP, nullptr, character, nullptr, 0 });
 
-		character->_hp   = character->maxHP()   * hpRatio;
-		character->_mana = character->maxMana() * manaRatio;
+		character->_setHp  (character->maxHP()   * hpRatio);
+		character->_setMana(character->maxMana() * manaRatio);
 
 		if(nextLevel(character) == 0)
 			character->_xp = 0;
@@ -665,72 +1141,228 @@ void TextMoba::grantXp(CharacterSP character, unsigned xp) {
 
 
 void TextMoba::nextTurn() {
+	if(_simulating) {
+		_playTurn();
+		return;
+	}
+
+	// Planning simulates turns, which must not be profiled as parts of this
+	// one, so it is done before the turn begins.
+	uint64 planTime = 0;
+	if(_searchAiTeam != NEUTRAL) {
+		auto start = TurnProfiler::Clock::now();
+		_planAis();
+		planTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		               TurnProfiler::Clock::now() - start).count();
+	}
+
+	_profiler.beginTurn();
+	_profiler.add(PROF_SEARCH, planTime);
+	{
+		ProfileScope scope(_profiler, PROF_TURN);
+		_playTurn();
+	}
+	_profiler.endTurn();
+
+	// The last turn is recorded by gameOver().
+	if(_telemetry && !isOver())
+		_telemetry->endTurn(_turn);
+}
+
+
+void TextMoba::_planAis() {
+	for(const CharacterSP& hero: _heroes) {
+		if(hero->ai())
+			hero->ai()->plan();
+	}
+}
+
+
+void TextMoba::_playTurn() {
 	_turn += 1;
+	++_version;
+
+	_removeKilledCharacters();
 
 	auto cit  = _characters.begin();
 	auto cend = _characters.end();
 
-	_nextWaveCounter -= 1;
+	bool newWave = _turn == _nextWaveTurn;
 
 	// Blue NPC turns
-	for(; cit != cend && (*cit)->team() == BLUE; ++cit) {
-		if(*cit != player()) {
-			nextTurn(*cit);
+	{
+		ProfileScope scope(_profiler, PROF_BLUE_NPCS);
+		if(_aiPhase) {
+			auto begin = cit;
+			while(cit != cend && (*cit)->team() == BLUE)
+				++cit;
+			_playNpcsPhased(begin, cit);
+		}
+		for(; cit != cend && (*cit)->team() == BLUE; ++cit) {
+			if(*cit != player()) {
+				nextTurn(*cit);
+			}
 		}
 	}
 
 	// Blue minion waves.
-	if(_nextWaveCounter == 0) {
-		_console->writeLine("A new batch of blueshirts is leaving the fonxus.");
+	if(newWave) {
+		ProfileScope scope(_profiler, PROF_BLUE_WAVE);
+		_emit(GameEvent{ EVENT_WAVE, nullptr, nullptr, nullptr, BLUE });
 		spawnRedshirts(BLUE, _redshirtPerLane);
 	}
 
 	// Red NPC turns
-	for(; cit != cend; ++cit) {
-		if(*cit != player()) {
-			nextTurn(*cit);
+	{
+		ProfileScope scope(_profiler, PROF_RED_NPCS);
+		if(_aiPhase) {
+			_playNpcsPhased(cit, cend);
+			cit = cend;
+		}
+		for(; cit != cend; ++cit) {
+			if(*cit != player()) {
+				nextTurn(*cit);
+			}
 		}
 	}
 
 	// Red minion waves.
-	if(_nextWaveCounter == 0) {
-		_console->writeLine("A new batch of redshirts is leaving the fonxus.");
+	if(newWave) {
+		ProfileScope scope(_profiler, PROF_RED_WAVE);
+		_emit(GameEvent{ EVENT_WAVE, nullptr, nullptr, nullptr, RED });
 		spawnRedshirts(RED, _redshirtPerLane);
 	}
 
-	if(_nextWaveCounter == 0)
-		_nextWaveCounter = _waveTime;
+	if(newWave)
+		_nextWaveTurn = _turn + _waveTime;
 
 	// Win-condition
-	if(!_redFonxus->isAlive()) {
-		gameOver(true);
-		return;
+	{
+		ProfileScope scope(_profiler, PROF_WIN_CHECK);
+		if(!_redFonxus->isAlive()) {
+			gameOver(true);
+			return;
+		}
+		if(!_blueFonxus->isAlive()) {
+			gameOver(false);
+			return;
+		}
+	}
+
+	// Player turn
+	{
+		ProfileScope scope(_profiler, PROF_PLAYER);
+		nextTurn(player());
+	}
+
+	if(_console && !_fastForward && !_simulating) {
+		ProfileScope scope(_profiler, PROF_LOOK);
+		print("End of turn ", _turn);
+		execCommand("look");
+	}
+}
+
+
+unsigned TextMoba::fastForward(unsigned count, bool untilRespawn) {
+	_fastForward      = true;
+	_fastForwardStart = _turn;
+	_summary          = TurnSummary();
+
+	count = std::min(count, _maxFastForward);
+
+	unsigned turns = 0;
+	while(_fastForward && turns < count && !isOver() && _turn < _fastForwardEnd
+	      && (!untilRespawn || _player->respawnTurn())) {
+		nextTurn();
+		turns += 1;
 	}
-	if(!_blueFonxus->isAlive()) {
-		gameOver(false);
+
+	// gameOver() ends the fast-forward itself, before printing anything.
+	if(_fastForward)
+		_endFastForward();
+
+	return turns;
+}
+
+
+unsigned TextMoba::maxFastForward() const {
+	return _maxFastForward;
+}
+
+
+void TextMoba::setMaxFastForward(unsigned turns) {
+	_maxFastForward = turns;
+}
+
+
+bool TextMoba::isFastForwarding() const {
+	return _fastForward;
+}
+
+
+void TextMoba::_endFastForward() {
+	_fastForward = false;
+
+	if(!_console)
 		return;
+
+	print(_turn - _fastForwardStart, " turns later...");
+	if(_summary.deaths)
+		print("You died ", _summary.deaths, " time(s).");
+	if(_summary.xp)
+		print("You gained ", _summary.xp, " xp.");
+	if(_summary.levelUps)
+		print("You reached lvl ", _player->level() + 1, ".");
+	if(_summary.kills)
+		print("You killed ", _summary.kills, " enemies.");
+	if(_summary.heroKills[BLUE] || _summary.heroKills[RED])
+		print("Heroes killed: ", _summary.heroKills[BLUE], " blue, ",
+		      _summary.heroKills[RED], " red.");
+	if(_summary.waves)
+		print(_summary.waves, " batches of redshirts left the fonxus.");
+
+	if(!isOver()) {
+		print("End of turn ", _turn);
+		execCommand("look");
 	}
+}
 
-	// Player turn
-	nextTurn(player());
 
-	_console->writeLine(cat("End of turn ", _turn));
-	execCommand("look");
+void TextMoba::nextTurn(const CharacterSP& character) {
+	if(!_updateCharacter(character))
+		return;
+
+	// AI
+	if(character->ai()) {
+		ProfileScope scope(_profiler, (character->type() == HERO)?     PROF_HERO_AI:
+		                              (character->type() == REDSHIRT)? PROF_REDSHIRT_AI:
+		                                                               PROF_TOWER_AI);
+		character->ai()->play();
+	}
 }
 
 
-void TextMoba::nextTurn(CharacterSP character) {
-	if(character->deathTime()) {
-		character->_deathTime -= 1;
-		dbgLogger.warning(character->debugName(), " death time: ", character->deathTime());
-		if(character->deathTime() == 0) {
-			character->_hp   = character->maxHP();
-			character->_mana = character->maxMana();
+// Everything a character does at each turn before playing. Returns false if
+// it can not play this turn.
+bool TextMoba::_updateCharacter(const CharacterSP& character) {
+	character->_lastTurn = _turn;
+
+	if(character->respawnTurn()) {
+		_emit(GameEvent{ EVENT_DEAD_TURN, nullptr, character.get(), nullptr,
+		                 character->deathTime() });
+		if(_turn >= character->respawnTurn()) {
+			character->_setRespawnTurn(0);
+			character->_setHp  (character->maxHP());
+			character->_setMana(character->maxMana());
 			moveCharacter(character, fonxus(character->team()));
 		}
-		return;
+		return false;
 	}
 
+	// Killed during this turn, but not yet removed.
+	if(!character->isAlive())
+		return false;
+
 	// Fonxus regen
 	if(character->type() == BUILDING) {
 		for(SkillSP s: character->skills()) {
@@ -742,12 +1374,15 @@ void TextMoba::nextTurn(CharacterSP character) {
 	if(character->type() == HERO)
 	{
 		character->heal(2);
-		character->_mana = std::min(character->mana() + 1, character->maxMana());
+		character->_setMana(std::min(character->mana() + 1, character->maxMana()));
 	}
 
-	BuffVector nb;
-	for (Buff b: character->_buffs)
-	{
+	// Expired buffs are removed in place.
+	BuffVector& buffs = character->_buffs;
+	unsigned buffCount = 0;
+	for(unsigned i = 0; i < buffs.size(); ++i) {
+		Buff b = buffs[i];
+
 		// DOT / HOT
 		switch(b.type) {
 		case 'h':
@@ -757,84 +1392,182 @@ void TextMoba::nextTurn(CharacterSP character) {
 			character->takeDamage(b.amount);
 			break;
 		default:
-			dbgLogger.warning("Unknown buff type : '", b.type,"'.");
+			gpWarning(log(), "Unknown buff type : '", b.type,"'.");
 		}
 
 		if(--b.ticks)
-			nb.push_back(b);
+			buffs[buffCount++] = b;
 	}
-	character->_buffs.swap(nb);
+	buffs.resize(buffCount);
 
 	if(!character->isAlive())
-		return;
+		return false;
 
 	// Cooldowns
-	for(SkillSP skill: character->skills()) {
-		if(skill->timeBeforeNextUse() != 0)
-			skill->_timeBeforeNextUse -= 1;
+	character->_turnsPlayed += 1;
+
+	_profiler.add(PROF_CHARACTERS, 1);
+	return true;
+}
+
+
+void TextMoba::_playNpcsPhased(CharacterSet::const_iterator begin,
+                               CharacterSet::const_iterator end) {
+	AiPhase& phase = *_aiPhase;
+
+	phase.characters.clear();
+	for(auto it = begin; it != end; ++it) {
+		if(*it != player() && _updateCharacter(*it) && (*it)->ai())
+			phase.characters.push_back(it->get());
 	}
 
-	// AI
-	if(character->ai()) {
-		character->ai()->play();
+	// Each decision gets its own generator, seeded in character order, so
+	// random picks do not depend on the threads.
+	unsigned count = phase.characters.size();
+	phase.seeds.resize(count);
+	for(unsigned i = 0; i < count; ++i) {
+		phase.seeds[i] = _rng();
+	}
+
+	phase.actions.resize(count, AiAction::none());
+	phase.workers.run(count, [&phase](unsigned i) {
+		std::minstd_rand rng(phase.seeds[i]);
+		decisionRng = &rng;
+		phase.actions[i] = phase.characters[i]->ai()->decide();
+		decisionRng = nullptr;
+	});
+
+	for(unsigned i = 0; i < count; ++i) {
+		phase.characters[i]->ai()->apply(phase.actions[i]);
 	}
 }
 
 
-void TextMoba::restart(const lair::String& className) {
-	_turn = 0;
-	_nextWaveCounter = _firstWaveTime;
+void TextMoba::_removeKilledCharacters() {
+	for(CharacterSP& character: _killedCharacters) {
+		_characters.erase(character);
+
+		// Only recycle redshirts nobody else refers to.
+		if(character->type() == REDSHIRT && character.use_count() == 1) {
+			_redshirtPool[character->team()].push_back(std::move(character));
+		}
+	}
+	_killedCharacters.clear();
+	_store->collect();
+}
 
+
+void TextMoba::_clearCharacters() {
 	for(const auto& pair: _nodes) {
-		pair.second->_characters.clear();
+		pair.second->clearCharacters();
 	}
+	_player.reset();
+	_blueFonxus.reset();
+	_redFonxus.reset();
 	_characters.clear();
+	_killedCharacters.clear();
+	_redshirtPool[BLUE].clear();
+	_redshirtPool[RED].clear();
 	_heroes.clear();
+	_store->clear();
+}
+
+
+void TextMoba::restart(const lair::String& className) {
+	restart(className, _rng());
+}
+
+
+void TextMoba::restart(const lair::String& className, unsigned seed) {
+	if(!_gameplay) {
+		log().error("No gameplay data to start a game with.");
+		return;
+	}
+
+	// Each match reseeds the generator so it can be replayed on its own.
+	_rng.seed(seed);
+	_replay.reset(_dataHash, seed, className);
+
+	_turn = 0;
+	_nextWaveTurn = _firstWaveTime;
+	_winner = NEUTRAL;
+
+	_clearCharacters();
+
+	// Player *must* have charIndex 0. It takes the place of the first blue
+	// hero of its class, if any.
+	const GameplayBundle::HeroVector* rosters = _gameplay->_heroes;
+	SymbolId playerClass = _symbols.find(className);
+	unsigned playerHero  = rosters[BLUE].size();
+	for(unsigned i = 0; i < rosters[BLUE].size() && playerHero == rosters[BLUE].size(); ++i) {
+		if(playerClass != NO_SYMBOL && _symbols.find(rosters[BLUE][i].classId) == playerClass)
+			playerHero = i;
+	}
 
-	// Player *must* have charIndex 0
 	_charIndex = 0;
-	_player = spawnCharacter(className, BLUE, mapNode("bf"));
+	_player = spawnCharacter(className, BLUE, fonxus(BLUE));
 	_heroes.push_back(_player);
 
-	if(className != "ranger")
-		_heroes.push_back(spawnCharacter("ranger", BLUE, mapNode("bf")));
-	if(className != "warrior")
-		_heroes.push_back(spawnCharacter("warrior", BLUE, mapNode("bf")));
-	if(className != "mage")
-		_heroes.push_back(spawnCharacter("mage", BLUE, mapNode("bf")));
-
-	_heroes.push_back(spawnCharacter("ranger", RED, mapNode("rf")));
-	_heroes.push_back(spawnCharacter("warrior", RED, mapNode("rf")));
-	_heroes.push_back(spawnCharacter("mage", RED, mapNode("rf")));
+	std::vector<Lane> lanes;
+	lanes.push_back((playerHero < rosters[BLUE].size())? rosters[BLUE][playerHero].lane: 0);
+	for(unsigned team = 0; team < 2; ++team) {
+		for(unsigned i = 0; i < rosters[team].size(); ++i) {
+			if(team == BLUE && i == playerHero)
+				continue;
+			const GameplayBundle::Hero& hero = rosters[team][i];
+			CharacterSP c = spawnCharacter(hero.classId, Team(team), fonxus(Team(team)));
+			if(!c)
+				continue;
+			_heroes.push_back(c);
+			lanes.push_back(hero.lane);
+		}
+	}
 
-	for(unsigned i = 1; i < _heroes.size(); ++i) {
+	// In auto-player mode, the player is controlled by an AI like the others.
+	for(unsigned i = _autoPlayer? 0: 1; i < _heroes.size(); ++i) {
 		CharacterSP c = _heroes[i];
-		c->setAi<HeroAi>((c->className() == "ranger")? TOP: BOT);
+		if(c->team() == _searchAiTeam)
+			c->setAi<SearchHeroAi>(lanes[i]);
+		else
+			c->setAi<HeroAi>(lanes[i]);
 	}
 
 	for(const auto& pair: _nodes) {
-		MapNodeSP node = pair.second;
+		MapNode* node = pair.second.get();
 
 		if(node->fonxus().size()) {
 			Team team = (node->fonxus() == "blue")? BLUE: RED;
-			CharacterSP fonxus = spawnCharacter("fonxus", team, node);
+			CharacterSP fonxus = spawnCharacter(characterClass(SYM_FONXUS), team, node);
 			if(team == BLUE)
 				_blueFonxus = fonxus;
 			else
 				_redFonxus = fonxus;
 		}
 		if(node->tower().size()) {
-			CharacterSP tower = spawnCharacter("tower", (node->tower() == "blue")? BLUE: RED, node);
+			CharacterSP tower = spawnCharacter(characterClass(SYM_TOWER),
+			                                   (node->tower() == "blue")? BLUE: RED, node);
 			tower->setAi<TowerAi>();
 		}
 	}
 
 	// Starts the game with a description of the environement
-	execCommand("look");
+	if(_console)
+		execCommand("look");
 }
 
 
 void TextMoba::gameOver(bool win) {
+	_winner = win? BLUE: RED;
+
+	if(_simulating)
+		return;
+
+	if(_telemetry)
+		_telemetry->endMatch(_turn, _winner);
+
+	if(_fastForward)
+		_endFastForward();
+
 	print("");
 	if(win) {
 		print("CONGRATULATION ! You destroyed the enemy Fonxus.");
@@ -859,16 +1592,69 @@ void TextMoba::gameOver(bool win) {
 }
 
 
+bool TextMoba::isOver() const {
+	return _winner != NEUTRAL;
+}
+
+
+Team TextMoba::winner() const {
+	return _winner;
+}
+
+
+uint64 TextMoba::dataHash() const {
+	return _dataHash;
+}
+
+
+const Replay& TextMoba::replay() const {
+	return _replay;
+}
+
+
+bool TextMoba::playReplay(const Replay& replay, unsigned stopTurn) {
+	if(replay.dataHash() != _dataHash) {
+		log().warning("Replay recorded with different gameplay data, expect desyncs.");
+	}
+
+	_currentCommand = nullptr;
+	restart(replay.className(), replay.seed());
+
+	// Multi-turn commands must stop at stopTurn too.
+	_fastForwardEnd = stopTurn;
+
+	bool success = true;
+	for(const Replay::Command& command: replay.commands()) {
+		if(isOver() || _turn >= stopTurn)
+			break;
+
+		if(command.turn != _turn) {
+			log().error("Replay desync: \"", command.command, "\" recorded at turn ",
+			            command.turn, " but played at turn ", _turn, ".");
+			success = false;
+			break;
+		}
+
+		execInput(command.command);
+	}
+
+	_fastForwardEnd = unsigned(-1);
+	return success;
+}
+
+
 const TextMoba::TMCommandList& TextMoba::commands() const {
 	return _commands;
 }
 
 
-TMCommand* TextMoba::command(const lair::String& name) const {
-	auto it = _commandMap.find(name);
-	if(it == _commandMap.end())
-		return nullptr;
-	return it->second;
+TMCommand* TextMoba::command(StringView name) const {
+	return _commandTrie.find(name);
+}
+
+
+void TextMoba::completeCommand(const String& prefix, StringVector& completions) const {
+	_commandTrie.complete(prefix, completions);
 }
 
 
@@ -876,12 +1662,20 @@ void TextMoba::_addCommand(TMCommandSP command) {
 	_commands.emplace_back(command);
 
 	for(const String& id: command->names()) {
-		_commandMap.emplace(id, command.get());
-		dbgLogger.info("Register command \"", id, "\"");
+		_commandTrie.insert(id, command.get());
+		log().info("Register command \"", id, "\"");
 	}
 }
 
 
+// Executes a line typed by the player. Unlike execCommand, it is recorded in
+// the replay.
+bool TextMoba::execInput(const lair::String& line) {
+	_replay.addCommand(_turn, line);
+	return _execCommand(line, false);
+}
+
+
 bool TextMoba::execCommand(const lair::String& command) {
 	return _execCommand(command, true);
 }
@@ -889,37 +1683,28 @@ bool TextMoba::execCommand(const lair::String& command) {
 
 bool TextMoba::_execCommand(const String& command, bool internal) {
 	if(!internal) {
-		dbgLogger.log("Exec: ", command);
+		log().log("Exec: ", command);
 	}
 
-	StringVector args;
-
-	auto it  = command.begin();
-	auto end = command.end();
-
-	while(it != end && std::isspace(*it))
-		++it;
-
-	while(it != end) {
-		auto argBegin = it;
-		while(it != end && !std::isspace(*it))
-			++it;
-
-		args.emplace_back(String(argBegin, it));
+	// Arguments point into command, which outlives the call to exec.
+	CommandArgs args(command);
+	if(args.empty())
+		return false;
 
-		while(it != end && std::isspace(*it))
-			++it;
+	// Without gameplay data, initialize() failed and no game was started.
+	if(!_gameplay) {
+		print("No game is running.");
+		return false;
 	}
 
-	if(args.empty())
-		return false;
+	++_version;
 
 	TMCommand* tmCommand = (!internal && _currentCommand)?
 	                           _currentCommand:
 	                           this->command(args[0]);
 
 	if(!tmCommand) {
-		console()->writeLine(cat("Command \"", args[0], "\" do not exists. Type \"h\" for help."));
+		print("Command \"", args[0], "\" do not exists. Type \"h\" for help.");
 	}
 	else if(internal) {
 		tmCommand->exec(args);
@@ -935,247 +1720,146 @@ bool TextMoba::_execCommand(const String& command, bool internal) {
 }
 
 
-void TextMoba::_initialize(std::istream& in, const lair::Path& logicPath) {
-	// Cleanup
-
-	_heroes.clear();
-
-
-	// Parse ldl
+DirectionId TextMoba::_internDirection(const String& direction) {
+	return _directions.emplace(direction, _directions.size()).first->second;
+}
 
-	ErrorList errors;
-	LdlParser parser(&in, logicPath.utf8String(), &errors, LdlParser::CTX_MAP);
 
-	Variant config;
-	if(!ldlRead(parser, config)) {
-		dbgLogger.error("Failed to load gameplay data from \"",
-		                logicPath.utf8String(), "\"");
-		errors.log(dbgLogger);
+void TextMoba::_buildNavigation() {
+	// The AIs walk toward a fonxus, then follow their lane.
+	DirectionId toward[2] = {
+	    _internDirection(teamName(BLUE)),
+	    _internDirection(teamName(RED)),
+	};
+	std::vector<DirectionId> lanes;
+	for(Lane lane = 0; lane < laneCount(); ++lane) {
+		lanes.push_back(_internDirection(laneName(lane)));
 	}
-	errors.log(dbgLogger);
 
-	// Read gameplay.ldl
+	for(const auto& pair: _nodes) {
+		MapNode* node = pair.second.get();
+
+		// If an alias leads to several nodes, the first path wins.
+		node->_destinations.assign(directionCount(), nullptr);
+		for(const auto& path: node->_paths) {
+			for(const String& dir: path.second) {
+				MapNode*& dest = node->_destinations[directionId(dir)];
+				if(!dest)
+					dest = path.first;
+			}
+		}
 
-	Variant motd = config.get("motd");
-	if(motd.isString()) {
-		_console->writeLine(motd.asString());
+		for(unsigned team = 0; team < 2; ++team) {
+			MapNode* dest = node->destination(toward[team]);
+			node->_nextHop[team].resize(lanes.size());
+			for(Lane lane = 0; lane < lanes.size(); ++lane) {
+				node->_nextHop[team][lane] = dest? dest: node->destination(lanes[lane]);
+			}
+		}
 	}
+}
 
-	_firstWaveTime   = getInt(config, "first_wave_time");
-	_waveTime        = getInt(config, "wave_time");
-	_redshirtPerLane = getInt(config, "redshirt_per_lane");
-
-	_heroNextLevel   = getClassStats(config, "hero_next_level");
-	_heroXpWorth     = getClassStats(config, "hero_xp_worth");
-	_redshirtXpWorth = getClassStats(config, "redshirt_xp_worth");
-	_towerXpWorth    = getClassStats(config, "tower_xp_worth");
-
-	_respawnTime = getClassStats(config, "respawn_time");
 
-	const Variant& nodes = config.get("nodes");
-	if(nodes.isVarMap()) {
-		for(const auto& pair: nodes.asVarMap()) {
-			const String& id = pair.first;
-			const Variant& obj = pair.second;
+bool TextMoba::initialize(std::istream& in, const lair::Path& logicPath) {
+	std::ostringstream buffer;
+	buffer << in.rdbuf();
 
-			MapNodeSP node = std::make_shared<MapNode>();
+	std::shared_ptr<GameplayBundle> bundle = std::make_shared<GameplayBundle>();
+	if(!bundle->load(buffer.str(), logicPath, log()))
+		return false;
+	return initialize(bundle);
+}
 
-			node->_id = id;
 
-			const Variant& nameVar = obj.get("name");
-			if(nameVar.isString())
-				node->_name = nameVar.asString();
-			else
-				dbgLogger.error("Node without name");
+bool TextMoba::initialize(const GameplayBundleCSP& bundle) {
+	if(!bundle || !bundle->validate(log()))
+		return false;
 
-			node->_images = getStringList(obj, "images");
-			for(const String& img: node->_images) {
-				_mainState->loader()->load<ImageLoader>(img);
-			}
+	// Cleanup
 
-			const Variant& posVar = obj.get("position");
-			if(posVar.isVarList() && posVar.asVarList().size() == 2) {
-				const VarList& pos = posVar.asVarList();
-				node->_pos = Vector2(pos[0].asFloat(), pos[1].asFloat());
-			}
-			else
-				dbgLogger.error("Node without position");
+	_heroes.clear();
 
-			node->_tower  = getString(obj, "tower");
-			node->_fonxus = getString(obj, "fonxus");
+	_gameplay = bundle;
+	_dataHash = bundle->_dataHash;
 
-			_nodes.emplace(node->id(), node);
-		}
-	}
-	else {
-		dbgLogger.error("Expected \"nodes\" VarMap.");
-	}
-
-	const Variant& paths = config.get("paths");
-	if(paths.isVarList()) {
-		for(const Variant& path: paths.asVarList()) {
-			const Variant& fromVar     = path.get("from");
-			const Variant& toVar       = path.get("to");
-			const Variant& fromDirsVar = path.get("from_dirs");
-			const Variant& toDirsVar   = path.get("to_dirs");
-			if(fromVar.isString() && toVar.isString() &&
-			        fromDirsVar.isVarList() && toDirsVar.isVarList()) {
-				MapNodeSP from = mapNode(fromVar.asString());
-				MapNodeSP to   = mapNode(toVar.asString());
-
-				StringVector& fromDirs =
-				        from->_paths.emplace(to.get(),   StringVector()).first->second;
-				StringVector& toDirs =
-				        to  ->_paths.emplace(from.get(), StringVector()).first->second;
-
-				for(const Variant& dirVar: fromDirsVar.asVarList()) {
-					if(dirVar.isString()) {
-						fromDirs.emplace_back(dirVar.asString());
-					}
-				}
-
-				for(const Variant& dirVar: toDirsVar.asVarList()) {
-					if(dirVar.isString()) {
-						toDirs.emplace_back(dirVar.asString());
-					}
-				}
-			}
-			else {
-				dbgLogger.error("Invalid path.");
-			}
-		}
-	}
-	else {
-		dbgLogger.error("Expected \"paths\" VarList.");
+	if(bundle->_motd.size()) {
+		print(bundle->_motd);
 	}
 
-	const Variant& classes = config.get("classes");
-	if(classes.isVarMap()) {
-		for(const auto& pair: classes.asVarMap()) {
-			const String& id = pair.first;
-			const Variant& obj = pair.second;
+	_firstWaveTime   = bundle->_firstWaveTime;
+	_waveTime        = bundle->_waveTime;
+	_redshirtPerLane = bundle->_redshirtPerLane;
 
-			CharacterClassSP cClass = std::make_shared<CharacterClass>();
+	_heroNextLevel   = bundle->_heroNextLevel;
+	_heroXpWorth     = bundle->_heroXpWorth;
+	_redshirtXpWorth = bundle->_redshirtXpWorth;
+	_towerXpWorth    = bundle->_towerXpWorth;
 
-			cClass->_id        = id;
+	_respawnTime = bundle->_respawnTime;
 
-			String type = getString(obj, "type");
-			if(type == "hero")
-				cClass->_type = HERO;
-			else if(type == "redshirt")
-				cClass->_type = REDSHIRT;
-			else if(type == "building")
-				cClass->_type = BUILDING;
-			else {
-				dbgLogger.error("Unexpected CharType: \"", type, "\"");
-				cClass->_type = BUILDING;
-			}
+	_symbols = bundle->_symbols;
 
-			cClass->_name      = getString(obj, "name", "<fixme_no_name>");
-			cClass->_sortIndex = getInt(obj, "sort_index", 9999);
+	// Nodes hold the characters of the game, so each game has its own.
+	for(const GameplayBundle::Node& def: bundle->_nodes) {
+		MapNodeSP node = std::make_shared<MapNode>();
 
-			String defaultPlace = getString(obj, "default_place", "back");
-			cClass->_defaultPlace = (defaultPlace == "back")? BACK: FRONT;
+		node->_id     = def.id;
+		node->_symbol = _symbols.find(def.id);
+		node->_name   = def.name;
+		node->_images = def.images;
+		node->_pos    = def.pos;
+		node->_tower  = def.tower;
+		node->_fonxus = def.fonxus;
 
-			cClass->_maxHP     = getClassStats(obj, "max_hp");
-			cClass->_maxMana   = getClassStats(obj, "max_mana");
-			cClass->_damage    = getClassStats(obj, "damage");
-			cClass->_range     = getClassStats(obj, "range");
-			cClass->_skills    = getStringList(obj, "skills");
+		_nodes.emplace(node->id(), node);
+		setBySymbol(_nodeBySymbol, node->symbol(), node.get());
+	}
 
-			cClass->_image     = getString(obj, "image");
-			if(cClass->_image.size()) {
-				_mainState->loader()->load<ImageLoader>(cClass->_image);
-			}
+	_fonxusNodes[BLUE] = mapNode(SYM_BLUE_FONXUS_NODE);
+	_fonxusNodes[RED]  = mapNode(SYM_RED_FONXUS_NODE);
 
-			_classes.emplace(cClass->id(), cClass);
+	for(const GameplayBundle::NodePath& path: bundle->_paths) {
+		MapNode* from = mapNode(path.from);
+		MapNode* to   = mapNode(path.to);
+		if(!from || !to) {
+			log().error("Invalid path.");
+			continue;
 		}
-	}
-	else {
-		dbgLogger.error("Expected \"classes\" VarMap.");
-	}
-
-	const Variant& skills = config.get("skills");
-	if(skills.isVarMap()) {
-		for(const auto& pair: skills.asVarMap()) {
-			const String& id = pair.first;
-			const Variant& obj = pair.second;
-
-			SkillModelSP skill = std::make_shared<SkillModel>();
-
-			skill->_id        = id;
-			skill->_name      = getString(obj, "name", "<fixme_no_name>");
-			skill->_desc      = getString(obj, "desc");
-
-			const Variant& effectsVar = obj.get("effects");
-			if(effectsVar.isVarList()) {
-				for(const Variant& effectVar: effectsVar.asVarList()) {
-					SkillModel::Effect effect;
-
-					const Variant& typeVar = effectVar.get("type");
-					if(typeVar.isString())
-						effect._type = IntVector(2, parseSkillEffect(typeVar.asString()));
-					else if(typeVar.isVarList()){
-						const VarList& list = typeVar.asVarList();
-						if(list.size() == 2) {
-							for(const Variant& v: list) {
-								effect._type.push_back(parseSkillEffect(v.asString()));
-							}
-						}
-						else
-							dbgLogger.error("Skill effect type must be of size 2");
-					}
-					else
-						dbgLogger.error("Invalid skill effect type");
-
-					effect._power = getIntList(effectVar, "power", 2, 0);
-
-					skill->_effects.push_back(effect);
-				}
-			}
-			else
-				dbgLogger.error("Invalid skill effect");
 
-			const Variant& targetVar = obj.get("target");
-			skill->_target = IntVector(2, NO_TARGET);
-			if(targetVar.isString()) {
-				skill->_target = IntVector(2, parseSkillTarget(targetVar.asString()));
-			}
-			else if(targetVar.isVarList()) {
-				const VarList& list = targetVar.asVarList();
-				unsigned count = list.size();
-				if(count == 2) {
-					for(unsigned i = 0; i < count; ++i) {
-						skill->_target[i] = parseSkillTarget(list[i].asString());
-					}
-				}
-				else {
-					dbgLogger.error("Skill target array must contain exactly 2 values");
-				}
-			}
-			else {
-				dbgLogger.error("Invalid skill target.");
-			}
+		StringVector& fromDirs =
+		        from->_paths.emplace(to,   StringVector()).first->second;
+		StringVector& toDirs =
+		        to  ->_paths.emplace(from, StringVector()).first->second;
 
-			skill->_range    = getIntList(obj, "range", 2, 3);
-			skill->_cooldown = getIntList(obj, "cooldown", 2, 0);
-			skill->_manaCost = getIntList(obj, "mana_cost", 2, 99999);
+		for(const String& dir: path.fromDirs) {
+			fromDirs.emplace_back(dir);
+			_internDirection(dir);
+		}
 
-			_skillModels.emplace(skill->id(), skill);
+		for(const String& dir: path.toDirs) {
+			toDirs.emplace_back(dir);
+			_internDirection(dir);
 		}
 	}
-	else {
-		dbgLogger.error("Expected \"skills\" VarMap.");
-	}
 
+	_buildNavigation();
 
-	const Variant& infoVar = config.get("info");
-	if(infoVar.isVarMap()) {
-		for(const auto& pair: infoVar.asVarMap()) {
-			_infoTopics.emplace(pair.first, pair.second.asString());
-		}
+	// Classes and skill models are never modified, all games share them.
+	for(const CharacterClassSP& cClass: bundle->_classes) {
+		_classes.emplace(cClass->id(), cClass);
+		setBySymbol(_classBySymbol, cClass->symbol(), cClass);
+	}
+
+	for(const SkillModelSP& skill: bundle->_skillModels) {
+		_skillModels.emplace(skill->id(), skill);
+		setBySymbol(_skillModelBySymbol, skill->symbol(), skill);
 	}
 
+	_infoTopics = bundle->_infos;
+
 	// Setup
-	_execCommand("restart");
+	if(_console)
+		_execCommand("restart");
+
+	return true;
 }
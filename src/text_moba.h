@@ -24,17 +24,24 @@
 
 
 #include <utility>
+#include <memory>
+#include <functional>
 #include <unordered_map>
 #include <set>
+#include <random>
 
 #include <lair/core/lair.h>
+#include <lair/core/log.h>
 #include <lair/core/path.h>
 #include <lair/core/parse.h>
 
+#include "command_trie.h"
 #include "console.h"
+#include "replay.h"
+#include "symbol_table.h"
+#include "turn_profiler.h"
 
 
-class MainState;
 class Console;
 
 
@@ -49,10 +56,9 @@ enum Place {
 	FRONT,
 };
 
-enum Lane {
-	TOP,
-	BOT,
-};
+// Index of a lane in the lanes of the gameplay data, "top" then "bot" on
+// the regular map. See TextMoba::laneName().
+typedef unsigned Lane;
 
 enum CharType {
 	HERO,
@@ -69,6 +75,14 @@ class Skill;
 class Ai;
 class TMCommand;
 class TextMoba;
+class CharacterStore;
+class GameSnapshot;
+class Telemetry;
+class MatchSave;
+class GameplayBundle;
+struct CharacterHandle;
+struct AiPhase;
+struct GameEvent;
 
 typedef std::shared_ptr<MapNode>         MapNodeSP;
 typedef std::weak_ptr<MapNode>           MapNodeWP;
@@ -80,6 +94,9 @@ typedef std::shared_ptr<SkillModel>      SkillModelSP;
 typedef std::shared_ptr<Skill>           SkillSP;
 typedef std::shared_ptr<Ai>              AiSP;
 typedef std::shared_ptr<TMCommand>       TMCommandSP;
+typedef std::shared_ptr<const GameplayBundle> GameplayBundleCSP;
+
+typedef std::function<void(const GameEvent&)> GameEventListener;
 
 
 typedef std::vector<int>          IntVector;
@@ -87,9 +104,18 @@ typedef std::vector<lair::String> StringVector;
 
 typedef std::unordered_map<lair::String, lair::String> StringMap;
 
+// Direction aliases of the map paths ("red", "top", ...) are interned to
+// small integers at load time, see TextMoba::directionId().
+typedef unsigned DirectionId;
+const DirectionId NO_DIRECTION = DirectionId(-1);
+
 
+// Raw pointers can be compared to shared ones, so nodes can find a
+// character without acquiring a shared pointer to it.
 struct CharacterOrder {
+	bool operator()(const Character* c0, const Character* c1) const;
 	bool operator()(const CharacterSP& c0, const CharacterSP& c1) const;
+	bool operator()(const CharacterSP& c0, const Character* c1) const;
 };
 
 typedef std::vector<CharacterSP> CharacterVector;
@@ -98,9 +124,33 @@ typedef std::set<CharacterSP, CharacterOrder> CharacterSet;
 typedef std::vector<SkillSP> SkillVector;
 
 
+// What happened to the player during TextMoba::fastForward(), printed as a
+// few lines instead of the messages of every turn.
+struct TurnSummary {
+	unsigned xp;
+	unsigned levelUps;
+	unsigned kills;
+	unsigned deaths;
+	unsigned heroKills[2];
+	unsigned waves;
+};
+
+
+// Settings of the heroes controlled by a SearchHeroAi, see
+// TextMoba::setSearchAi().
+struct SearchAiConfig {
+	// Turns simulated after each candidate action.
+	unsigned depth    = 8;
+	// Simulations of each candidate action, each with its own seed.
+	unsigned rollouts = 2;
+	// Time each hero may spend planning per turn, in microseconds, or 0 for
+	// no limit. Matches are no longer reproducible when it is reached.
+	unsigned budget   = 2000;
+};
+
+
 const lair::String& teamName(Team team);
 const lair::String& placeName(Place place);
-const lair::String& laneName(Lane lane);
 const lair::String& charTypeName(CharType charType);
 
 Team enemyTeam(Team team);
@@ -114,60 +164,188 @@ public:
 	typedef std::vector<TMCommandSP> TMCommandList;
 
 public:
-	TextMoba(MainState* mainState, Console* console);
-
-	void initialize(const lair::Path& logicPath);
+	TextMoba(Console* console = nullptr);
+	~TextMoba();
+
+	// Return false, leaving the game as it was, if the gameplay data can not
+	// be loaded or fails GameplayBundle::validate(). No game can be played
+	// before a successful call.
+	bool initialize(const lair::Path& logicPath);
+	bool initialize(std::istream& in, const lair::Path& logicPath);
+	// Games initialized from the same bundle share its classes and skill
+	// models, see GameplayBundle.
+	bool initialize(const GameplayBundleCSP& bundle);
 
-	MainState* mainState();
 	Console* console();
 
+	lair::Logger& log();
+	void setLogger(lair::Logger* logger);
+
+	// Game events are sent to the listeners, and logged if logEvents() is
+	// set. Without a console, listener or event logging, nothing formats
+	// them.
+	void addEventListener(const GameEventListener& listener);
+	bool logEvents() const;
+	void setLogEvents(bool logEvents);
+	void _emit(const GameEvent& event);
+
+	void seed(unsigned seed);
+	unsigned random(unsigned count);
+
+	bool autoPlayer() const;
+	void setAutoPlayer(bool autoPlayer);
+
+	// In phased mode, the AIs of a team first decide what they do from the
+	// state of the game at the beginning of their phase, on threadCount
+	// threads, then their actions are applied in character order. Results
+	// differ from the default mode, where each AI sees what the previous
+	// ones did, but they do not depend on the number of threads.
+	bool phasedAi() const;
+	unsigned aiThreadCount() const;
+	void setPhasedAi(bool phasedAi, unsigned threadCount = 1);
+
+	// Heroes of team (none if NEUTRAL, the default) get a SearchHeroAi at
+	// the next restart, except the player when it is not automatic.
+	Team searchAiTeam() const;
+	const SearchAiConfig& searchAiConfig() const;
+	void setSearchAi(Team team, const SearchAiConfig& config = SearchAiConfig());
+
+	// Copies the state of the game into snapshot, or brings the game back to
+	// the state saved in snapshot. Meant to try things during a match: the
+	// snapshot must come from the current match of this TextMoba.
+	void saveSnapshot(GameSnapshot& snapshot) const;
+	void restoreSnapshot(const GameSnapshot& snapshot);
+
+	// Copies the complete state of the match into save, or replaces the
+	// current match by the one in save, which may come from another game
+	// with the same gameplay data. Matches should be saved between turns.
+	// Characters get the AIs they would get from restart(), with their saved
+	// state. Returns false, leaving the game untouched, if save was made
+	// with other gameplay data or any of its fields is out of range.
+	void saveMatch(MatchSave& save) const;
+	bool loadMatch(const MatchSave& save);
+
+	// While simulating, turns do not emit events, print nor plan, and the
+	// game does not restart when it is over.
+	bool isSimulating() const;
+	void setSimulating(bool simulating);
+
+	// Incremented by each turn and command, i.e. each time the game state
+	// may have changed.
+	unsigned version() const;
+
+	// Enabled by default when there is a console, see the perf command.
+	TurnProfiler& profiler();
+
+	// Statistics of the match are sent to telemetry if set. It is not owned
+	// and simulated turns are not counted.
+	Telemetry* telemetry() const;
+	void setTelemetry(Telemetry* telemetry);
+
 	unsigned heroNextLevel(unsigned level) const;
 	unsigned heroXpWorth(unsigned level) const;
 	unsigned redshirtXpWorth(unsigned level) const;
 	unsigned towerXpWorth(unsigned level) const;
 
-	unsigned nextLevel(CharacterSP character) const;
-	unsigned xpWorth(CharacterSP character) const;
+	unsigned nextLevel(const Character* character) const;
+	unsigned xpWorth(const Character* character) const;
+
+	// Ids are resolved to symbols when the data is loaded, the versions
+	// taking a string are for the data and the commands.
+	const SymbolTable& symbols() const;
 
-	MapNodeSP mapNode(const lair::String& id);
-	MapNodeSP fonxus(Team team);
+	MapNode* mapNode(const lair::String& id);
+	MapNode* mapNode(SymbolId symbol) const;
+	MapNode* fonxus(Team team) const;
+	DirectionId directionId(const lair::String& direction) const;
+	unsigned directionCount() const;
+	unsigned laneCount() const;
+	const lair::String& laneName(Lane lane) const;
 	CharacterClassSP characterClass(const lair::String& id);
+	CharacterClassSP characterClass(SymbolId symbol) const;
 	const CharacterSet& characters() const;
-	CharacterSP player();
+	const CharacterSP& player() const;
+	Character* character(CharacterHandle handle) const;
+	CharacterStore& characterStore();
+	const CharacterStore& characterStore() const;
 	SkillModelSP skillModel(const lair::String id);
+	SkillModelSP skillModel(SymbolId symbol) const;
 
 	const StringMap& infos() const;
 	const lair::String* infos(const lair::String& topic);
 
+	StringVector images() const;
+
 	CharacterSP spawnCharacter(const lair::String& className, Team team,
-	                           MapNodeSP node = MapNodeSP());
+	                           MapNode* node = nullptr);
+	CharacterSP spawnCharacter(const CharacterClassSP& cClass, Team team,
+	                           MapNode* node = nullptr);
 	CharacterSP spawnRedshirt(Team team, Lane lane);
+	// Spawns count redshirts in each lane.
 	void spawnRedshirts(Team team, unsigned count);
+	void _addCharacter(const CharacterSP& character, MapNode* node);
 
-	void killCharacter(CharacterSP character, CharacterSP attacker = nullptr);
+	void killCharacter(const CharacterSP& character, Character* attacker = nullptr);
 
-	void moveCharacter(CharacterSP character, MapNodeSP dest);
-	void placeCharacter(CharacterSP character, Place place);
+	// Rules take handles and work on the CharacterStore arrays. A character
+	// on the map is moved with the shared pointer its node holds, one off
+	// the map needs the overload taking its own.
+	void moveCharacter(CharacterHandle handle, MapNode* dest);
+	void moveCharacter(const CharacterSP& character, MapNode* dest);
+	void placeCharacter(CharacterHandle handle, Place place);
 
-	void attack(CharacterSP attacker, CharacterSP target);
-	void dealDamage(CharacterSP target, unsigned damage,
-	                CharacterSP attacker = nullptr);
-	void healCharacter(CharacterSP target, unsigned amount,
-	                   CharacterSP healer = nullptr);
+	void attack(Character* attacker, CharacterHandle target);
+	void dealDamage(CharacterHandle target, unsigned damage,
+	                Character* attacker = nullptr);
+	void healCharacter(CharacterHandle target, unsigned amount,
+	                   Character* healer = nullptr);
 
-	void useSkillOn(SkillSP skill, const CharacterVector& targets);
-	void _useSkillOn(SkillSP skill, CharacterSP target);
+	void useSkillOn(const SkillSP& skill, const CharacterVector& targets);
+	void _useSkillOn(const SkillSP& skill, const CharacterSP& target);
 
-	void grantXp(CharacterSP character, unsigned xp);
+	void grantXp(Character* character, unsigned xp);
 
 	void nextTurn();
-	void nextTurn(CharacterSP character);
+	void _planAis();
+	void _playTurn();
+	void nextTurn(const CharacterSP& character);
+	bool _updateCharacter(const CharacterSP& character);
+	void _playNpcsPhased(CharacterSet::const_iterator begin,
+	                     CharacterSet::const_iterator end);
+
+	// Plays count turns in a row, or stops earlier when the player respawns
+	// if untilRespawn is set, or when the game is over. Turns are not
+	// printed, a summary is printed at the end instead. Returns the number
+	// of turns played.
+	unsigned fastForward(unsigned count, bool untilRespawn = false);
+	// Fast-forwards play at most maxFastForward turns at once (default: no
+	// limit), so a single command can not keep a server thread busy.
+	unsigned maxFastForward() const;
+	void setMaxFastForward(unsigned turns);
+	bool isFastForwarding() const;
+	void _endFastForward();
+	void _removeKilledCharacters();
+
+	DirectionId _internDirection(const lair::String& direction);
+	void _buildNavigation();
+
+	void _clearCharacters();
 
 	void restart(const lair::String& className);
+	void restart(const lair::String& className, unsigned seed);
 	void gameOver(bool win);
 
+	bool isOver() const;
+	Team winner() const;
+
+	lair::uint64 dataHash() const;
+	const Replay& replay() const;
+	bool playReplay(const Replay& replay, unsigned stopTurn = unsigned(-1));
+
 	const TMCommandList& commands() const;
-	TMCommand* command(const lair::String& name) const;
+	// Accepts any unambiguous prefix of a command name.
+	TMCommand* command(StringView name) const;
+	void completeCommand(const lair::String& prefix, StringVector& completions) const;
 
 	void _addCommand(TMCommandSP command);
 
@@ -176,37 +354,77 @@ public:
 		_addCommand(std::make_shared<Cmd>(this));
 	}
 
+	bool execInput(const lair::String& line);
 	bool execCommand(const lair::String& command);
 	bool _execCommand(const lair::String& command, bool internal = false);
 
 	template<typename... Args>
 	inline void print(Args&&... args) {
-		console()->writeLine(lair::cat(std::forward<Args>(args)...));
+		if(_console && !_simulating)
+			_console->writeLine(lair::cat(std::forward<Args>(args)...));
 	}
 
 private:
 	typedef std::unordered_map<lair::String, MapNodeSP>        NodeMap;
-	typedef std::unordered_map<lair::String, TMCommand*>       TMCommandMap;
+	typedef std::unordered_map<lair::String, DirectionId>      DirectionMap;
 	typedef std::unordered_map<lair::String, CharacterClassSP> ClassMap;
 	typedef std::unordered_map<lair::String, SkillModelSP>     SkillModelMap;
 
 private:
-	void _initialize(std::istream& in, const lair::Path& logicPath);
-
-private:
-	MainState*  _mainState;
-	Console*    _console;
+	Console*      _console;
+	lair::Logger* _logger;
+	std::mt19937  _rng;
+	bool          _autoPlayer;
+	bool          _logEvents;
+	unsigned      _version;
+	TurnProfiler  _profiler;
+	Telemetry*    _telemetry;
+
+	bool          _simulating;
+	Team          _searchAiTeam;
+	SearchAiConfig _searchAiConfig;
+
+	bool          _fastForward;
+	unsigned      _fastForwardStart;
+	// Fast-forwards never play past this turn, so replays can stop in the
+	// middle of a "wait N".
+	unsigned      _fastForwardEnd;
+	unsigned      _maxFastForward;
+	TurnSummary   _summary;
+
+	std::vector<GameEventListener> _eventListeners;
 
 	TMCommandList _commands;
-	TMCommandMap  _commandMap;
+	CommandTrie   _commandTrie;
 	TMCommand*    _currentCommand;
 
 	NodeMap       _nodes;
+	DirectionMap  _directions;
 	ClassMap      _classes;
 	SkillModelMap _skillModels;
 
+	// Indexed by symbol, null for the symbols of other kinds of objects.
+	SymbolTable   _symbols;
+	std::vector<MapNode*>         _nodeBySymbol;
+	std::vector<CharacterClassSP> _classBySymbol;
+	std::vector<SkillModelSP>     _skillModelBySymbol;
+	MapNode*      _fonxusNodes[2];
+
+	GameplayBundleCSP _gameplay;
+	lair::uint64 _dataHash;
+	Replay       _replay;
+
+	std::unique_ptr<CharacterStore> _store;
+	// Only set in phased mode.
+	std::unique_ptr<AiPhase>        _aiPhase;
+
 	unsigned     _charIndex;
 	CharacterSet _characters;
+	// Killed characters are removed from _characters at the beginning of the
+	// next turn, so they stay valid until the end of the current one.
+	CharacterVector _killedCharacters;
+	// Removed redshirts, by team, waiting to be reused by spawnRedshirt().
+	CharacterVector _redshirtPool[2];
 	CharacterSP  _player;
 	CharacterSP  _blueFonxus;
 	CharacterSP  _redFonxus;
@@ -224,7 +442,8 @@ public:
 	IntVector _respawnTime;
 
 	unsigned _turn;
-	unsigned _nextWaveCounter;
+	unsigned _nextWaveTurn;
+	Team     _winner;
 
 	CharacterVector _heroes;
 
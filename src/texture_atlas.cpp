@@ -0,0 +1,113 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+
+#include <lair/core/parse.h>
+
+#include "texture_atlas.h"
+
+
+using namespace lair;
+
+
+TextureAtlas::TextureAtlas()
+	: _tileGrid(1, 1) {
+}
+
+
+void TextureAtlas::clear() {
+	_texture = Path();
+	_tileGrid = Vector2i(1, 1);
+	_images.clear();
+}
+
+
+bool TextureAtlas::load(const Path& realPath, const Path& logicPath, Logger& log) {
+	clear();
+
+	Path::IStream in(realPath.native().c_str());
+	if(!in.good()) {
+		log.error("Unable to read \"", logicPath, "\".");
+		return false;
+	}
+
+	ErrorList errors;
+	LdlParser parser(&in, logicPath.utf8String(), &errors, LdlParser::CTX_MAP);
+
+	Variant atlas;
+	bool success = ldlRead(parser, atlas);
+	errors.log(log);
+	if(!success)
+		return false;
+
+	const Variant& texture = atlas.get("texture");
+	const Variant& grid    = atlas.get("tile_grid");
+	const Variant& tiles   = atlas.get("tiles");
+	if(!texture.isString() || !grid.isVarList() || grid.asVarList().size() != 2
+	|| !grid.asVarList()[0].isInt() || !grid.asVarList()[1].isInt() || !tiles.isVarList()) {
+		log.error(logicPath, ": expected texture, tile_grid and tiles.");
+		return false;
+	}
+
+	_texture  = texture.asString();
+	_tileGrid = Vector2i(grid.asVarList()[0].asInt(), grid.asVarList()[1].asInt());
+	for(const Variant& tile: tiles.asVarList()) {
+		if(tile.isString())
+			_images.emplace_back(tile.asString());
+		else
+			log.error(logicPath, ": tiles must be image names.");
+	}
+
+	if(int(_images.size()) > _tileGrid.prod()) {
+		log.error(logicPath, ": ", _images.size(), " tiles do not fit in the tile grid.");
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+const Path& TextureAtlas::texture() const {
+	return _texture;
+}
+
+
+const Vector2i& TextureAtlas::tileGrid() const {
+	return _tileGrid;
+}
+
+
+const TextureAtlas::PathVector& TextureAtlas::images() const {
+	return _images;
+}
+
+
+bool TextureAtlas::contains(const Path& image) const {
+	return tileIndex(image) >= 0;
+}
+
+
+int TextureAtlas::tileIndex(const Path& image) const {
+	auto it = std::find(_images.begin(), _images.end(), image);
+	return (it != _images.end())? int(it - _images.begin()): -1;
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_TEXTURE_ATLAS_H_
+#define LD41_TEXTURE_ATLAS_H_
+
+
+#include <vector>
+
+#include <lair/core/lair.h>
+#include <lair/core/log.h>
+#include <lair/core/path.h>
+
+
+// Images packed in a grid by tools/build_atlas.py. Sprites using the atlas
+// texture and its tile grid pick an image with setTileIndex(), so they are
+// drawn with a single texture bind instead of one per image.
+class TextureAtlas {
+public:
+	typedef std::vector<lair::Path> PathVector;
+
+public:
+	TextureAtlas();
+
+	void clear();
+	bool load(const lair::Path& realPath, const lair::Path& logicPath,
+	          lair::Logger& log = lair::dbgLogger);
+
+	const lair::Path& texture() const;
+	const lair::Vector2i& tileGrid() const;
+	const PathVector& images() const;
+
+	bool contains(const lair::Path& image) const;
+	// Returns -1 if image is not in the atlas.
+	int tileIndex(const lair::Path& image) const;
+
+protected:
+	lair::Path     _texture;
+	lair::Vector2i _tileGrid;
+	PathVector     _images;
+};
+
+
+#endif
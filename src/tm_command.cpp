@@ -19,6 +19,8 @@
  */
 
 
+#include <cctype>
+
 #include <lair/core/log.h>
 
 #include "tm_command.h"
@@ -27,6 +29,49 @@
 using namespace lair;
 
 
+CommandArgs::CommandArgs()
+    : _size(0)
+{
+}
+
+
+CommandArgs::CommandArgs(StringView line)
+    : _size(0)
+{
+	parse(line);
+}
+
+
+void CommandArgs::parse(StringView line) {
+	_size = 0;
+
+	auto isSpace = [](char c) { return std::isspace((unsigned char)c); };
+	auto it  = line.begin();
+	auto end = line.end();
+
+	while(it != end && isSpace(*it))
+		++it;
+
+	while(it != end) {
+		auto argBegin = it;
+		if(_size == MAX_ARGS - 1) {
+			it = end;
+			while(isSpace(*(it - 1)))
+				--it;
+		}
+		else {
+			while(it != end && !isSpace(*it))
+				++it;
+		}
+
+		_args[_size++] = StringView(argBegin, it - argBegin);
+
+		while(it != end && isSpace(*it))
+			++it;
+	}
+}
+
+
 TMCommand::TMCommand(TextMoba* textMoba, bool hidden)
     : _textMoba(textMoba)
     , _hidden(hidden)
@@ -47,11 +92,16 @@ const lair::String& TMCommand::desc() const {
 }
 
 
+bool TMCommand::hidden() const {
+	return _hidden;
+}
+
+
 TextMoba* TMCommand::tm() {
 	return _textMoba;
 }
 
 
-CharacterSP TMCommand::player() {
+const CharacterSP& TMCommand::player() const {
 	return _textMoba->player();
 }
@@ -24,6 +24,33 @@
 
 
 #include "text_moba.h"
+#include "string_view.h"
+
+
+// The words of a command line, as views into the line: they are only valid
+// as long as the line is. Parsing does not allocate; words past MAX_ARGS - 1
+// are kept together in the last argument.
+class CommandArgs {
+public:
+	static const unsigned MAX_ARGS = 8;
+
+public:
+	CommandArgs();
+	explicit CommandArgs(StringView line);
+
+	void parse(StringView line);
+
+	inline unsigned size() const { return _size; }
+	inline bool empty() const { return _size == 0; }
+	inline const StringView& operator[](unsigned i) const { return _args[i]; }
+
+	inline const StringView* begin() const { return _args; }
+	inline const StringView* end() const { return _args + _size; }
+
+private:
+	StringView _args[MAX_ARGS];
+	unsigned   _size;
+};
 
 
 class TMCommand {
@@ -33,16 +60,18 @@ public:
 
 	const StringVector& names() const;
 	const lair::String& desc() const;
+	// Hidden commands are not completed.
+	bool hidden() const;
 
-	virtual bool exec(const StringVector& args) = 0;
+	virtual bool exec(const CommandArgs& args) = 0;
 
 	template<typename... Args>
 	inline void print(Args&&... args) const {
-		_textMoba->console()->writeLine(lair::cat(std::forward<Args>(args)...));
+		_textMoba->print(std::forward<Args>(args)...);
 	}
 
 	TextMoba* tm();
-	CharacterSP player();
+	const CharacterSP& player() const;
 
 protected:
 	TextMoba*    _textMoba;
@@ -31,17 +31,17 @@
 using namespace lair;
 
 
-TowerAi::TowerAi(CharacterSP character)
+TowerAi::TowerAi(Character* character)
     : Ai(character)
 {
 }
 
 
-void TowerAi::play() {
-	CharacterSP c = character();
+AiAction TowerAi::decide() {
+	Character* c = character();
 
-	if(!c || !c->isAlive())
-		return;
+	if(!c->isAlive())
+		return AiAction::none();
 
 //	dbgLogger.log(c->debugName(), " turn:");
 
@@ -49,7 +49,7 @@ void TowerAi::play() {
 
 	CharacterGroups groups = c->node()->characterGroups();
 	if(groups.count(enemy)) {
-		CharacterSP target = _target.lock();
+		Character* target = this->target();
 
 		if(!target || !target->isAlive() ||
 		        groups.distanceBetween(c, target) > c->range()) {
@@ -57,9 +57,11 @@ void TowerAi::play() {
 		}
 
 		if(target) {
-			_target = target;
+			_target = target->handle();
 //			dbgLogger.info("  Attack ", target->debugName());
-			c->attack(target);
+			return AiAction::attack(target);
 		}
 	}
+
+	return AiAction::none();
 }
@@ -30,12 +30,9 @@
 
 class TowerAi : public Ai {
 public:
-	TowerAi(CharacterSP character);
+	TowerAi(Character* character);
 
-	virtual void play() override;
-
-public:
-	CharacterWP _target;
+	virtual AiAction decide() override;
 };
 
 
@@ -0,0 +1,202 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <lair/core/log.h>
+
+#include "turn_profiler.h"
+
+
+using namespace lair;
+
+
+const char* profileMetricName(ProfileMetric metric) {
+	static const char* names[] = {
+	    "turn",
+	    "blue_npcs",
+	    "blue_wave",
+	    "red_npcs",
+	    "red_wave",
+	    "win_check",
+	    "player",
+	    "look",
+	    "hero_ai",
+	    "redshirt_ai",
+	    "tower_ai",
+	    "search",
+	    "characters",
+	    "frame",
+	    "fps",
+	};
+	static_assert(sizeof(names) / sizeof(*names) == PROF_COUNT,
+	              "Missing profile metric name");
+	return names[metric];
+}
+
+
+
+RollingStats::RollingStats()
+    : _next(0)
+    , _count(0)
+{
+}
+
+
+unsigned RollingStats::count() const {
+	return _count;
+}
+
+
+void RollingStats::add(uint64 sample) {
+	_samples[_next] = sample;
+	_next = (_next + 1) % SIZE;
+	_count = std::min<unsigned>(_count + 1, SIZE);
+}
+
+
+void RollingStats::clear() {
+	_next  = 0;
+	_count = 0;
+}
+
+
+RollingStats::Summary RollingStats::summary() const {
+	Summary summary{ _count, 0, 0, 0, 0, 0 };
+	if(!_count)
+		return summary;
+
+	uint64 sorted[SIZE];
+	std::copy(_samples, _samples + _count, sorted);
+	std::sort(sorted, sorted + _count);
+
+	uint64 sum = 0;
+	for(unsigned i = 0; i < _count; ++i)
+		sum += sorted[i];
+
+	summary.min    = sorted[0];
+	summary.median = sorted[_count / 2];
+	summary.p95    = sorted[(_count * 95) / 100];
+	summary.max    = sorted[_count - 1];
+	summary.mean   = double(sum) / _count;
+	return summary;
+}
+
+
+
+TurnProfiler::TurnProfiler()
+    : _enabled(false)
+    , _inTurn(false)
+    , _turnCount(0)
+{
+	std::fill(_current, _current + PROF_COUNT, 0);
+}
+
+
+void TurnProfiler::setEnabled(bool enabled) {
+	_enabled = enabled;
+	_inTurn  = false;
+}
+
+
+void TurnProfiler::beginTurn() {
+	if(!_enabled)
+		return;
+
+	std::fill(_current, _current + PROF_COUNT, 0);
+	_inTurn = true;
+}
+
+
+void TurnProfiler::endTurn() {
+	if(!_inTurn)
+		return;
+
+	for(unsigned metric = 0; metric < PROF_COUNT; ++metric) {
+		if(metric != PROF_FRAME && metric != PROF_FPS)
+			_stats[metric].add(_current[metric]);
+	}
+	_turnCount += 1;
+	_inTurn = false;
+}
+
+
+void TurnProfiler::addSample(ProfileMetric metric, uint64 sample) {
+	if(_enabled)
+		_stats[metric].add(sample);
+}
+
+
+const RollingStats& TurnProfiler::stats(ProfileMetric metric) const {
+	return _stats[metric];
+}
+
+
+uint64 TurnProfiler::turnCount() const {
+	return _turnCount;
+}
+
+
+void TurnProfiler::clear() {
+	for(RollingStats& stats: _stats)
+		stats.clear();
+	_turnCount = 0;
+	_inTurn    = false;
+}
+
+
+void TurnProfiler::write(std::ostream& out) const {
+	out << "# " << _turnCount << " turns profiled, statistics of the last "
+	    << unsigned(RollingStats::SIZE) << " samples.\n"
+	    << "# Times are in ns, characters and fps are counts.\n"
+	    << std::left << std::setw(12) << "metric" << std::right
+	    << std::setw(6)  << "count"
+	    << std::setw(10) << "mean"
+	    << std::setw(10) << "min"
+	    << std::setw(10) << "median"
+	    << std::setw(10) << "p95"
+	    << std::setw(10) << "max" << "\n";
+
+	for(unsigned metric = 0; metric < PROF_COUNT; ++metric) {
+		RollingStats::Summary summary = _stats[metric].summary();
+		out << std::left << std::setw(12) << profileMetricName(ProfileMetric(metric))
+		    << std::right
+		    << std::setw(6)  << summary.count
+		    << std::setw(10) << uint64(summary.mean)
+		    << std::setw(10) << summary.min
+		    << std::setw(10) << summary.median
+		    << std::setw(10) << summary.p95
+		    << std::setw(10) << summary.max << "\n";
+	}
+}
+
+
+bool TurnProfiler::save(const Path& path) const {
+	std::ofstream out(path.utf8String().c_str());
+	if(!out.good()) {
+		dbgLogger.error("Unable to write \"", path.utf8String(), "\".");
+		return false;
+	}
+	write(out);
+	return out.good();
+}
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_TURN_PROFILER_H_
+#define LD41_TURN_PROFILER_H_
+
+
+#include <chrono>
+#include <ostream>
+
+#include <lair/core/lair.h>
+#include <lair/core/path.h>
+
+
+enum ProfileMetric {
+	// Phases of TextMoba::nextTurn(), in ns.
+	PROF_TURN,
+	PROF_BLUE_NPCS,
+	PROF_BLUE_WAVE,
+	PROF_RED_NPCS,
+	PROF_RED_WAVE,
+	PROF_WIN_CHECK,
+	PROF_PLAYER,
+	PROF_LOOK,
+	// Time spent in the AIs during a turn, by kind of character, in ns.
+	PROF_HERO_AI,
+	PROF_REDSHIRT_AI,
+	PROF_TOWER_AI,
+	// Time the search AIs spend planning before a turn, in ns, not counted
+	// in PROF_TURN.
+	PROF_SEARCH,
+	// Number of characters that played during a turn.
+	PROF_CHARACTERS,
+	// Time MainState takes to update and draw a frame, in ns, and frames
+	// drawn each second. Not per turn.
+	PROF_FRAME,
+	PROF_FPS,
+
+	PROF_COUNT,
+};
+
+const char* profileMetricName(ProfileMetric metric);
+
+
+// Keeps the last samples of a metric and computes statistics about them on
+// demand.
+class RollingStats {
+public:
+	enum {
+		SIZE = 256,
+	};
+
+	struct Summary {
+		unsigned     count;
+		lair::uint64 min;
+		lair::uint64 median;
+		lair::uint64 p95;
+		lair::uint64 max;
+		double       mean;
+	};
+
+public:
+	RollingStats();
+
+	unsigned count() const;
+	void add(lair::uint64 sample);
+	void clear();
+
+	Summary summary() const;
+
+private:
+	lair::uint64 _samples[SIZE];
+	unsigned     _next;
+	unsigned     _count;
+};
+
+
+// Collects timers and counters per turn. Everything is a no-op unless
+// enabled, so it costs a test per phase in headless matches.
+class TurnProfiler {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+public:
+	TurnProfiler();
+
+	// Called for each character each turn, hence inline.
+	inline bool isEnabled() const {
+		return _enabled;
+	}
+	void setEnabled(bool enabled);
+
+	// Values added between beginTurn() and endTurn() are summed, then give
+	// one sample per metric.
+	void beginTurn();
+	void endTurn();
+	inline void add(ProfileMetric metric, lair::uint64 value) {
+		if(_inTurn)
+			_current[metric] += value;
+	}
+
+	// Adds a sample directly, for metrics that are not per turn.
+	void addSample(ProfileMetric metric, lair::uint64 sample);
+
+	const RollingStats& stats(ProfileMetric metric) const;
+	lair::uint64 turnCount() const;
+	void clear();
+
+	void write(std::ostream& out) const;
+	bool save(const lair::Path& path) const;
+
+private:
+	bool         _enabled;
+	bool         _inTurn;
+	lair::uint64 _turnCount;
+	lair::uint64 _current[PROF_COUNT];
+	RollingStats _stats[PROF_COUNT];
+};
+
+
+// Adds the time spent in its scope to a metric of the profiler, if the
+// profiler is enabled.
+class ProfileScope {
+public:
+	inline ProfileScope(TurnProfiler& profiler, ProfileMetric metric)
+	    : _profiler(profiler.isEnabled()? &profiler: nullptr)
+	    , _metric(metric)
+	{
+		if(_profiler)
+			_start = TurnProfiler::Clock::now();
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+	inline ~ProfileScope() {
+		if(_profiler) {
+			auto time = TurnProfiler::Clock::now() - _start;
+			_profiler->add(_metric, std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+		}
+	}
+
+private:
+	TurnProfiler*            _profiler;
+	ProfileMetric            _metric;
+	TurnProfiler::Clock::time_point _start;
+};
+
+
+#endif
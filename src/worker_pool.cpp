@@ -0,0 +1,120 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "worker_pool.h"
+
+
+using namespace lair;
+
+
+WorkerPool::WorkerPool(unsigned threadCount)
+    : _generation(0)
+    , _finished(0)
+    , _stop(false)
+    , _task(nullptr)
+    , _count(0)
+    , _next(0)
+{
+	for(unsigned i = 1; i < threadCount; ++i) {
+		_threads.emplace_back(&WorkerPool::_work, this);
+	}
+}
+
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+
+	for(std::thread& thread: _threads) {
+		thread.join();
+	}
+}
+
+
+unsigned WorkerPool::threadCount() const {
+	return _threads.size() + 1;
+}
+
+
+void WorkerPool::run(unsigned count, const Task& task) {
+	if(_threads.empty() || count < 2) {
+		for(unsigned i = 0; i < count; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_task     = &task;
+		_count    = count;
+		_next     = 0;
+		_finished = 0;
+		_generation += 1;
+	}
+	_wake.notify_all();
+
+	_runTasks();
+
+	// Every thread checks in, so none of them can still be looking at this
+	// task when the next one starts.
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this]() { return _finished == _threads.size(); });
+	_task = nullptr;
+}
+
+
+void WorkerPool::_work() {
+	unsigned generation = 0;
+
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this, generation]() {
+				return _stop || _generation != generation;
+			});
+			if(_stop)
+				return;
+			generation = _generation;
+		}
+
+		_runTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_finished += 1;
+		}
+		_done.notify_one();
+	}
+}
+
+
+void WorkerPool::_runTasks() {
+	while(true) {
+		unsigned i = _next++;
+		if(i >= _count)
+			break;
+		(*_task)(i);
+	}
+}
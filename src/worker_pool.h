@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2018 the authors (see AUTHORS)
+ *
+ *  This file is part of Draklia's ld41.
+ *
+ *  lair is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lair is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef LD41_WORKER_POOL_H_
+#define LD41_WORKER_POOL_H_
+
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <lair/core/lair.h>
+
+
+// A fixed set of threads that run the iterations of a loop together. The
+// calling thread takes part, so a pool of 1 thread starts no thread at all.
+class WorkerPool {
+public:
+	typedef std::function<void(unsigned)> Task;
+
+public:
+	WorkerPool(unsigned threadCount);
+	WorkerPool(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	unsigned threadCount() const;
+
+	// Calls task(i) for each i in [0, count), in any order and on any
+	// thread, and returns once all the calls are done.
+	void run(unsigned count, const Task& task);
+
+private:
+	void _work();
+	void _runTasks();
+
+private:
+	std::vector<std::thread> _threads;
+
+	std::mutex              _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	unsigned                _generation;
+	unsigned                _finished;
+	bool                    _stop;
+
+	const Task*             _task;
+	unsigned                _count;
+	std::atomic<unsigned>   _next;
+};
+
+
+#endif
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+##
+##  Copyright (C) 2018 the authors (see AUTHORS)
+##
+##  This file is part of ld41.
+##
+##  lair is free software: you can redistribute it and/or modify it
+##  under the terms of the GNU General Public License as published by
+##  the Free Software Foundation, either version 3 of the License, or
+##  (at your option) any later version.
+##
+##  lair is distributed in the hope that it will be useful, but
+##  WITHOUT ANY WARRANTY; without even the implied warranty of
+##  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+##  General Public License for more details.
+##
+##  You should have received a copy of the GNU General Public License
+##  along with lair.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+"""Packs images into a grid atlas, see TextureAtlas.
+
+Each image is placed at the bottom center of its cell, so sprites anchored
+at (0.5, 0) are drawn at the same place as with the separate image. Writes
+<atlas>.png and <atlas>_atlas.ldl, which list the images in tile order.
+
+Only depends on the standard library: 8-bit, non-interlaced PNGs only.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+CHANNELS = { 0: 1, 2: 3, 4: 2, 6: 4 }
+
+
+def read_png(path):
+	with open(path, 'rb') as f:
+		data = f.read()
+	if data[:8] != PNG_SIGNATURE:
+		raise ValueError('{}: not a PNG file'.format(path))
+
+	pos = 8
+	idat = b''
+	while pos < len(data):
+		size, kind = struct.unpack('>I4s', data[pos:pos + 8])
+		chunk = data[pos + 8:pos + 8 + size]
+		pos += 12 + size
+		if kind == b'IHDR':
+			width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+			if depth != 8 or color not in CHANNELS or interlace:
+				raise ValueError('{}: unsupported PNG format'.format(path))
+		elif kind == b'IDAT':
+			idat += chunk
+		elif kind == b'IEND':
+			break
+
+	channels = CHANNELS[color]
+	stride = width * channels
+	raw = zlib.decompress(idat)
+	rows = []
+	prev = bytearray(stride)
+	for y in range(height):
+		start = y * (stride + 1)
+		kind = raw[start]
+		row = bytearray(raw[start + 1:start + 1 + stride])
+		for i in range(stride):
+			a = row[i - channels] if i >= channels else 0
+			b = prev[i]
+			c = prev[i - channels] if i >= channels else 0
+			if kind == 1:
+				row[i] = (row[i] + a) & 0xff
+			elif kind == 2:
+				row[i] = (row[i] + b) & 0xff
+			elif kind == 3:
+				row[i] = (row[i] + (a + b) // 2) & 0xff
+			elif kind == 4:
+				p = a + b - c
+				pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+				pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+				row[i] = (row[i] + pred) & 0xff
+		rows.append(row)
+		prev = row
+
+	# Convert to RGBA.
+	pixels = []
+	for row in rows:
+		rgba = bytearray(width * 4)
+		for x in range(width):
+			p = row[x * channels:(x + 1) * channels]
+			if channels == 1:
+				rgba[x * 4:x * 4 + 4] = bytes((p[0], p[0], p[0], 255))
+			elif channels == 2:
+				rgba[x * 4:x * 4 + 4] = bytes((p[0], p[0], p[0], p[1]))
+			elif channels == 3:
+				rgba[x * 4:x * 4 + 4] = bytes((p[0], p[1], p[2], 255))
+			else:
+				rgba[x * 4:x * 4 + 4] = p
+		pixels.append(rgba)
+	return width, height, pixels
+
+
+def write_png(path, width, height, pixels):
+	def chunk(kind, body):
+		return (struct.pack('>I', len(body)) + kind + body
+		        + struct.pack('>I', zlib.crc32(kind + body) & 0xffffffff))
+
+	raw = b''.join(b'\x00' + bytes(row) for row in pixels)
+	with open(path, 'wb') as f:
+		f.write(PNG_SIGNATURE)
+		f.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 6, 0, 0, 0)))
+		f.write(chunk(b'IDAT', zlib.compress(raw, 9)))
+		f.write(chunk(b'IEND', b''))
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+	parser.add_argument('--columns', type=int, default=4,
+	                    help='number of cells per row (default: 4)')
+	parser.add_argument('--dir', default='.',
+	                    help='directory of the images and of the atlas (default: .)')
+	parser.add_argument('atlas', help='name of the atlas, without extension')
+	parser.add_argument('images', nargs='+', help='images to pack, relative to --dir')
+	args = parser.parse_args()
+
+	images = [ read_png(os.path.join(args.dir, image)) for image in args.images ]
+	cellWidth  = max(image[0] for image in images)
+	cellHeight = max(image[1] for image in images)
+	columns = min(args.columns, len(images))
+	rows    = (len(images) - 1) // columns + 1
+
+	width  = cellWidth  * columns
+	height = cellHeight * rows
+	pixels = [ bytearray(width * 4) for y in range(height) ]
+	for index, (w, h, image) in enumerate(images):
+		x0 = (index % columns) * cellWidth + (cellWidth - w) // 2
+		y0 = (index // columns) * cellHeight + cellHeight - h
+		for y in range(h):
+			pixels[y0 + y][x0 * 4:(x0 + w) * 4] = image[y]
+
+	texture = args.atlas + '.png'
+	write_png(os.path.join(args.dir, texture), width, height, pixels)
+
+	with open(os.path.join(args.dir, args.atlas + '_atlas.ldl'), 'w') as f:
+		f.write('// Generated by tools/build_atlas.py, do not edit.\n')
+		f.write("texture   = '{}'\n".format(texture))
+		f.write('tile_grid = Vector({}, {})\n'.format(columns, rows))
+		f.write('tiles = [\n')
+		f.write(',\n'.join("\t'{}'".format(image) for image in args.images))
+		f.write('\n')
+		f.write(']\n')
+
+	print('{}: {} images in {}x{} cells of {}x{}'.format(
+	      texture, len(images), columns, rows, cellWidth, cellHeight))
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())